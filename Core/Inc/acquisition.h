@@ -0,0 +1,106 @@
+/*
+ * acquisition.h
+ *
+ *  Created on: Mar 23, 2026
+ *      Author: BioFET Team
+ *
+ *  Timer-paced acquisition of the four FET current ADCs. Every tick of a
+ *  dedicated timer reads all four ADCs in one burst from the ISR, so each
+ *  FET is sampled at the same fixed rate regardless of what the main loop
+ *  is doing. The ADC chip selects are on Expander 3 (EXP3_ADCx_CS_PIN): the
+ *  burst writes the expander latch once per ADC, which selects the next
+ *  ADC and deselects the previous one in the same frame, and keeps SPI1
+ *  clocking back to back at register level until all four are read.
+ *
+ *  Samples go into a ring that the ISR overwrites without waiting, read by
+ *  any number of consumers (logger, live stream) through their own
+ *  Acq_Reader_t. A consumer that falls more than ACQ_RING_LEN samples
+ *  behind loses the oldest ones and sees them counted in its reader.
+ *
+ *  Bursts can run faster than the output rate: each output sample is the
+ *  result of Osr bursts passed through the filter chain in dsp.h, which
+ *  runs in the same ISR. Acq_PeriodUs() is the output period; the timer
+ *  fires every Acq_PeriodUs() / Osr.
+ *
+ *  Bursts use the high-priority lane of the SPI bus arbiter (spi_bus.h).
+ *  A burst that finds the bus owned waits until the owner lets go and then
+ *  runs ahead of any queued transfer, so it is late by at most one CS
+ *  cycle. Only a burst still waiting at the next tick is given up: it is
+ *  counted in Acq_Missed() and left out of its output's average
+ *  (ACQ_FLAG_PARTIAL). If a whole output is lost, its tick number is
+ *  skipped in the ring, so consumers see the gap.
+ *
+ *  Each sample carries the measurement range of every FET (autorange.h),
+ *  4 bits per channel. A channel whose range changed during the sample,
+ *  or during the one before it (front-end settling), is tagged
+ *  ACQ_RANGE_SWITCHING instead.
+ *
+ *  USER: If a different ADC is fitted, change ACQ_ADC_FRAME_BYTES and
+ *  Acq_Decode() in acquisition.c. The default assumes a 16-bit two's
+ *  complement result clocked out MSB first while CS is low.
+ */
+
+#ifndef INC_ACQUISITION_H_
+#define INC_ACQUISITION_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "dac.h"
+#include "dsp.h"
+
+#define ACQ_CHANNELS 4          // One ADC per FET
+#define ACQ_RING_LEN 256        // Samples, power of two
+#define ACQ_ADC_FRAME_BYTES 2   // Bytes clocked per ADC read
+#define ACQ_TIMER_HZ 1000000    // Timer tick, period unit is 1us
+#define ACQ_MIN_PERIOD_US 1000  // Shortest output period
+#define ACQ_MIN_BURST_US 100    // A burst takes ~60us at SPI1 = 4MHz
+#define ACQ_DEFAULT_PERIOD_US 100000
+
+// Sample flags
+#define ACQ_FLAG_PARTIAL 0x0001 // Some bursts of the average were missed
+
+// Range tags, 4 bits per channel (FET 1 in bits 0..3)
+#define ACQ_RANGE_SWITCHING 0xF // Reading not valid in any range
+#define ACQ_RANGE_OF(ranges, ch) (((ranges) >> (4 * (ch))) & 0xF)
+
+// One output sample over all ADCs (20 bytes)
+typedef struct {
+  uint32_t Tick;    // Output number, Acq_PeriodUs() apart
+  uint16_t DacCode; // Bias DAC code when the sample was completed
+  uint16_t Flags;   // ACQ_FLAG_*
+  uint16_t Ranges;  // Range tag per channel
+  int16_t Raw[ACQ_CHANNELS]; // Filtered ADC codes, FET 1..4
+} Acq_Sample_t;
+
+// Read position of one consumer
+typedef struct {
+  uint32_t tail; // Samples consumed, compared with the writer's count
+  uint32_t lost; // Samples overwritten before they were read
+} Acq_Reader_t;
+
+// Function Prototypes
+void Acq_Init(TIM_HandleTypeDef *htim, SPI_HandleTypeDef *hspi,
+              MCP23S17_Handle_t *exp,
+              const uint8_t cs_pins[ACQ_CHANNELS]); // Same expander port
+uint8_t Acq_SetPeriodUs(uint32_t period_us); // Returns 0 if out of range
+uint32_t Acq_PeriodUs(void); // Output period (burst period x Osr)
+uint8_t Acq_SetFilter(const Dsp_Config_t *cfg); // Returns 0 if invalid
+void Acq_GetFilter(Dsp_Config_t *cfg);
+void Acq_SetBias(const DAC_Channel_t *ch); // DAC recorded with each burst
+void Acq_SetRanges(uint16_t ranges); // Range tags, before and after a switch
+void Acq_Start(void);
+void Acq_Stop(void);
+uint32_t Acq_Missed(void); // Bursts given up because the bus was busy
+void Acq_OnTick(void);     // From the timer update interrupt
+
+uint32_t Acq_ReaderSync(Acq_Reader_t *reader); // Returns the next tick
+uint8_t Acq_Read(Acq_Reader_t *reader,
+                 Acq_Sample_t *sample); // Returns 0 if none new
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_ACQUISITION_H_ */
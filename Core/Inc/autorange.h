@@ -0,0 +1,54 @@
+/*
+ * autorange.h
+ *
+ *  Created on: Mar 25, 2026
+ *      Author: BioFET Team
+ *
+ *  Automatic measurement range selection per FET. Each FET's front end
+ *  has 3 gain and 3 shunt select bits on Expander 1/2; a range is one
+ *  (gain, shunt) pair from the ladder in autorange.c, index 0 being the
+ *  most sensitive.
+ *
+ *  AutoRange_Service() reads the acquisition ring from the main loop. A
+ *  channel in auto mode moves one range up as soon as a sample reaches
+ *  RANGE_HIGH_CODE (clipping), and one range down after RANGE_LOW_SAMPLES
+ *  consecutive samples below RANGE_LOW_CODE. The gap between the two
+ *  thresholds is the hysteresis: RANGE_LOW_CODE times the ratio between
+ *  neighbouring ranges must stay below RANGE_HIGH_CODE, or a channel
+ *  would bounce. Changes for all FETs found in one pass are written
+ *  together, one latch write per expander at most (MCP_FlushGroup).
+ *
+ *  Samples carry the range they were taken in (Acq_Sample_t.Ranges), so a
+ *  run keeps full dynamic range and the host scales each reading with
+ *  AutoRange_LsbFa() of its range.
+ */
+
+#ifndef INC_AUTORANGE_H_
+#define INC_AUTORANGE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "acquisition.h"
+
+#define RANGE_COUNT 4         // Ladder length, at most 15 (4-bit tags)
+#define RANGE_AUTO 0xFF       // AutoRange_Set(): let the controller choose
+#define RANGE_HIGH_CODE 30000 // |code| at or above: clipping, range up
+#define RANGE_LOW_CODE 2000   // |code| below ...
+#define RANGE_LOW_SAMPLES 8   // ... for this many samples: range down
+
+// Function Prototypes
+void AutoRange_Init(MCP23S17_Handle_t *fet12,
+                    MCP23S17_Handle_t *fet34); // All auto, least sensitive
+void AutoRange_Service(void);                  // Call from the main loop
+uint8_t AutoRange_Set(uint8_t fet, uint8_t range); // fet 0..3, 0 = invalid
+uint8_t AutoRange_Get(uint8_t fet);
+uint8_t AutoRange_IsAuto(uint8_t fet);
+uint32_t AutoRange_LsbFa(uint8_t range); // Current per ADC code, in fA
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_AUTORANGE_H_ */
@@ -0,0 +1,81 @@
+/*
+ * chip_select.h
+ *
+ *  Created on: Mar 16, 2026
+ *      Author: BioFET Team
+ *
+ *  Chip select lines for SPI peripherals. A CS is either a native STM32
+ *  pin, driven with a single BSRR store (well under a microsecond), or a
+ *  pin on an MCP23S17 expander, which costs an SPI write to the expander
+ *  per edge.
+ *
+ *  ChipSel_BeginBurst/EndBurst keep a CS asserted across several frames;
+ *  Assert/Release inside a burst do nothing. Use it for devices that
+ *  accept back-to-back frames without a CS edge, so an expander-routed
+ *  CS is toggled once per burst instead of once per frame. The bias DACs
+ *  are not such devices (see dac.h).
+ *
+ *  An asserted ChipSel_t claims the SPI bus (spi_bus.h), so interrupt-driven
+ *  transfers stay off the bus until it is released. Asserting waits for a
+ *  queued DMA chain to finish first. The frames sent meanwhile go through
+ *  SpiBus_Transfer() with no CsPort of their own.
+ */
+
+#ifndef INC_CHIP_SELECT_H_
+#define INC_CHIP_SELECT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "mcp23s17.h"
+#include "spi_bus.h"
+
+typedef enum {
+  CHIPSEL_NATIVE,  // STM32 GPIO
+  CHIPSEL_EXPANDER // MCP23S17 pin
+} ChipSel_Kind_t;
+
+// Structure to hold chip select context
+typedef struct {
+  ChipSel_Kind_t kind;
+  GPIO_TypeDef *port;     // CHIPSEL_NATIVE
+  uint16_t pin;           // GPIO_PIN_x mask, or expander pin 0..15
+  MCP23S17_Handle_t *exp; // CHIPSEL_EXPANDER
+  uint8_t burst;          // Nesting depth of BeginBurst
+} ChipSel_t;
+
+// Function Prototypes
+void ChipSel_InitNative(ChipSel_t *cs, GPIO_TypeDef *port, uint16_t pin);
+void ChipSel_InitExpander(ChipSel_t *cs, MCP23S17_Handle_t *exp,
+                          uint8_t pin);
+void ChipSel_ExpanderWrite(ChipSel_t *cs, uint8_t level);
+void ChipSel_BeginBurst(ChipSel_t *cs);
+void ChipSel_EndBurst(ChipSel_t *cs);
+
+// Active low. Inline so the native edge is a single store.
+static inline void ChipSel_Assert(ChipSel_t *cs) {
+  if (cs->burst)
+    return;
+  SpiBus_Claim();
+  if (cs->kind == CHIPSEL_NATIVE)
+    GPIO_FAST_LOW(cs->port, cs->pin);
+  else
+    ChipSel_ExpanderWrite(cs, 0);
+}
+
+static inline void ChipSel_Release(ChipSel_t *cs) {
+  if (cs->burst)
+    return;
+  if (cs->kind == CHIPSEL_NATIVE)
+    GPIO_FAST_HIGH(cs->port, cs->pin);
+  else
+    ChipSel_ExpanderWrite(cs, 1);
+  SpiBus_Unclaim();
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_CHIP_SELECT_H_ */
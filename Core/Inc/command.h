@@ -0,0 +1,92 @@
+/*
+ * command.h
+ *
+ *  Created on: Apr 6, 2026
+ *      Author: BioFET Team
+ *
+ *  Table-driven command dispatcher. The application registers a table of
+ *  Cmd_t entries; Cmd_Init() indexes the names in a small open-addressed
+ *  hash table, so a lookup is one hash plus (almost always) one string
+ *  compare, and names must match exactly (no prefix collisions).
+ *
+ *  A line holds one or more commands separated by ';'. Each is
+ *
+ *    [#tag ]NAME [arg[,arg...]]
+ *
+ *  and is parsed against the argument list of its entry before the
+ *  handler runs: integers and floats must parse completely and lie within
+ *  [Min, Max], characters must be a single character. A command that does
+ *  not parse is answered with the entry's Invalid message and its handler
+ *  is not called. Commands in a line run in order; one failing does not
+ *  stop the rest.
+ *
+ *  An optional #tag (up to CMD_TAG_MAX - 1 characters) is echoed at the
+ *  start of every response line of that command (see Cmd_Tag()), so a
+ *  host can send a whole batch at once and match the answers up.
+ */
+
+#ifndef INC_COMMAND_H_
+#define INC_COMMAND_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define CMD_MAX_ARGS 6
+#define CMD_TAG_MAX 10   // Including the '#' and the terminator
+#define CMD_HASH_SIZE 64 // Slots, power of two, > twice the command count
+
+// Argument types (Cmd_ArgSpec_t.Type)
+#define CMD_ARG_INT 'i'   // Decimal integer in [Min, Max]
+#define CMD_ARG_FLOAT 'f' // Number in [Min, Max]
+#define CMD_ARG_CHAR 'c'  // Single character
+#define CMD_ARG_WORD 's'  // Any text without ',' or ';'
+
+// Conditions checked by the application's guard (Cmd_Guard_t)
+#define CMD_FLAG_IDLE 0x01  // Refused while a test is running
+#define CMD_FLAG_FLASH 0x02 // Refused while the flash is busy (chip erase)
+
+typedef struct {
+  char Type;   // CMD_ARG_*
+  int32_t Min; // Range of numbers, inclusive
+  int32_t Max;
+} Cmd_ArgSpec_t;
+
+typedef union {
+  int32_t Int;
+  float Float;
+  char Char;
+  const char *Word; // Points into the command line
+} Cmd_Value_t;
+
+typedef struct {
+  uint8_t Count; // Arguments given
+  Cmd_Value_t Arg[CMD_MAX_ARGS];
+} Cmd_Args_t;
+
+typedef struct {
+  const char *Name;
+  void (*Handler)(const Cmd_Args_t *args);
+  uint8_t Flags;       // CMD_FLAG_*
+  uint8_t MinArgs;     // Arguments past this one may be left out
+  uint8_t NumArgs;
+  const char *Invalid; // Response to bad arguments, NULL for a generic one
+  Cmd_ArgSpec_t Args[CMD_MAX_ARGS];
+} Cmd_t;
+
+// Returns the error response for a command that may not run now, or NULL
+typedef const char *(*Cmd_Guard_t)(const Cmd_t *cmd);
+
+// Function Prototypes
+void Cmd_Init(const Cmd_t *table, uint8_t count, Cmd_Guard_t guard,
+              void (*respond)(const char *msg));
+void Cmd_Execute(char *line); // Modifies line
+const char *Cmd_Tag(void);    // Tag of the running command, "" if none
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_COMMAND_H_ */
@@ -0,0 +1,59 @@
+/*
+ * dac.h
+ *
+ *  Created on: Mar 18, 2026
+ *      Author: BioFET Team
+ *
+ *  Driver for the two bias DACs (0-10V and -1..+1V channels).
+ *  Both are 12-bit SPI DACs with an MCP4921-style 16-bit frame:
+ *  [15] 0, [14] BUF, [13] GAIN (1 = 1x), [12] SHDN (1 = active),
+ *  [11:0] code. The output stage scales code 0..4095 linearly onto
+ *  min_mv..max_mv of each channel.
+ *
+ *  The DAC takes the first 16 clocks after CS falls and updates its output
+ *  on the rising CS edge, so every setpoint needs a CS cycle of its own and
+ *  a ChipSel_BeginBurst() around several frames would only output the
+ *  first. With expander chip selects each update therefore costs two
+ *  expander writes; few-microsecond updates need DAC_NATIVE_CS (main.h).
+ *
+ *  USER: If a different DAC is fitted, change DAC_FRAME() and the
+ *  channel ranges in main.c.
+ */
+
+#ifndef INC_DAC_H_
+#define INC_DAC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "chip_select.h"
+
+#define DAC_MAX_CODE 4095
+#define DAC_CMD_BITS 0x3000 // Unbuffered, 1x gain, output on
+#define DAC_FRAME(code) ((uint16_t)(DAC_CMD_BITS | ((code) & 0x0FFF)))
+
+// Structure to hold DAC channel context
+typedef struct {
+  SPI_HandleTypeDef *hspi;
+  ChipSel_t *cs;
+  int32_t min_mv; // Output at code 0
+  int32_t max_mv; // Output at DAC_MAX_CODE
+  uint16_t code;  // Last code written
+} DAC_Channel_t;
+
+// Function Prototypes
+void DAC_Init(DAC_Channel_t *ch, SPI_HandleTypeDef *hspi, ChipSel_t *cs,
+              int32_t min_mv, int32_t max_mv);
+uint16_t DAC_MvToCode(const DAC_Channel_t *ch, int32_t mv); // Clamped
+int32_t DAC_CodeToMv(const DAC_Channel_t *ch, uint16_t code);
+void DAC_SetMv(DAC_Channel_t *ch, int32_t mv);
+void DAC_WriteFrame(DAC_Channel_t *ch, uint16_t frame); // Main loop only
+void DAC_WriteFrameFast(DAC_Channel_t *ch,
+                        uint16_t frame); // ISR, native CS, bus idle
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_DAC_H_ */
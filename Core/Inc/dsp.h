@@ -0,0 +1,57 @@
+/*
+ * dsp.h
+ *
+ *  Created on: Mar 24, 2026
+ *      Author: BioFET Team
+ *
+ *  Per-channel filter chain between ADC bursts and the sample ring, run
+ *  from the acquisition ISR. Integer only:
+ *    1. Boxcar decimation (first-order CIC): Osr bursts are summed and
+ *       averaged into one output, cutting noise by sqrt(Osr).
+ *    2. Moving median over the last 3 or 5 outputs, for spike rejection.
+ *    3. First-order IIR low-pass, y += (x - y) / 2^IirShift, kept with 8
+ *       fractional bits so small steps are not lost to rounding.
+ *  Each stage is skipped when set to 1 / 0.
+ */
+
+#ifndef INC_DSP_H_
+#define INC_DSP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define DSP_MAX_OSR 256
+#define DSP_MAX_MEDIAN 5
+#define DSP_MAX_IIR_SHIFT 8
+
+typedef struct {
+  uint16_t Osr;     // Bursts per output, 1..DSP_MAX_OSR
+  uint8_t Median;   // Window in outputs: 1 (off), 3 or 5
+  uint8_t IirShift; // 0 (off) .. DSP_MAX_IIR_SHIFT
+} Dsp_Config_t;
+
+// Structure to hold the filter state of one channel
+typedef struct {
+  int32_t acc;                 // Sum of the bursts since the last output
+  int16_t hist[DSP_MAX_MEDIAN]; // Last decimated values, for the median
+  uint8_t hist_pos;
+  uint8_t hist_len;
+  uint8_t iir_valid;           // iir_q8 holds a value
+  int32_t iir_q8;              // Low-pass state, 8 fractional bits
+} Dsp_Channel_t;
+
+// Function Prototypes
+uint8_t Dsp_ConfigValid(const Dsp_Config_t *cfg);
+void Dsp_Reset(Dsp_Channel_t *ch);
+static inline void Dsp_Add(Dsp_Channel_t *ch, int16_t x) { ch->acc += x; }
+int16_t Dsp_Output(Dsp_Channel_t *ch, const Dsp_Config_t *cfg,
+                   uint16_t n); // Average of n bursts, filtered
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_DSP_H_ */
@@ -0,0 +1,90 @@
+/*
+ * flash_log.h
+ *
+ *  Created on: Mar 2, 2026
+ *      Author: BioFET Team
+ *
+ *  Log-structured storage for test data on the W25Q32.
+ *  The data sectors (DATA_ADDR_START to the end of the chip) form a ring.
+ *  Each sector starts with a LogSector_t header carrying a sequence number
+ *  that increases forever, so sector N of the log lives in ring slot
+ *  N % LOG_RING_SECTORS and stale sectors are recognised by their sequence.
+ *  Positions in the log are (sequence, payload offset) pairs.
+ *
+ *  Records are collected in a RAM page buffer and programmed one full
+ *  256-byte page at a time. The next sector is erased (reclaiming whatever
+ *  old data it held) just before the write pointer enters it, so runs are
+ *  spread over the whole chip and no up-front erase is ever needed.
+ *  FlashLog_Reserve() additionally queues the erases for the expected size
+ *  of a run in the background (64KB block erases where a whole block is
+ *  covered), one job at a time, so they stay ahead of the write pointer
+ *  without holding up page programs.
+ *
+ *  Programs and erases go through the W25Q async queue (w25q_async.h), so
+ *  appending never waits on the flash BUSY bit unless both page buffers are
+ *  still in flight. W25Q_AsyncProcess() must be called from the main loop.
+ */
+
+#ifndef INC_FLASH_LOG_H_
+#define INC_FLASH_LOG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "w25q_async.h"
+
+#define LOG_SECTOR_MAGIC 0x53474F4C // "LOGS" in flash byte order
+#define LOG_RING_SECTORS                                                       \
+  ((FLASH_TOTAL_SIZE - DATA_ADDR_START) / FLASH_SECTOR_SIZE)
+#define LOG_SECTOR_PAYLOAD (FLASH_SECTOR_SIZE - sizeof(LogSector_t))
+
+// Header at the start of every data sector (16 bytes)
+typedef struct {
+  uint32_t Magic;    // LOG_SECTOR_MAGIC
+  uint32_t Sequence; // Log sector number, never reused
+  uint16_t RunId;    // Run being written when the sector was opened
+  uint16_t Reserved0;
+  uint32_t Reserved1;
+} LogSector_t;
+
+// Structure to hold log writer context
+typedef struct {
+  uint32_t seq;          // Sequence number of the sector being written
+  uint32_t erased_seq;   // Highest sequence whose ring slot is erased
+  uint32_t reserve_seq;  // Pre-erase slots up to this sequence
+  volatile uint8_t erase_pending; // A pre-erase job is queued or running
+  uint32_t page_addr;    // Flash address of the page being filled
+  uint16_t sector_off;   // Payload offset of the next byte in the sector
+  uint16_t run_id;       // Stamped into new sector headers
+  uint32_t size;         // Payload bytes appended since FlashLog_Init
+  uint16_t page_fill;    // Bytes of the current buffer holding valid data
+  uint16_t page_flushed; // Bytes of the current buffer already submitted
+  uint8_t cur;           // Index of the buffer being filled
+  volatile uint8_t in_flight[2]; // Program jobs still reading each buffer
+  uint32_t lost;         // Program jobs that failed on the bus
+  uint8_t page_buf[2][FLASH_PAGE_SIZE]; // Fill one while the other programs
+} FlashLog_t;
+
+// Function Prototypes
+void FlashLog_Init(FlashLog_t *log, uint32_t seq, uint16_t offset,
+                   uint16_t run_id); // Resume writing at (seq, offset)
+uint32_t FlashLog_Append(FlashLog_t *log, const uint8_t *data,
+                         uint32_t len); // Returns bytes accepted
+void FlashLog_Flush(FlashLog_t *log);  // Queue any partial page
+void FlashLog_Reserve(FlashLog_t *log, uint32_t len); // Expected run size
+void FlashLog_Service(FlashLog_t *log); // Call from the main loop
+uint32_t FlashLog_Size(const FlashLog_t *log); // Bytes logged so far
+uint32_t FlashLog_Lost(const FlashLog_t *log); // Failed page programs
+
+// Position helpers
+uint32_t FlashLog_SectorAddr(uint32_t seq); // Ring slot of a sequence
+uint32_t FlashLog_DataAddr(uint32_t seq, uint16_t offset);
+void FlashLog_Advance(uint32_t *seq, uint16_t *offset, uint32_t len);
+uint8_t FlashLog_SectorValid(uint32_t seq); // Header present and current
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_FLASH_LOG_H_ */
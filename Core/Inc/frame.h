@@ -0,0 +1,68 @@
+/*
+ * frame.h
+ *
+ *  Created on: Mar 30, 2026
+ *      Author: BioFET Team
+ *
+ *  Binary framing for the host link, used alongside the plain text
+ *  commands. A frame on the wire is 0x00, the COBS encoding of
+ *
+ *    Type (1) | Seq (1) | Len (2, LE) | Data (Len) | CRC16 (2, LE)
+ *
+ *  and a closing 0x00. COBS removes every zero from the body, so a zero
+ *  byte always marks a frame boundary and a receiver resynchronises on the
+ *  next one after noise. The CRC is CRC-16/CCITT-FALSE (poly 0x1021, init
+ *  0xFFFF) over Type..Data; frames that fail it are dropped.
+ *
+ *  The host sends commands as FRAME_CMD; the replies then come back as
+ *  FRAME_TEXT. READ_FLASH in a frame is sent as BEGIN, DATA and END frames
+ *  with windowed acknowledgements (offload.h).
+ */
+
+#ifndef INC_FRAME_H_
+#define INC_FRAME_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "uart_tx.h"
+
+// Frame types. Offsets and lengths in the data are uint32_t LE.
+#define FRAME_CMD 0x01     // Host -> device: command line, no terminator
+#define FRAME_TEXT 0x02    // Device -> host: response line
+#define FRAME_BEGIN 0x10   // Device -> host: total bytes of the transfer
+#define FRAME_DATA 0x11    // Device -> host: offset, then the bytes
+#define FRAME_END 0x12     // Device -> host: total bytes sent
+#define FRAME_ACK 0x13     // Host -> device: every byte before offset is in
+#define FRAME_NAK 0x14     // Host -> device: resend from offset
+#define FRAME_SAMPLES 0x20 // Device -> host: live samples (stream.h)
+
+#define FRAME_OVERHEAD 6   // Type, Seq, Len and CRC
+#define FRAME_DATA_MAX 244 // Longest Data field (frame fits one bulk chunk)
+// Bytes on the wire for len bytes of data: one COBS code byte per 254
+// bytes of body, plus both delimiters
+#define FRAME_WIRE_SIZE(len)                                                   \
+  ((len) + FRAME_OVERHEAD + ((len) + FRAME_OVERHEAD) / 254 + 3)
+
+typedef struct {
+  uint8_t Type;
+  uint8_t Seq;
+  uint16_t Len;
+  const uint8_t *Data; // Points into the decoded buffer
+} Frame_t;
+
+// Function Prototypes
+uint16_t Frame_Crc16(uint16_t crc, const uint8_t *data, uint16_t len);
+uint16_t Frame_Encode(uint8_t *out, uint8_t type, uint8_t seq,
+                      const void *data, uint16_t len); // Returns wire bytes
+uint8_t Frame_Decode(uint8_t *buf, uint16_t len,
+                     Frame_t *frame); // COBS body in place, 0 = bad frame
+uint8_t Frame_Send(UartTx_Lane_t lane, uint8_t type, const void *data,
+                   uint16_t len); // 0 = lane full, nothing queued
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_FRAME_H_ */
@@ -0,0 +1,69 @@
+/*
+ * log_format.h
+ *
+ *  Created on: Mar 9, 2026
+ *      Author: BioFET Team
+ *
+ *  On-flash format of a test run: one Log_Header_t followed by fixed-size
+ *  binary sample records. All fields are little-endian fixed point, so the
+ *  logging path needs no float printf. biofet_gui.py decodes this back to
+ *  CSV on the host (keep both sides in sync when bumping the version).
+ *
+ *  Version 2 adds the measurement range of each reading (autorange.h): a
+ *  4-bit tag per channel in every record, and the current per ADC code of
+ *  each range in the header. Readings tagged LOG_RANGE_INVALID were taken
+ *  while the range was switching.
+ */
+
+#ifndef INC_LOG_FORMAT_H_
+#define INC_LOG_FORMAT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define LOG_MAGIC 0x474C4642 // "BFLG" in flash byte order
+#define LOG_FORMAT_VERSION 2
+#define LOG_MAX_CHANNELS 4 // One reading per FET
+#define LOG_MAX_RANGES 15  // Range tags 0..14
+#define LOG_RANGE_INVALID 0xF
+
+// Default LSB size used by the firmware
+#define LOG_DAC_LSB_UV 1000 // DAC setpoint stored in mV
+
+// Run header, written once at the start of each run (84 bytes)
+typedef struct {
+  uint32_t Magic;          // LOG_MAGIC
+  uint8_t Version;         // LOG_FORMAT_VERSION
+  uint8_t HeaderSize;      // sizeof(Log_Header_t)
+  uint8_t RecordSize;      // LOG_RECORD_SIZE(ChannelCount)
+  uint8_t ChannelCount;    // Readings per record (1..LOG_MAX_CHANNELS)
+  uint32_t SamplePeriodUs; // Nominal time between records
+  uint32_t RunTimeMs;      // Configured run length (0 = open ended)
+  uint8_t TestType;        // g_TestType at start
+  uint8_t Reserved[3];
+  uint16_t DacLsb_uV;     // Scale of Log_Record_t.DacSetpoint
+  uint16_t Reserved1;     // Was ReadingLsb_pA in version 1
+  uint32_t RangeLsb_fA[LOG_MAX_RANGES]; // Reading scale per range tag
+} Log_Header_t;
+
+// Sample record. Only the first ChannelCount readings are stored, so a
+// record is 8 + 2 * ChannelCount bytes on flash (16 bytes for four).
+typedef struct {
+  uint32_t TimeMs;     // Time since run start
+  int16_t DacSetpoint; // In DacLsb_uV units
+  uint16_t Ranges;     // Range tag of Reading[n] in bits 4n..4n+3
+  int16_t Reading[LOG_MAX_CHANNELS]; // In RangeLsb_fA[tag] units
+} Log_Record_t;
+
+#define LOG_RECORD_SIZE(channels) (8 + 2 * (channels))
+
+_Static_assert(sizeof(Log_Header_t) == 84, "Log_Header_t layout changed");
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_LOG_FORMAT_H_ */
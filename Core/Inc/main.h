@@ -53,6 +53,55 @@ void Error_Handler(void);
 #define EXP3_CS_Pin         GPIO_PIN_2
 #define EXP3_CS_GPIO_Port   GPIOB  // USER: Change this if connected elsewhere
 
+// W25Q32 Flash. Must be a native pin, not EXP3_FLASH_CS_PIN: queued DMA
+// reads and programs release it from the DMA interrupt (spi_bus.h).
+#define FLASH_CS_Pin        GPIO_PIN_12
+#define FLASH_CS_GPIO_Port  GPIOB  // USER: Verify this!
+
+// Chip select edges on the hot paths are single BSRR stores. The host
+// build (Sim/) defines these first to route them to its device models.
+#ifndef GPIO_FAST_HIGH
+#define GPIO_FAST_HIGH(port, pin) ((port)->BSRR = (pin))
+#define GPIO_FAST_LOW(port, pin)  ((port)->BSRR = (uint32_t)(pin) << 16)
+#endif
+
+/*
+ * SHARED CS MODE
+ * Set EXP_SHARED_CS to 1 if all three expanders are wired to EXP1_CS and
+ * told apart by their A2..A0 pins (IOCON.HAEN). EXP2_CS/EXP3_CS are then
+ * unused by the expanders.
+ */
+#define EXP_SHARED_CS       0
+#define EXP1_SPI_ADDR       0x40   // A2..A0 = 000
+#define EXP2_SPI_ADDR       0x42   // A2..A0 = 001
+#define EXP3_SPI_ADDR       0x44   // A2..A0 = 010
+
+/*
+ * DAC CHIP SELECTS
+ * The board routes the DAC CS lines through Expander 3 (EXP3_DAC_*_CS_PIN),
+ * so that is the default. Set DAC_NATIVE_CS to 1 if they are wired to the
+ * STM32 pins below instead; a DAC update then toggles CS with a BSRR write
+ * instead of two expander transfers.
+ */
+#define DAC_NATIVE_CS             0
+#define DAC_0_10V_CS_Pin          GPIO_PIN_4
+#define DAC_0_10V_CS_GPIO_Port    GPIOA  // USER: Verify this!
+#define DAC_N1_1V_CS_Pin          GPIO_PIN_8
+#define DAC_N1_1V_CS_GPIO_Port    GPIOA  // USER: Verify this!
+
+/*
+ * CLOCK PROFILE (SystemClock_Config)
+ * CLOCK_PROFILE_PLL84 needs the 25 MHz crystal of the BlackPill (HSE_VALUE)
+ * and falls back to CLOCK_PROFILE_HSI if it does not start. SPI devices are
+ * clocked at their own limits in every profile (spi_bus.h).
+ */
+#define CLOCK_PROFILE_HSI         0 // 16 MHz internal oscillator, no PLL
+#define CLOCK_PROFILE_PLL84       1 // HSE + PLL, 84 MHz, APB1 at 42 MHz
+#define CLOCK_PROFILE_LOW_POWER   2 // HSI / 2 = 8 MHz, regulator scale 3
+#ifndef BIOFET_CLOCK_PROFILE
+#define BIOFET_CLOCK_PROFILE      CLOCK_PROFILE_PLL84
+#endif
+
 /*
  * DEBUG / CONSOLE (USART1)
  */
@@ -5,6 +5,14 @@
  *      Author: BioFET Team
  *
  *  Simple polling driver for MCP23S17 SPI I/O Expander.
+ *  Relies on the power-on sequential mode (IOCON.SEQOP = 0): OLATA and
+ *  OLATB are written in one transaction, and only ports that changed are
+ *  sent at all.
+ *
+ *  Several expanders can share one CS line when IOCON.HAEN is set: each
+ *  then only answers to the opcode matching its A2..A0 pins (0x40 | A<<1).
+ *  MCP_Set* only update the cache; MCP_Flush/MCP_FlushGroup send all
+ *  staged changes in one pass, one latch write per expander.
  */
 
 #ifndef INC_MCP23S17_H_
@@ -15,11 +23,15 @@
 // Registers (IOCON.BANK = 0)
 #define MCP_IODIRA   0x00
 #define MCP_IODIRB   0x01
+#define MCP_IOCON    0x0A
 #define MCP_GPIOA    0x12
 #define MCP_GPIOB    0x13
 #define MCP_OLATA    0x14
 #define MCP_OLATB    0x15
 
+#define MCP_BASE_ADDR   0x40 // Opcode with A2..A0 = 000, or HAEN off
+#define MCP_IOCON_HAEN  0x08 // Hardware address enable
+
 // Structure to hold device context
 typedef struct {
     SPI_HandleTypeDef *hspi;    // Pointer to SPI handle
@@ -27,6 +39,7 @@ typedef struct {
     uint16_t cs_pin;            // GPIO Pin for Chip Select
     uint8_t device_addr;        // Hardware address (usually 0x40 if A0-A2 grounded)
     uint16_t current_output;    // Cache of current output state (16 bits for Port A + B)
+    uint16_t latched_output;    // What OLATA/OLATB actually hold
 } MCP23S17_Handle_t;
 
 // Function Prototypes
@@ -36,4 +49,10 @@ void MCP_WritePin(MCP23S17_Handle_t *dev, uint16_t pin, uint8_t state);
 void MCP_TogglePin(MCP23S17_Handle_t *dev, uint16_t pin);
 void MCP_WritePort(MCP23S17_Handle_t *dev, uint16_t val); // Write all 16 pins
 
+// Staged updates: change the cache only, then flush
+void MCP_SetPin(MCP23S17_Handle_t *dev, uint16_t pin, uint8_t state);
+void MCP_SetBits(MCP23S17_Handle_t *dev, uint16_t mask, uint16_t bits);
+void MCP_Flush(MCP23S17_Handle_t *dev);
+void MCP_FlushGroup(MCP23S17_Handle_t *const *devs, uint8_t count);
+
 #endif /* INC_MCP23S17_H_ */
@@ -0,0 +1,60 @@
+/*
+ * offload.h
+ *
+ *  Created on: Mar 6, 2026
+ *      Author: BioFET Team
+ *
+ *  Flash -> UART transfer for READ_FLASH, run in steps from the main loop.
+ *  Each step reads the next chunk of the log with SPI1 RX DMA and queues it
+ *  on the UART TX bulk lane (uart_tx.h), which USART1 TX DMA drains in the
+ *  background. Steps only happen while the lane has room, so a dump runs
+ *  at link speed without stalling the rest of the firmware.
+ *  Data is read by log position, skipping the FlashLog sector headers.
+ *
+ *  Raw mode (plain text READ_FLASH) reads straight into the lane. Framed
+ *  mode (frame.h) sends FRAME_BEGIN with the length as its first step, then
+ *  FRAME_DATA frames tagged with their byte offset
+ *  and keeps at most OFFLOAD_WINDOW bytes unacknowledged. The host ACKs
+ *  the offset it has received up to; a NAK, or no progress for
+ *  OFFLOAD_ACK_TIMEOUT_MS, goes back to the first missing byte
+ *  (go-back-N), re-reading it from flash. FRAME_END follows once every
+ *  byte is acknowledged.
+ */
+
+#ifndef INC_OFFLOAD_H_
+#define INC_OFFLOAD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+#define OFFLOAD_STEP_SIZE 256  // Most bytes read per step (raw mode)
+#define OFFLOAD_MIN_STEP 64    // Wait for this much lane room (or the rest)
+#define OFFLOAD_FRAME_DATA 240 // Log bytes per FRAME_DATA (offset first)
+#define OFFLOAD_WINDOW 4096    // Unacknowledged bytes in flight
+#define OFFLOAD_ACK_TIMEOUT_MS 500
+#define OFFLOAD_MAX_RETRIES 8 // Timeouts in a row before giving up
+
+typedef enum {
+  OFFLOAD_DONE,     // Nothing to do (finished or never started)
+  OFFLOAD_BUSY,     // Call again
+  OFFLOAD_FINISHED, // Last byte queued (raw) or acknowledged (framed)
+  OFFLOAD_ABORTED   // Framed: the host stopped acknowledging
+} Offload_Status_t;
+
+// Function Prototypes
+void Offload_Start(uint32_t seq, uint16_t offset, uint32_t len,
+                   uint8_t framed);
+Offload_Status_t Offload_Service(void); // Call from the main loop
+uint8_t Offload_Active(void);
+uint8_t Offload_Framed(void); // Mode of the current or last transfer
+void Offload_OnAck(uint32_t offset); // FRAME_ACK received
+void Offload_OnNak(uint32_t offset); // FRAME_NAK received
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_OFFLOAD_H_ */
@@ -0,0 +1,84 @@
+/*
+ * perf.h
+ *
+ *  Created on: Apr 14, 2026
+ *      Author: BioFET Team
+ *
+ *  Hot-path cycle counting on the Cortex-M4 DWT cycle counter. A zone is
+ *  a stretch of main-loop code between PERF_BEGIN(zone) and PERF_END(zone)
+ *  in the same block; every pass adds its length in core cycles to the
+ *  zone's count, min, max and total. Zones may nest (a DAC write inside a
+ *  command), each one counts its own inclusive time.
+ *
+ *  Recording is not interrupt safe, so zones belong in main-loop code
+ *  only. Time spent in interrupts while a zone is open is counted in it.
+ *  CYCCNT wraps after 2^32 cycles (51 s at 84 MHz); longer passes are
+ *  counted short.
+ *
+ *  With BIOFET_PERF set to 0 the macros expand to nothing and PROFILE
+ *  answers with an error.
+ */
+
+#ifndef INC_PERF_H_
+#define INC_PERF_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+#ifndef BIOFET_PERF
+#define BIOFET_PERF 1 // 0 compiles the zones out
+#endif
+
+typedef enum {
+  PERF_ZONE_COMMAND,    // One command line or frame from the host
+  PERF_ZONE_LOG,        // Encoding and appending pending samples
+  PERF_ZONE_FLASH,      // Flash job queue and log pre-erase steps
+  PERF_ZONE_FLASH_WAIT, // Blocking waits for the flash BUSY bit
+  PERF_ZONE_DAC,        // DAC frame writes, CS included
+  PERF_ZONE_EXPANDER,   // MCP23S17 register writes
+  PERF_ZONE_UART,       // Queueing responses for TX DMA
+  PERF_ZONE_COUNT
+} Perf_Zone_t;
+
+typedef struct {
+  uint32_t Count;
+  uint32_t MinCycles;
+  uint32_t MaxCycles;
+  uint64_t TotalCycles;
+} Perf_Stats_t;
+
+extern Perf_Stats_t g_PerfStats[PERF_ZONE_COUNT];
+
+#if BIOFET_PERF
+#define PERF_BEGIN(zone) const uint32_t perf_start_##zone = DWT->CYCCNT
+#define PERF_END(zone) Perf_Record(zone, DWT->CYCCNT - perf_start_##zone)
+#else
+#define PERF_BEGIN(zone) ((void)0)
+#define PERF_END(zone) ((void)0)
+#endif
+
+// Inline so a zone costs two counter reads and a few compares
+static inline void Perf_Record(Perf_Zone_t zone, uint32_t cycles) {
+  Perf_Stats_t *st = &g_PerfStats[zone];
+  st->Count++;
+  st->TotalCycles += cycles;
+  if (cycles < st->MinCycles)
+    st->MinCycles = cycles;
+  if (cycles > st->MaxCycles)
+    st->MaxCycles = cycles;
+}
+
+// Function Prototypes
+void Perf_Init(void);  // Starts CYCCNT and clears the zones
+void Perf_Reset(void);
+const char *Perf_ZoneName(Perf_Zone_t zone);
+uint32_t Perf_CyclesToUs(uint32_t cycles); // At the running core clock
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_PERF_H_ */
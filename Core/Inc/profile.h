@@ -0,0 +1,91 @@
+/*
+ * profile.h
+ *
+ *  Created on: Mar 20, 2026
+ *      Author: BioFET Team
+ *
+ *  Sweep profiles for test type 3: a list of up to PROFILE_MAX_SEGMENTS
+ *  segments (ramp, staircase, hold, pulse train), optionally repeated as a
+ *  whole for cyclic sweeps. A triangle is two ramps, cyclic voltammetry is
+ *  three ramps with Cycles > 1.
+ *
+ *  Setpoints are generated one step at a time from the timer ISR (as a
+ *  waveform.h source), so no sample table is needed however long the
+ *  profile runs. The profile is stored in the config sector behind
+ *  BioFET_Config_t and saved with SAVE_CONFIG.
+ */
+
+#ifndef INC_PROFILE_H_
+#define INC_PROFILE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "waveform.h"
+#include "w25q32.h"
+
+#define PROFILE_MAGIC 0x31465250 // "PRF1" in flash byte order
+#define PROFILE_MAX_SEGMENTS 16
+#define PROFILE_ADDR_START (CONFIG_ADDR_START + FLASH_PAGE_SIZE)
+#define PROFILE_MAX_SEGMENT_MS 3600000 // Keeps every step within TIM2 range
+
+// Segment types
+#define PROF_SEG_RAMP 'R'  // Linear V1 -> V2, one DAC code per step
+#define PROF_SEG_STAIR 'S' // Param equal steps from V1 to V2
+#define PROF_SEG_HOLD 'H'  // V1 for the whole duration
+#define PROF_SEG_PULSE 'P' // V2 for Param ms, then V1 for the rest
+
+// Profile channel
+#define PROF_CH_HV 0 // 0 to 10V DAC
+#define PROF_CH_LV 1 // -1 to +1V DAC
+
+// One segment (16 bytes)
+typedef struct {
+  uint8_t Type;        // PROF_SEG_*
+  uint8_t Reserved;
+  uint16_t Repeat;     // Times the segment is played in a row (>= 1)
+  int16_t V1Mv;        // Start / base level
+  int16_t V2Mv;        // End / pulse level
+  uint32_t DurationMs; // Length of one repetition
+  uint16_t Param;      // Staircase steps, or pulse width in ms
+  uint16_t Reserved2;
+} Profile_Segment_t;
+
+typedef struct {
+  uint32_t Magic;    // PROFILE_MAGIC
+  uint8_t Count;     // Segments used
+  uint8_t Channel;   // PROF_CH_*
+  uint16_t Cycles;   // Times the whole list is played (>= 1)
+  Profile_Segment_t Segment[PROFILE_MAX_SEGMENTS];
+} Profile_t;
+
+// Playback position, owned by the waveform ISR while running
+typedef struct {
+  const Profile_t *prof;
+  const DAC_Channel_t *ch;
+  uint16_t cycle;
+  uint8_t seg;
+  uint16_t rep;
+  uint32_t step;  // Next step within the repetition
+  uint32_t steps; // Steps in the repetition
+  uint64_t dur_us;
+  int32_t c0, c1; // Segment end codes
+  uint8_t done;
+} Profile_Cursor_t;
+
+// Function Prototypes
+void Profile_Clear(Profile_t *prof);
+uint8_t Profile_AddSegment(Profile_t *prof,
+                           const Profile_Segment_t *seg); // 0 = invalid
+uint32_t Profile_DurationMs(const Profile_t *prof); // Saturates
+void Profile_Save(const Profile_t *prof); // Sector erased by SaveConfig
+uint8_t Profile_Load(Profile_t *prof);    // Returns 0 if none stored
+uint8_t Profile_Start(const Profile_t *prof, Profile_Cursor_t *cur,
+                      DAC_Channel_t *ch); // Starts the waveform timer
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_PROFILE_H_ */
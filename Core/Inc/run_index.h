@@ -0,0 +1,66 @@
+/*
+ * run_index.h
+ *
+ *  Created on: Mar 11, 2026
+ *      Author: BioFET Team
+ *
+ *  Persistent directory of test runs, kept in the RUNDIR sector next to
+ *  the config sector. Each run gets one 32-byte entry written at START;
+ *  its Length field is left erased (0xFFFFFFFF) and programmed when the run
+ *  ends, so offload knows exactly how many bytes to send and the next run
+ *  can be appended straight after it, even across reboots.
+ *
+ *  Runs live in the FlashLog sector ring (flash_log.h) and are addressed by
+ *  log position. A run stays listed until the ring wraps over its first
+ *  sector. CLEAR writes a marker entry that hides every earlier run; the
+ *  sectors themselves are reclaimed lazily as the ring comes round.
+ */
+
+#ifndef INC_RUN_INDEX_H_
+#define INC_RUN_INDEX_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "w25q32.h"
+
+#define RUN_ENTRY_MAGIC 0x324E5552 // "RUN2" in flash byte order
+#define RUN_CLEAR_MAGIC 0x32524C43 // "CLR2": hides all earlier runs
+#define RUN_HEAD_MAGIC 0x32444548  // "HED2": log head after compaction
+#define RUN_LENGTH_OPEN 0xFFFFFFFF // Length of a run that has not ended
+#define RUN_MAX_ENTRIES (FLASH_SECTOR_SIZE / sizeof(RunEntry_t))
+#define RUN_KEEP_ENTRIES 32 // Newest runs kept when the directory fills
+
+typedef struct {
+  uint32_t Magic;          // RUN_ENTRY_MAGIC, RUN_CLEAR_MAGIC, RUN_HEAD_MAGIC
+  uint16_t RunId;          // Increments with every run
+  uint8_t TestType;        // g_TestType at start
+  uint8_t Reserved0;
+  uint32_t StartSeq;       // Log sector holding the run header
+  uint16_t StartOffset;    // Payload offset of the run header in it
+  uint16_t Reserved1;
+  uint32_t SamplePeriodUs; // Log interval
+  float RunTimeMinutes;    // Configured duration (type 2)
+  uint32_t Length;         // Bytes logged, RUN_LENGTH_OPEN while running
+  uint32_t Reserved2;
+} RunEntry_t;
+
+// Function Prototypes
+void RunIndex_Init(void); // Load directory, close a run cut by power loss
+uint16_t RunIndex_Begin(uint8_t test_type, float run_time_minutes,
+                        uint32_t sample_period_us); // Returns the run id
+void RunIndex_End(uint32_t length);
+void RunIndex_Clear(void); // Hide all runs, instant
+void RunIndex_Head(uint32_t *seq, uint16_t *offset); // Next append position
+uint8_t RunIndex_Next(uint16_t *cursor, RunEntry_t *entry); // Start at 0
+uint16_t RunIndex_Count(void);
+uint8_t RunIndex_Get(uint16_t index, RunEntry_t *entry); // 0 = oldest
+uint8_t RunIndex_Find(uint16_t run_id, RunEntry_t *entry);
+uint8_t RunIndex_Latest(RunEntry_t *entry); // Returns 0 if no runs
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_RUN_INDEX_H_ */
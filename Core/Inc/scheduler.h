@@ -0,0 +1,61 @@
+/*
+ * scheduler.h
+ *
+ *  Created on: Apr 9, 2026
+ *      Author: BioFET Team
+ *
+ *  Cooperative fixed-period task scheduler for the main loop. The 1 ms
+ *  SysTick interrupt calls Sched_OnTick(), which releases every task whose
+ *  period has elapsed. Sched_Run() never returns: it runs the released
+ *  task with the highest priority (lowest index in the table), then looks
+ *  again, and sleeps in WFI when nothing is released. Tasks run to
+ *  completion and must not block, so a task is late by at most the longest
+ *  run of the tasks around it.
+ *
+ *  Per task the scheduler measures the time from release to start
+ *  (lateness, i.e. jitter) and the run time, both in us. A task released
+ *  again before its previous release ran counts an overrun; that release
+ *  is dropped rather than queued, so the task never runs twice in a row
+ *  to catch up.
+ */
+
+#ifndef INC_SCHEDULER_H_
+#define INC_SCHEDULER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define SCHED_MAX_TASKS 8
+
+typedef struct {
+  const char *Name;
+  void (*Run)(void);
+  uint16_t PeriodMs; // 1 = every tick
+} Sched_Task_t;
+
+typedef struct {
+  uint32_t Runs;
+  uint32_t Overruns;  // Releases dropped because the last one had not run
+  uint32_t MaxLateUs; // Longest release to start
+  uint32_t MaxRunUs;  // Longest run
+  uint32_t TotalRunUs;
+} Sched_Stats_t;
+
+// Function Prototypes
+void Sched_Init(const Sched_Task_t *tasks, uint8_t count); // By priority
+void Sched_Run(void);    // Does not return
+void Sched_OnTick(void); // From the 1 ms SysTick interrupt
+uint8_t Sched_TaskCount(void);
+const Sched_Task_t *Sched_Task(uint8_t index);
+void Sched_GetStats(uint8_t index, Sched_Stats_t *stats);
+void Sched_ResetStats(void);
+uint32_t Sched_Micros(void); // Free-running us clock, wraps after 71 min
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_SCHEDULER_H_ */
@@ -0,0 +1,136 @@
+/*
+ * spi_bus.h
+ *
+ *  Created on: Mar 18, 2026
+ *      Author: BioFET Team
+ *
+ *  Arbiter for the shared SPI1 bus (expanders, flash, bias DACs, ADCs).
+ *  Every transaction is described by SpiBus_Xfer_t: the device, which sets
+ *  the SCK rate and SPI mode, an optional native chip select, and the
+ *  tx/rx buffers. A CS cycle made of several phases (command, then data)
+ *  is a chain of descriptors, all but the last flagged SPI_XFER_KEEP_CS.
+ *  There are three ways onto the bus:
+ *
+ *  - SpiBus_Submit() queues a chain for DMA and returns. The queue runs
+ *    from the SPI DMA interrupt, one descriptor after the other, and calls
+ *    each Done callback there. Used for bulk flash traffic.
+ *  - SpiBus_Transfer() runs a chain blocking, from the main loop. It waits
+ *    for the queue to drain and claims the bus meanwhile. Used for short
+ *    frames (expander latches, DAC words, flash status), where setting up
+ *    a DMA transfer costs more than the frame.
+ *  - SpiBus_RunHigh() is the high-priority lane for interrupt handlers
+ *    (ADC bursts). The job runs at once if the bus is idle; otherwise it
+ *    runs as soon as the current owner lets go, before the next queued
+ *    descriptor starts. It never preempts a CS cycle in progress.
+ *
+ *  The bus is owned while a ChipSel_t is asserted or a blocking transfer
+ *  runs (claims), and while a queued chain is between its first and last
+ *  descriptor. SpiBus_Claim() waits for a queued chain to finish, so an
+ *  ISR may only call it (or assert a ChipSel_t) after SpiBus_Idle().
+ *
+ *  Each device is clocked at its own limit. SpiBus_Init() turns the
+ *  SPI_*_MAX_HZ limits into SPI1 prescalers for the running system clock,
+ *  and every transaction calls SpiBus_Select() for its device once it owns
+ *  the bus and before its native CS falls. The register-level ISR paths
+ *  select their own device too.
+ */
+
+#ifndef INC_SPI_BUS_H_
+#define INC_SPI_BUS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+// Fastest SCK each device on SPI1 accepts. SPI1 itself stops at PCLK2 / 2.
+#define SPI_EXPANDER_MAX_HZ 10000000 // MCP23S17
+#define SPI_FLASH_MAX_HZ 50000000    // W25Q32, limit of Read Data (0x03)
+#define SPI_DAC_MAX_HZ 20000000      // MCP4921-style bias DACs
+#define SPI_ADC_MAX_HZ 10000000      // USER: Limit of the fitted FET ADCs
+
+#define SPI_BUS_QUEUE_LEN 8   // Queued descriptors
+#define SPI_BUS_TIMEOUT_MS 10 // Blocking transfers, plus 1ms per 16 bytes
+
+// Descriptor flags
+#define SPI_XFER_KEEP_CS 0x01 // The next descriptor continues this CS cycle
+
+typedef enum {
+  SPI_DEV_EXPANDER,
+  SPI_DEV_FLASH,
+  SPI_DEV_DAC,
+  SPI_DEV_ADC, // Acquisition burst, including its expander latch writes
+  SPI_DEV_COUNT
+} SpiBus_Dev_t;
+
+typedef enum {
+  SPI_HIGH_RAN,      // Job ran before SpiBus_RunHigh returned
+  SPI_HIGH_DEFERRED, // Job runs when the current owner releases the bus
+  SPI_HIGH_BUSY      // Another job is already waiting, nothing queued
+} SpiBus_High_t;
+
+// ok is 0 if the phase or an earlier one of its CS cycle failed
+typedef void (*SpiBus_Done_t)(void *ctx, uint8_t ok);
+typedef void (*SpiBus_Job_t)(void);
+
+// One phase of a CS cycle
+typedef struct {
+  SpiBus_Dev_t Dev;     // SCK rate and mode
+  GPIO_TypeDef *CsPort; // Native CS, or NULL when the caller drives it
+  uint16_t CsPin;       // GPIO_PIN_x mask
+  const uint8_t *Tx;    // NULL clocks out whatever Rx holds
+  uint8_t *Rx;          // NULL discards the received bytes
+  uint16_t Len;
+  uint8_t Flags;      // SPI_XFER_*
+  SpiBus_Done_t Done; // Queued chains only, called from the DMA interrupt
+  void *Ctx;
+} SpiBus_Xfer_t;
+
+extern volatile uint8_t g_SpiBusClaims; // Asserted ChipSel_t count
+extern volatile uint8_t g_SpiBusActive; // A queued chain owns the bus
+extern uint16_t g_SpiBusCr1[SPI_DEV_COUNT]; // CR1 BR, CPOL, CPHA per device
+
+/*
+ * Sets the SCK rate and mode for dev. Only the bus owner may call it. Both
+ * may only change while the SPI is disabled and not busy; the HAL and the
+ * register-level paths both expect it enabled again afterwards.
+ */
+static inline void SpiBus_Select(SPI_HandleTypeDef *hspi, SpiBus_Dev_t dev) {
+  const uint32_t mask = SPI_CR1_BR | SPI_CR1_CPOL | SPI_CR1_CPHA;
+  SPI_TypeDef *spi = hspi->Instance;
+  uint32_t cr1 = g_SpiBusCr1[dev];
+
+  if ((spi->CR1 & mask) == cr1)
+    return;
+  while (spi->SR & SPI_SR_BSY) {
+  }
+  spi->CR1 &= ~SPI_CR1_SPE;
+  spi->CR1 = (spi->CR1 & ~mask) | cr1 | SPI_CR1_SPE;
+  hspi->Init.BaudRatePrescaler = cr1 & SPI_CR1_BR;
+  hspi->Init.CLKPolarity = cr1 & SPI_CR1_CPOL;
+  hspi->Init.CLKPhase = cr1 & SPI_CR1_CPHA;
+}
+
+// Function Prototypes
+void SpiBus_Init(SPI_HandleTypeDef *hspi); // After SystemClock_Config()
+uint32_t SpiBus_Hz(SpiBus_Dev_t dev); // SCK rate dev is clocked at
+uint8_t SpiBus_Idle(SPI_HandleTypeDef *hspi); // Safe to use from an ISR
+void SpiBus_Claim(void);   // Waits for a queued chain to finish
+void SpiBus_Unclaim(void); // Runs a deferred job, restarts the queue
+
+HAL_StatusTypeDef SpiBus_Transfer(const SpiBus_Xfer_t *xfers,
+                                  uint8_t n); // Blocking, main loop only
+uint8_t SpiBus_Submit(const SpiBus_Xfer_t *xfers,
+                      uint8_t n); // Queues all n or none, returns 0 if full
+
+SpiBus_High_t SpiBus_RunHigh(SpiBus_Job_t job); // From an ISR
+uint8_t SpiBus_CancelHigh(void); // 0 if no deferred job was waiting
+void SpiBus_OnComplete(SPI_HandleTypeDef *hspi); // HAL SPI callbacks
+void SpiBus_OnError(SPI_HandleTypeDef *hspi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_SPI_BUS_H_ */
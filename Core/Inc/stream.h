@@ -0,0 +1,64 @@
+/*
+ * stream.h
+ *
+ *  Created on: Apr 2, 2026
+ *      Author: BioFET Team
+ *
+ *  Live telemetry: pushes acquired samples to the host as they come in,
+ *  alongside (not instead of) the flash log. The stream has its own
+ *  Acq_Reader_t, so it never takes samples away from the logger.
+ *
+ *  Every Nth output sample is sent, N chosen so the stream runs at about
+ *  the requested rate (all samples if it is at or above the sample rate).
+ *  Samples are batched into FRAME_SAMPLES frames on the UART TX bulk
+ *  lane, sent when a frame is full or STREAM_FLUSH_MS after its first
+ *  sample. Currents are scaled on the device, so the host needs no range
+ *  table.
+ *
+ *  When the link cannot keep up, or a READ_FLASH offload holds the bulk
+ *  lane, the batch is dropped, never waited for.
+ *  Samples lost that way, or overwritten in the acquisition ring before
+ *  the stream read them, are counted; each frame carries the running
+ *  count so the host sees gaps.
+ */
+
+#ifndef INC_STREAM_H_
+#define INC_STREAM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "acquisition.h"
+
+#define STREAM_MAX_HZ 1000
+#define STREAM_FLUSH_MS 50 // Longest a sample waits for its frame to fill
+#define STREAM_BATCH 9     // Records per frame (fits FRAME_DATA_MAX)
+
+// Start of every FRAME_SAMPLES payload (frame.h) (8 bytes)
+typedef struct {
+  uint32_t Dropped;  // Samples not sent since STREAM started
+  uint32_t PeriodUs; // Time between ticks (acquisition output period)
+} Stream_Header_t;
+
+// One streamed sample (24 bytes)
+typedef struct {
+  uint32_t Tick;   // Acquisition output number
+  int16_t DacMv;   // Bias DAC setpoint
+  uint16_t Ranges; // Range tag per FET, as in the log
+  int32_t CurrentPa[ACQ_CHANNELS]; // 0 while the range was switching
+} Stream_Record_t;
+
+// Function Prototypes
+void Stream_Start(uint16_t hz);
+void Stream_Stop(void);
+uint8_t Stream_Active(void);
+void Stream_Service(const DAC_Channel_t *bias); // Call from the main loop
+uint32_t Stream_Sent(void);
+uint32_t Stream_Dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_STREAM_H_ */
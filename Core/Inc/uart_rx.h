@@ -0,0 +1,56 @@
+/*
+ * uart_rx.h
+ *
+ *  Created on: Mar 26, 2026
+ *      Author: BioFET Team
+ *
+ *  Command reception on USART1 without polling. RX DMA runs in circular
+ *  mode into a ring; the HAL RX event callback (IDLE line, half and full
+ *  buffer) hands over the new bytes, which are split into lines at
+ *  '\r' / '\n' right there and queued. The main loop takes complete lines
+ *  with UartRx_GetLine() and parses them outside the interrupt, so input
+ *  keeps flowing at full line rate while the loop is busy with a test,
+ *  a flash erase or a blocking transfer.
+ *
+ *  Binary frames (frame.h) are delimited by 0x00 bytes and queued in the
+ *  same order as the lines; the main loop decodes them.
+ *
+ *  Lines longer than UART_RX_LINE_MAX - 1 characters, frames longer than
+ *  UART_RX_FRAME_MAX bytes, and anything arriving while the queue is full,
+ *  are dropped whole and counted.
+ */
+
+#ifndef INC_UART_RX_H_
+#define INC_UART_RX_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+#define UART_RX_DMA_SIZE 256  // Circular DMA ring, bytes
+#define UART_RX_LINE_MAX 160  // Longest command line, with the terminator
+#define UART_RX_FRAME_MAX 176 // Longest encoded frame, without delimiters
+#define UART_RX_QUEUE_LEN 8   // Lines and frames waiting for the main loop
+
+// What UartRx_Get() returned
+#define UART_RX_NONE 0
+#define UART_RX_LINE 1
+#define UART_RX_FRAME 2
+
+// Function Prototypes
+void UartRx_Init(UART_HandleTypeDef *huart); // RX DMA linked already
+void UartRx_Stop(void);
+void UartRx_Restart(void);
+uint8_t UartRx_Get(uint8_t *buf, uint16_t size,
+                   uint16_t *len); // UART_RX_NONE if nothing is queued
+uint32_t UartRx_Dropped(void); // Lines lost to overflow or queue full
+void UartRx_OnEvent(UART_HandleTypeDef *huart, uint16_t pos); // ISR
+void UartRx_OnError(UART_HandleTypeDef *huart);               // ISR
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_UART_RX_H_ */
@@ -0,0 +1,70 @@
+/*
+ * uart_tx.h
+ *
+ *  Created on: Mar 27, 2026
+ *      Author: BioFET Team
+ *
+ *  Non-blocking USART1 output. Producers copy into one of two ring
+ *  buffers (lanes) and return; USART1 TX DMA drains them in the
+ *  background, restarting from the TX complete interrupt.
+ *
+ *  The control lane (command responses, status) always goes first. Bulk
+ *  data (flash dumps, streaming) is sent in chunks of at most
+ *  UART_TX_BULK_CHUNK bytes, so a response waits for one chunk at most.
+ *
+ *  Each write or commit is a unit that is never split by bytes of the
+ *  other lane, so a frame (frame.h) always goes out whole; a DMA transfer
+ *  ends on a unit boundary wherever the chunk limit allows.
+ *
+ *  A full lane is reported to the producer (UartTx_Write() returns 0,
+ *  UartTx_Room()), which decides whether to retry, wait or drop. Bulk
+ *  producers can also fill the ring in place with Reserve/Commit.
+ *
+ *  Raw (unframed) bulk transfers must not be split by text responses:
+ *  control bytes queued after UartTx_HoldCtrl() wait until
+ *  UartTx_ReleaseCtrl() and the bulk bytes queued before it have gone out.
+ *  Those queued before the hold still go first.
+ */
+
+#ifndef INC_UART_TX_H_
+#define INC_UART_TX_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+#define UART_TX_CTRL_SIZE 1024 // Bytes, power of two
+#define UART_TX_BULK_SIZE 2048 // Bytes, power of two
+#define UART_TX_BULK_CHUNK 256 // Longest DMA transfer from the bulk lane
+
+typedef enum {
+  UART_TX_CTRL, // Responses, status: sent first
+  UART_TX_BULK, // Data
+  UART_TX_LANES
+} UartTx_Lane_t;
+
+// Function Prototypes
+void UartTx_Init(UART_HandleTypeDef *huart); // TX DMA linked already
+uint8_t UartTx_Write(UartTx_Lane_t lane, const void *data,
+                     uint16_t len); // All or nothing, 0 = no room
+void UartTx_WriteWait(UartTx_Lane_t lane, const void *data,
+                      uint16_t len); // Waits for room (bulk lane only)
+uint16_t UartTx_Room(UartTx_Lane_t lane);
+uint16_t UartTx_Reserve(UartTx_Lane_t lane,
+                        uint8_t **ptr); // Contiguous free bytes at *ptr
+void UartTx_Commit(UartTx_Lane_t lane, uint16_t len);
+void UartTx_HoldCtrl(void);
+void UartTx_ReleaseCtrl(void);
+uint8_t UartTx_CtrlHeld(void);
+uint8_t UartTx_Idle(void); // Everything queued has been sent
+void UartTx_Flush(void);   // Waits until idle
+void UartTx_OnTxComplete(UART_HandleTypeDef *huart); // ISR
+void UartTx_OnError(UART_HandleTypeDef *huart);      // ISR
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_UART_TX_H_ */
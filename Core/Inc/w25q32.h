@@ -22,15 +22,8 @@ extern "C" {
 extern SPI_HandleTypeDef hspi1;
 #define W25Q_SPI_HANDLE &hspi1
 
-// DEFINE THIS PIN IN MAIN.H or IOC
-// For now, we define default placeholders. Valid pin must be set in main.c
-// MX_GPIO_Init
-#ifndef FLASH_CS_GPIO_Port
-#define FLASH_CS_GPIO_Port GPIOB
-#endif
-#ifndef FLASH_CS_Pin
-#define FLASH_CS_Pin GPIO_PIN_0 // Example placeholder
-#endif
+// FLASH_CS_Pin / FLASH_CS_GPIO_Port are defined in main.h. All transfers go
+// through the SPI bus arbiter (spi_bus.h), which drives the CS.
 
 // ============================================================================
 // MEMORY MAP
@@ -40,14 +33,21 @@ extern SPI_HandleTypeDef hspi1;
 // 1024 Sectors of 4KB
 // Pages of 256 Bytes
 
+#define FLASH_TOTAL_SIZE 0x400000
 #define FLASH_SECTOR_SIZE 4096
+#define FLASH_BLOCK_SIZE 0x10000 // 64KB, 16 sectors
 #define FLASH_PAGE_SIZE 256
 
+#define W25Q_PROGRAM_RETRIES 2 // Extra attempts after an SPI/DMA error
+
 // CONFIG_SECTOR: Sector 0 for storing Settings (Type, Duration)
 #define CONFIG_ADDR_START 0x000000
 
-// DATA_START_SECTOR: Sector 1 start for Test Data
-#define DATA_ADDR_START 0x001000
+// RUNDIR_SECTOR: Sector 1 holds the run directory (see run_index.h)
+#define RUNDIR_ADDR_START 0x001000
+
+// DATA_START_SECTOR: Sector 2 start for Test Data
+#define DATA_ADDR_START 0x002000
 
 // ============================================================================
 // COMMANDS
@@ -56,6 +56,7 @@ extern SPI_HandleTypeDef hspi1;
 #define CMD_WRITE_DISABLE 0x04
 #define CMD_READ_STATUS_1 0x05
 #define CMD_READ_DATA 0x03
+#define CMD_FAST_READ 0x0B // Needs one dummy byte after the address
 #define CMD_PAGE_PROGRAM 0x02
 #define CMD_SECTOR_ERASE 0x20 // 4KB
 #define CMD_BLOCK_ERASE 0xD8  // 64KB
@@ -79,9 +80,27 @@ void W25Q_Reset(void);
 uint32_t W25Q_ReadID(void);
 void W25Q_EraseSector(uint32_t address);
 void W25Q_EraseChip(void);
-void W25Q_Write(uint8_t *pData, uint32_t writeAddr, uint32_t size);
+void W25Q_Write(uint8_t *pData, uint32_t writeAddr,
+                uint32_t size); // Splits at 256-byte page boundaries
 void W25Q_Read(uint8_t *pBuffer, uint32_t readAddr, uint32_t size);
 
+// Non-blocking primitives (see w25q_async.h for the job queue built on them)
+uint8_t W25Q_IsBusy(void); // Returns 1 while a program/erase is running
+void W25Q_StartEraseSector(uint32_t address);
+void W25Q_StartEraseBlock(uint32_t address); // 64KB, must be block aligned
+void W25Q_StartEraseChip(void);
+// Must not cross a page. Queued for DMA, so pData is read after the call
+// returns: keep it unchanged until W25Q_IsBusy() returns 0.
+void W25Q_StartPageProgram(const uint8_t *pData, uint32_t writeAddr,
+                           uint32_t size);
+uint8_t W25Q_ProgramFailed(void); // Last program lost to an SPI/DMA error
+
+// DMA bulk read (Fast Read 0x0B), queued on the SPI bus. Poll
+// W25Q_ReadDMAComplete(); the bus releases CS when the data is in.
+HAL_StatusTypeDef W25Q_ReadDMA(uint8_t *pBuffer, uint32_t readAddr,
+                               uint16_t size);
+uint8_t W25Q_ReadDMAComplete(void);
+
 // Helpers
 void W25Q_SaveConfig(BioFET_Config_t *cfg);
 uint8_t W25Q_LoadConfig(BioFET_Config_t *cfg); // Returns 1 if valid, 0 if empty
@@ -0,0 +1,54 @@
+/*
+ * w25q_async.h
+ *
+ *  Created on: Mar 4, 2026
+ *      Author: BioFET Team
+ *
+ *  Non-blocking job queue for W25Q32 program/erase operations.
+ *  Jobs are submitted from application code and stepped by calling
+ *  W25Q_AsyncProcess() from the main loop. A step never waits on the BUSY
+ *  bit: it reads the status register once and either starts the next job or
+ *  returns, so a 20 s chip erase no longer stalls DAC updates or UART.
+ */
+
+#ifndef INC_W25Q_ASYNC_H_
+#define INC_W25Q_ASYNC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "w25q32.h"
+
+#define W25Q_ASYNC_QUEUE_LEN 8
+
+typedef enum {
+  W25Q_JOB_PROGRAM,      // Page program, must not cross a page boundary
+  W25Q_JOB_ERASE_SECTOR, // 4KB sector erase
+  W25Q_JOB_ERASE_BLOCK,  // 64KB block erase, addr must be block aligned
+  W25Q_JOB_ERASE_CHIP    // Whole chip (tens of seconds)
+} W25Q_JobType_t;
+
+// ok is 0 if a PROGRAM job still failed after W25Q_PROGRAM_RETRIES
+typedef void (*W25Q_JobCallback_t)(void *ctx, uint8_t ok);
+
+typedef struct {
+  W25Q_JobType_t type;
+  uint32_t addr;
+  const uint8_t *data;     // PROGRAM only; must stay valid until done()
+  uint16_t len;            // PROGRAM only
+  W25Q_JobCallback_t done; // Optional, called from W25Q_AsyncProcess()
+  void *ctx;
+} W25Q_Job_t;
+
+// Function Prototypes
+uint8_t W25Q_AsyncSubmit(const W25Q_Job_t *job); // Returns 0 if queue full
+void W25Q_AsyncProcess(void); // Step the engine, call from the main loop
+uint8_t W25Q_AsyncIdle(void); // 1 when no job is queued or running
+void W25Q_AsyncDrain(void);   // Blocking: step until idle
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_W25Q_ASYNC_H_ */
@@ -0,0 +1,60 @@
+/*
+ * waveform.h
+ *
+ *  Created on: Mar 18, 2026
+ *      Author: BioFET Team
+ *
+ *  Timer-paced DAC waveform playback. Steps come from a source callback
+ *  that returns the next DAC frame and how long to hold it; a hardware
+ *  timer at 1 MHz ends each step, so step timing no longer depends on how
+ *  long the main loop takes. The built-in source plays a ramp precomputed
+ *  into a table of ready-to-send frames (at most one entry per DAC code);
+ *  profile.h generates multi-segment sweeps on the fly instead.
+ *
+ *  With a native DAC chip select the timer ISR writes each frame itself
+ *  if the SPI bus is idle (spi_bus.h). Otherwise (busy bus, or CS on an
+ *  expander) the step is marked pending and Waveform_Service() writes the
+ *  newest frame from the main loop.
+ *
+ *  With the default expander chip selects (DAC_NATIVE_CS = 0) every step
+ *  takes that path, so each step reaches the DAC up to one ControlTask
+ *  period (1 ms) late. A step that ends before it was written is skipped
+ *  and counted by Waveform_Skipped(); keep steps well above 1 ms there.
+ */
+
+#ifndef INC_WAVEFORM_H_
+#define INC_WAVEFORM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "dac.h"
+
+#define WAVE_TABLE_LEN 4096      // One entry per code of a full-scale ramp
+#define WAVE_TIMER_HZ 1000000    // Timer tick, period unit is 1us
+#define WAVE_MIN_PERIOD_US 20    // Shortest step the ISR is given
+
+// Returns 0 when there are no more steps. Called from the timer ISR.
+typedef uint8_t (*Waveform_Source_t)(void *ctx, uint16_t *frame,
+                                     uint32_t *hold_us);
+
+// Function Prototypes
+void Waveform_Init(TIM_HandleTypeDef *htim); // Timer already at 1 MHz
+uint8_t Waveform_LoadRamp(DAC_Channel_t *ch, int32_t start_mv,
+                          int32_t end_mv, uint32_t duration_ms);
+void Waveform_Start(void); // Play the loaded ramp
+uint8_t Waveform_StartSource(DAC_Channel_t *ch, Waveform_Source_t next,
+                             void *ctx);
+void Waveform_Stop(void);
+uint8_t Waveform_Running(void);
+uint32_t Waveform_Deferred(void); // Steps written late by the main loop
+uint32_t Waveform_Skipped(void);  // Steps replaced before they were written
+void Waveform_OnTick(void);       // From the timer update interrupt
+void Waveform_Service(void);      // Call from the main loop
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAVEFORM_H_ */
@@ -0,0 +1,302 @@
+/*
+ * acquisition.c
+ *
+ *  Created on: Mar 23, 2026
+ *      Author: BioFET Team
+ */
+
+#include "acquisition.h"
+
+_Static_assert((ACQ_RING_LEN & (ACQ_RING_LEN - 1)) == 0,
+               "ACQ_RING_LEN must be a power of two");
+
+static Acq_Sample_t acq_ring[ACQ_RING_LEN];
+static volatile uint32_t acq_head = 0; // Samples written so far
+static volatile uint32_t acq_tick = 0; // Output number
+static volatile uint32_t acq_missed = 0;
+static uint32_t acq_period_us = ACQ_DEFAULT_PERIOD_US;
+static uint8_t acq_running = 0;
+static volatile uint8_t acq_deferred = 0; // Burst waiting for the bus
+
+// Filter chain (dsp.h)
+static Dsp_Config_t acq_filter = {1, 1, 0};
+static Dsp_Channel_t acq_dsp[ACQ_CHANNELS];
+static uint16_t acq_phase = 0;  // Bursts due so far in this output
+static uint16_t acq_bursts = 0; // Bursts actually read in this output
+
+static TIM_HandleTypeDef *acq_tim = NULL;
+static SPI_HandleTypeDef *acq_spi = NULL;
+static MCP23S17_Handle_t *acq_exp = NULL;
+static const DAC_Channel_t *acq_bias = NULL;
+static volatile uint16_t acq_ranges = 0;
+static uint16_t acq_ranges_start = 0; // acq_ranges when this output began
+static uint16_t acq_ranges_prev = 0;  // ... and when the previous one began
+static uint8_t acq_latch_reg;             // OLATA or OLATB
+static uint8_t acq_latch_shift;           // 0 or 8
+static uint8_t acq_cs_mask[ACQ_CHANNELS]; // Bit of each ADC in the port
+
+void Acq_Init(TIM_HandleTypeDef *htim, SPI_HandleTypeDef *hspi,
+              MCP23S17_Handle_t *exp, const uint8_t cs_pins[ACQ_CHANNELS]) {
+  uint16_t all = 0;
+
+  acq_tim = htim;
+  acq_spi = hspi;
+  acq_exp = exp;
+  acq_latch_reg = (cs_pins[0] < 8) ? MCP_OLATA : MCP_OLATB;
+  acq_latch_shift = (cs_pins[0] < 8) ? 0 : 8;
+  for (uint8_t i = 0; i < ACQ_CHANNELS; i++) {
+    acq_cs_mask[i] = 1 << (cs_pins[i] & 7);
+    all |= 1 << cs_pins[i];
+  }
+
+  // Expander latches power up low: deselect all ADCs
+  MCP_SetBits(exp, all, all);
+  MCP_Flush(exp);
+  __HAL_TIM_SET_AUTORELOAD(acq_tim, acq_period_us / acq_filter.Osr - 1);
+}
+
+/*
+ * Applies a new output period and filter. The timer interrupt is stopped
+ * meanwhile, so the ISR never sees half of a change; the filter restarts
+ * from a clean state. The output period is rounded down to a whole number
+ * of bursts.
+ */
+static uint8_t Acq_Configure(uint32_t period_us, const Dsp_Config_t *cfg) {
+  uint32_t burst_us = period_us / cfg->Osr;
+
+  if (period_us < ACQ_MIN_PERIOD_US || burst_us < ACQ_MIN_BURST_US ||
+      !Dsp_ConfigValid(cfg))
+    return 0;
+
+  uint8_t was_running = acq_running;
+  Acq_Stop();
+  acq_period_us = burst_us * cfg->Osr;
+  acq_filter = *cfg;
+  for (uint8_t i = 0; i < ACQ_CHANNELS; i++)
+    Dsp_Reset(&acq_dsp[i]);
+  acq_phase = 0;
+  acq_bursts = 0;
+  if (acq_tim != NULL)
+    __HAL_TIM_SET_AUTORELOAD(acq_tim, burst_us - 1);
+  if (was_running)
+    Acq_Start();
+  return 1;
+}
+
+uint8_t Acq_SetPeriodUs(uint32_t period_us) {
+  return Acq_Configure(period_us, &acq_filter);
+}
+
+uint32_t Acq_PeriodUs(void) { return acq_period_us; }
+
+uint8_t Acq_SetFilter(const Dsp_Config_t *cfg) {
+  return Acq_Configure(acq_period_us, cfg);
+}
+
+void Acq_GetFilter(Dsp_Config_t *cfg) { *cfg = acq_filter; }
+
+void Acq_SetBias(const DAC_Channel_t *ch) { acq_bias = ch; }
+
+/*
+ * Called with the switching channels set to ACQ_RANGE_SWITCHING before the
+ * hardware is changed, and with the new ranges afterwards, so every output
+ * that overlaps the change sees the tag move.
+ */
+void Acq_SetRanges(uint16_t ranges) { acq_ranges = ranges; }
+
+// Tags channels whose range moved since the previous output began
+static uint16_t Acq_TagRanges(void) {
+  uint16_t now = acq_ranges;
+  uint16_t moved = (now ^ acq_ranges_start) | (now ^ acq_ranges_prev);
+  uint16_t tags = now;
+
+  for (uint8_t i = 0; i < ACQ_CHANNELS; i++) {
+    if (ACQ_RANGE_OF(moved, i) != 0)
+      tags |= ACQ_RANGE_SWITCHING << (4 * i);
+  }
+  return tags;
+}
+
+void Acq_Start(void) {
+  if (acq_tim == NULL)
+    return;
+  __HAL_TIM_SET_COUNTER(acq_tim, 0);
+  HAL_TIM_Base_Start_IT(acq_tim);
+  acq_running = 1;
+}
+
+void Acq_Stop(void) {
+  if (acq_tim != NULL)
+    HAL_TIM_Base_Stop_IT(acq_tim);
+  SpiBus_CancelHigh();
+  acq_deferred = 0;
+  acq_running = 0;
+}
+
+uint32_t Acq_Missed(void) { return acq_missed; }
+
+// ============================================================================
+// BURST (interrupt context)
+// ============================================================================
+
+// One full-duplex byte at register level
+static uint8_t Acq_Xfer(SPI_TypeDef *spi, uint8_t out) {
+  while (!(spi->SR & SPI_SR_TXE)) {
+  }
+  *(__IO uint8_t *)&spi->DR = out;
+  while (!(spi->SR & SPI_SR_RXNE)) {
+  }
+  return *(__IO uint8_t *)&spi->DR;
+}
+
+// Writes the ADC chip select latch of the expander in one 3-byte frame
+static void Acq_WriteLatch(SPI_TypeDef *spi, uint8_t value) {
+  GPIO_FAST_LOW(acq_exp->cs_port, acq_exp->cs_pin);
+  Acq_Xfer(spi, acq_exp->device_addr);
+  Acq_Xfer(spi, acq_latch_reg);
+  Acq_Xfer(spi, value);
+  while (spi->SR & SPI_SR_BSY) {
+  }
+  GPIO_FAST_HIGH(acq_exp->cs_port, acq_exp->cs_pin);
+}
+
+static int16_t Acq_Decode(const uint8_t *frame) {
+  return (int16_t)((frame[0] << 8) | frame[1]);
+}
+
+/*
+ * Reads all ADCs back to back into the filters. The latch write that
+ * selects ADC n+1 also deselects ADC n, so each ADC sees exactly one CS
+ * cycle. The other pins of the port are written with their current latch
+ * value, and the burst ends by restoring it, so the expander driver's
+ * cache stays valid.
+ */
+static void Acq_Burst(void) {
+  SPI_TypeDef *spi = acq_spi->Instance;
+  uint8_t idle = (uint8_t)(acq_exp->latched_output >> acq_latch_shift);
+  uint8_t frame[ACQ_ADC_FRAME_BYTES];
+
+  SpiBus_Claim();
+  SpiBus_Select(acq_spi, SPI_DEV_ADC);
+
+  // Drop a byte left over from a transmit-only transfer (and its OVR flag)
+  (void)spi->DR;
+  (void)spi->SR;
+
+  for (uint8_t i = 0; i < ACQ_CHANNELS; i++) {
+    Acq_WriteLatch(spi, idle & ~acq_cs_mask[i]);
+    for (uint8_t b = 0; b < ACQ_ADC_FRAME_BYTES; b++)
+      frame[b] = Acq_Xfer(spi, 0x00);
+    Dsp_Add(&acq_dsp[i], Acq_Decode(frame));
+  }
+  Acq_WriteLatch(spi, idle);
+
+  SpiBus_Unclaim();
+}
+
+// Accounts for one burst slot, read or missed, and publishes the output
+// once Osr slots are done
+static void Acq_Step(uint8_t read) {
+  if (acq_phase == 0) {
+    acq_ranges_prev = acq_ranges_start;
+    acq_ranges_start = acq_ranges;
+  }
+
+  if (read)
+    acq_bursts++;
+  else
+    acq_missed++;
+
+  if (++acq_phase < acq_filter.Osr)
+    return;
+
+  // Output complete: average what was read, run the filters, publish
+  uint32_t tick = acq_tick++;
+  uint16_t n = acq_bursts;
+  acq_phase = 0;
+  acq_bursts = 0;
+  if (n == 0)
+    return; // Whole output lost, consumers see the tick gap
+
+  Acq_Sample_t *s = &acq_ring[acq_head & (ACQ_RING_LEN - 1)];
+  s->Tick = tick;
+  s->DacCode = (acq_bias != NULL) ? acq_bias->code : 0;
+  s->Flags = (n < acq_filter.Osr) ? ACQ_FLAG_PARTIAL : 0;
+  s->Ranges = Acq_TagRanges();
+  for (uint8_t i = 0; i < ACQ_CHANNELS; i++) {
+    s->Raw[i] = Dsp_Output(&acq_dsp[i], &acq_filter, n);
+    // Median and low-pass history from another range would smear into the
+    // first valid samples of the new one
+    if (ACQ_RANGE_OF(s->Ranges, i) == ACQ_RANGE_SWITCHING)
+      Dsp_Reset(&acq_dsp[i]);
+  }
+
+  __DMB(); // Sample complete before readers can see it
+  acq_head++;
+}
+
+// High-priority bus job: runs in the tick, or as soon as the bus frees up
+static void Acq_BurstJob(void) {
+  acq_deferred = 0;
+  Acq_Burst();
+  Acq_Step(1);
+}
+
+void Acq_OnTick(void) {
+  if (acq_deferred) {
+    // Still waiting a whole period later: give that slot up, unless the
+    // job already left the lane and is about to fill it
+    if (SpiBus_CancelHigh())
+      Acq_Step(0);
+    acq_deferred = 0;
+  }
+
+  switch (SpiBus_RunHigh(Acq_BurstJob)) {
+  case SPI_HIGH_RAN:
+    break;
+  case SPI_HIGH_DEFERRED:
+    acq_deferred = 1;
+    break;
+  default:
+    Acq_Step(0);
+    break;
+  }
+}
+
+// ============================================================================
+// READERS (main loop)
+// ============================================================================
+
+/*
+ * Skips a reader to the newest sample. Every burst it reads from now on
+ * has a tick at or after the returned one (the tick is taken first, so a
+ * burst in between cannot come out earlier).
+ */
+uint32_t Acq_ReaderSync(Acq_Reader_t *reader) {
+  uint32_t tick = acq_tick;
+  reader->tail = acq_head;
+  reader->lost = 0;
+  return tick;
+}
+
+uint8_t Acq_Read(Acq_Reader_t *reader, Acq_Sample_t *sample) {
+  while (1) {
+    uint32_t head = acq_head;
+    if (reader->tail == head)
+      return 0;
+    if (head - reader->tail > ACQ_RING_LEN) {
+      reader->lost += head - reader->tail - ACQ_RING_LEN;
+      reader->tail = head - ACQ_RING_LEN;
+    }
+
+    __DMB();
+    *sample = acq_ring[reader->tail & (ACQ_RING_LEN - 1)];
+    __DMB();
+
+    // The ISR may have reused the slot while it was being copied
+    if (acq_head - reader->tail <= ACQ_RING_LEN) {
+      reader->tail++;
+      return 1;
+    }
+  }
+}
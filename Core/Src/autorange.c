@@ -0,0 +1,148 @@
+/*
+ * autorange.c
+ *
+ *  Created on: Mar 25, 2026
+ *      Author: BioFET Team
+ */
+
+#include "autorange.h"
+#include <stdlib.h>
+
+typedef struct {
+  uint8_t gain;    // 3-bit gain select code
+  uint8_t shunt;   // 3-bit shunt select code
+  uint32_t lsb_fa; // Current per ADC code
+} AutoRange_Step_t;
+
+/*
+ * USER: Fill in from the analog front end. The defaults assume decade
+ * shunts on codes 3..0 at unity gain, for 1uA to 1mA full scale on a
+ * 16-bit ADC (full scale / 32768).
+ */
+static const AutoRange_Step_t ladder[RANGE_COUNT] = {
+    {0, 3, 30518},    // 1uA
+    {0, 2, 305176},   // 10uA
+    {0, 1, 3051758},  // 100uA
+    {0, 0, 30517578}, // 1mA
+};
+
+_Static_assert(RANGE_COUNT <= ACQ_RANGE_SWITCHING,
+               "Range index must fit its 4-bit tag");
+
+static MCP23S17_Handle_t *fet_expanders[2];
+static uint8_t range[ACQ_CHANNELS];
+static uint8_t auto_mask = 0;
+static uint8_t low_count[ACQ_CHANNELS];
+static Acq_Reader_t range_reader;
+
+static uint16_t AutoRange_Tags(void) {
+  uint16_t tags = 0;
+  for (uint8_t fet = 0; fet < ACQ_CHANNELS; fet++)
+    tags |= range[fet] << (4 * fet);
+  return tags;
+}
+
+/*
+ * Switches the FETs whose wanted range differs. All changed select bits
+ * are staged first and flushed together; the acquisition ISR tags the
+ * switching channels until the new range is in place.
+ */
+static void AutoRange_Apply(const uint8_t want[ACQ_CHANNELS]) {
+  uint16_t switching = 0;
+
+  for (uint8_t fet = 0; fet < ACQ_CHANNELS; fet++) {
+    if (want[fet] == range[fet])
+      continue;
+    switching |= ACQ_RANGE_SWITCHING << (4 * fet);
+
+    // FET 1/3 on port A, FET 2/4 on port B (pin map in main.h)
+    uint8_t shift = (fet & 1) ? 8 : 0;
+    const AutoRange_Step_t *step = &ladder[want[fet]];
+    uint16_t bits = (step->gain & 0x07) | ((step->shunt & 0x07) << 3);
+    MCP_SetBits(fet_expanders[fet / 2], 0x3F << shift, bits << shift);
+    low_count[fet] = 0;
+  }
+  if (switching == 0)
+    return;
+
+  Acq_SetRanges(AutoRange_Tags() | switching);
+  MCP_FlushGroup(fet_expanders, 2);
+  for (uint8_t fet = 0; fet < ACQ_CHANNELS; fet++)
+    range[fet] = want[fet];
+  Acq_SetRanges(AutoRange_Tags());
+}
+
+void AutoRange_Init(MCP23S17_Handle_t *fet12, MCP23S17_Handle_t *fet34) {
+  uint8_t want[ACQ_CHANNELS];
+
+  fet_expanders[0] = fet12;
+  fet_expanders[1] = fet34;
+  auto_mask = (1 << ACQ_CHANNELS) - 1;
+  Acq_ReaderSync(&range_reader);
+
+  // Start least sensitive: nothing clips before the first decision
+  for (uint8_t fet = 0; fet < ACQ_CHANNELS; fet++) {
+    range[fet] = RANGE_COUNT; // Differs from every ladder entry
+    want[fet] = RANGE_COUNT - 1;
+  }
+  AutoRange_Apply(want);
+}
+
+void AutoRange_Service(void) {
+  Acq_Sample_t s;
+  uint8_t want[ACQ_CHANNELS];
+
+  for (uint8_t fet = 0; fet < ACQ_CHANNELS; fet++)
+    want[fet] = range[fet];
+
+  while (Acq_Read(&range_reader, &s)) {
+    for (uint8_t fet = 0; fet < ACQ_CHANNELS; fet++) {
+      // Only judge settled samples in the current range, once per pass
+      if (!(auto_mask & (1 << fet)) || want[fet] != range[fet] ||
+          ACQ_RANGE_OF(s.Ranges, fet) != range[fet])
+        continue;
+
+      int32_t level = abs(s.Raw[fet]);
+      if (level >= RANGE_HIGH_CODE) {
+        if (range[fet] < RANGE_COUNT - 1)
+          want[fet] = range[fet] + 1;
+        low_count[fet] = 0;
+      } else if (level < RANGE_LOW_CODE && range[fet] > 0) {
+        if (++low_count[fet] >= RANGE_LOW_SAMPLES)
+          want[fet] = range[fet] - 1;
+      } else {
+        low_count[fet] = 0;
+      }
+    }
+  }
+
+  AutoRange_Apply(want);
+}
+
+uint8_t AutoRange_Set(uint8_t fet, uint8_t r) {
+  uint8_t want[ACQ_CHANNELS];
+
+  if (fet >= ACQ_CHANNELS || (r >= RANGE_COUNT && r != RANGE_AUTO))
+    return 0;
+
+  if (r == RANGE_AUTO) {
+    auto_mask |= 1 << fet;
+    low_count[fet] = 0;
+    return 1;
+  }
+
+  auto_mask &= ~(1 << fet);
+  for (uint8_t i = 0; i < ACQ_CHANNELS; i++)
+    want[i] = range[i];
+  want[fet] = r;
+  AutoRange_Apply(want);
+  return 1;
+}
+
+uint8_t AutoRange_Get(uint8_t fet) { return range[fet]; }
+
+uint8_t AutoRange_IsAuto(uint8_t fet) { return (auto_mask >> fet) & 1; }
+
+uint32_t AutoRange_LsbFa(uint8_t r) {
+  return (r < RANGE_COUNT) ? ladder[r].lsb_fa : 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * chip_select.c
+ *
+ *  Created on: Mar 16, 2026
+ *      Author: BioFET Team
+ */
+
+#include "chip_select.h"
+
+/*
+ * The pin must already be configured as a push-pull output (MX_GPIO_Init).
+ */
+void ChipSel_InitNative(ChipSel_t *cs, GPIO_TypeDef *port, uint16_t pin) {
+  cs->kind = CHIPSEL_NATIVE;
+  cs->port = port;
+  cs->pin = pin;
+  cs->exp = NULL;
+  cs->burst = 0;
+  GPIO_FAST_HIGH(port, pin); // Released, without touching the bus claims
+}
+
+void ChipSel_InitExpander(ChipSel_t *cs, MCP23S17_Handle_t *exp,
+                          uint8_t pin) {
+  cs->kind = CHIPSEL_EXPANDER;
+  cs->port = NULL;
+  cs->pin = pin;
+  cs->exp = exp;
+  cs->burst = 0;
+  ChipSel_ExpanderWrite(cs, 1);
+}
+
+// Only the changed port is written (see MCP_WritePort)
+void ChipSel_ExpanderWrite(ChipSel_t *cs, uint8_t level) {
+  MCP_WritePin(cs->exp, cs->pin, level ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+void ChipSel_BeginBurst(ChipSel_t *cs) {
+  if (cs->burst == 0)
+    ChipSel_Assert(cs);
+  cs->burst++;
+}
+
+void ChipSel_EndBurst(ChipSel_t *cs) {
+  if (cs->burst == 0)
+    return;
+  if (--cs->burst == 0)
+    ChipSel_Release(cs);
+}
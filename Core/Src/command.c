@@ -0,0 +1,179 @@
+/*
+ * command.c
+ *
+ *  Created on: Apr 6, 2026
+ *      Author: BioFET Team
+ */
+
+#include "command.h"
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const Cmd_t *cmd_table = NULL;
+static uint8_t cmd_count = 0;
+static uint8_t cmd_hash[CMD_HASH_SIZE]; // Table index + 1, 0 = empty slot
+static Cmd_Guard_t cmd_guard = NULL;
+static void (*cmd_respond)(const char *msg) = NULL;
+static char cmd_tag[CMD_TAG_MAX] = "";
+
+// FNV-1a over a name
+static uint32_t Cmd_Hash(const char *s) {
+  uint32_t h = 2166136261u;
+  while (*s)
+    h = (h ^ (uint8_t)*s++) * 16777619u;
+  return h;
+}
+
+void Cmd_Init(const Cmd_t *table, uint8_t count, Cmd_Guard_t guard,
+              void (*respond)(const char *msg)) {
+  cmd_table = table;
+  cmd_count = count;
+  cmd_guard = guard;
+  cmd_respond = respond;
+  memset(cmd_hash, 0, sizeof(cmd_hash));
+
+  for (uint8_t i = 0; i < count && i < CMD_HASH_SIZE / 2; i++) {
+    uint32_t slot = Cmd_Hash(table[i].Name);
+    while (cmd_hash[slot % CMD_HASH_SIZE] != 0)
+      slot++; // Linear probing
+    cmd_hash[slot % CMD_HASH_SIZE] = i + 1;
+  }
+}
+
+static const Cmd_t *Cmd_Find(const char *name) {
+  uint32_t slot = Cmd_Hash(name);
+  for (uint8_t probes = 0; probes < CMD_HASH_SIZE; probes++, slot++) {
+    uint8_t index = cmd_hash[slot % CMD_HASH_SIZE];
+    if (index == 0)
+      return NULL;
+    if (strcmp(cmd_table[index - 1].Name, name) == 0)
+      return &cmd_table[index - 1];
+  }
+  return NULL;
+}
+
+static char *Cmd_Trim(char *s) {
+  while (*s == ' ' || *s == '\t')
+    s++;
+  char *end = s + strlen(s);
+  while (end > s && (end[-1] == ' ' || end[-1] == '\t'))
+    *--end = '\0';
+  return s;
+}
+
+// Parses one argument strictly: no trailing characters, within range
+static uint8_t Cmd_ParseArg(const Cmd_ArgSpec_t *spec, char *text,
+                            Cmd_Value_t *value) {
+  char *end;
+
+  if (*text == '\0')
+    return 0;
+
+  switch (spec->Type) {
+  case CMD_ARG_INT: {
+    errno = 0;
+    long v = strtol(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE || v < spec->Min || v > spec->Max)
+      return 0;
+    value->Int = (int32_t)v;
+    return 1;
+  }
+  case CMD_ARG_FLOAT: {
+    float v = strtof(text, &end);
+    if (*end != '\0' || !isfinite(v) || v < spec->Min || v > spec->Max)
+      return 0;
+    value->Float = v;
+    return 1;
+  }
+  case CMD_ARG_CHAR:
+    if (text[1] != '\0')
+      return 0;
+    value->Char = text[0];
+    return 1;
+  case CMD_ARG_WORD:
+    value->Word = text;
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+static void Cmd_Run(char *text) {
+  char *name = Cmd_Trim(text);
+  char *rest;
+
+  if (*name == '\0')
+    return; // Empty command, e.g. a trailing ';'
+
+  // Optional "#tag " prefix, echoed in every response line
+  cmd_tag[0] = '\0';
+  if (*name == '#') {
+    size_t n = strcspn(name, " \t");
+    if (n >= CMD_TAG_MAX) {
+      cmd_respond("ERR: Invalid Tag\n");
+      return;
+    }
+    memcpy(cmd_tag, name, n);
+    cmd_tag[n] = '\0';
+    name = Cmd_Trim(name + n);
+  }
+
+  rest = name + strcspn(name, " \t");
+  if (*rest != '\0')
+    *rest++ = '\0';
+
+  const Cmd_t *cmd = Cmd_Find(name);
+  if (cmd == NULL) {
+    cmd_respond("ERR: Unknown Command\n");
+    return;
+  }
+
+  // A command refused in this state is refused whatever its arguments
+  const char *refused = cmd_guard ? cmd_guard(cmd) : NULL;
+  if (refused != NULL) {
+    cmd_respond(refused);
+    return;
+  }
+
+  // Split the arguments at ',' and check them against the entry
+  Cmd_Args_t args = {0};
+  rest = Cmd_Trim(rest);
+  uint8_t ok = 1;
+  while (ok && *rest != '\0') {
+    char *next = strchr(rest, ',');
+    if (next != NULL)
+      *next++ = '\0';
+    if (args.Count >= cmd->NumArgs ||
+        !Cmd_ParseArg(&cmd->Args[args.Count], Cmd_Trim(rest),
+                      &args.Arg[args.Count]))
+      ok = 0;
+    args.Count++;
+    rest = (next != NULL) ? next : rest + strlen(rest);
+    if (next != NULL && *Cmd_Trim(next) == '\0')
+      ok = 0; // Trailing ','
+  }
+  if (!ok || args.Count < cmd->MinArgs) {
+    cmd_respond(cmd->Invalid ? cmd->Invalid : "ERR: Invalid Argument\n");
+    return;
+  }
+  cmd->Handler(&args);
+}
+
+void Cmd_Execute(char *line) {
+  char *start = line;
+
+  for (;;) {
+    char *sep = strchr(start, ';');
+    if (sep != NULL)
+      *sep = '\0';
+    Cmd_Run(start);
+    cmd_tag[0] = '\0'; // Responses sent later (events) are untagged
+    if (sep == NULL)
+      break;
+    start = sep + 1;
+  }
+}
+
+const char *Cmd_Tag(void) { return cmd_tag; }
@@ -0,0 +1,81 @@
+/*
+ * dac.c
+ *
+ *  Created on: Mar 18, 2026
+ *      Author: BioFET Team
+ */
+
+#include "dac.h"
+#include "perf.h"
+
+void DAC_Init(DAC_Channel_t *ch, SPI_HandleTypeDef *hspi, ChipSel_t *cs,
+              int32_t min_mv, int32_t max_mv) {
+  ch->hspi = hspi;
+  ch->cs = cs;
+  ch->min_mv = min_mv;
+  ch->max_mv = max_mv;
+  DAC_SetMv(ch, 0); // 0V, or the nearest end of the range
+}
+
+uint16_t DAC_MvToCode(const DAC_Channel_t *ch, int32_t mv) {
+  if (mv <= ch->min_mv)
+    return 0;
+  if (mv >= ch->max_mv)
+    return DAC_MAX_CODE;
+  // Rounded, integer only
+  int32_t span = ch->max_mv - ch->min_mv;
+  return (uint16_t)(((mv - ch->min_mv) * DAC_MAX_CODE + span / 2) / span);
+}
+
+int32_t DAC_CodeToMv(const DAC_Channel_t *ch, uint16_t code) {
+  int32_t span = ch->max_mv - ch->min_mv;
+  return ch->min_mv + ((int32_t)code * span + DAC_MAX_CODE / 2) / DAC_MAX_CODE;
+}
+
+void DAC_SetMv(DAC_Channel_t *ch, int32_t mv) {
+  DAC_WriteFrame(ch, DAC_FRAME(DAC_MvToCode(ch, mv)));
+}
+
+void DAC_WriteFrame(DAC_Channel_t *ch, uint16_t frame) {
+  uint8_t data[2] = {(uint8_t)(frame >> 8), (uint8_t)(frame & 0xFF)};
+  SpiBus_Xfer_t x = {0};
+  x.Dev = SPI_DEV_DAC;
+  x.Tx = data;
+  x.Len = 2;
+
+  PERF_BEGIN(PERF_ZONE_DAC);
+  SpiBus_Claim();
+  SpiBus_Select(ch->hspi, SPI_DEV_DAC); // Before a native CS falls
+  ChipSel_Assert(ch->cs); // May clock the expander first
+  SpiBus_Transfer(&x, 1);
+  ChipSel_Release(ch->cs); // Output updates on the rising edge
+  SpiBus_Unclaim();
+  ch->code = frame & 0x0FFF;
+  PERF_END(PERF_ZONE_DAC);
+}
+
+/*
+ * Register-level write for interrupt context: no HAL lock, no timeout
+ * bookkeeping, a few microseconds in total. Caller must have checked
+ * SpiBus_Idle() and the CS must be native. SPI1 is already enabled by the
+ * HAL transfers made during startup.
+ */
+void DAC_WriteFrameFast(DAC_Channel_t *ch, uint16_t frame) {
+  SPI_TypeDef *spi = ch->hspi->Instance;
+
+  SpiBus_Select(ch->hspi, SPI_DEV_DAC);
+  ChipSel_Assert(ch->cs);
+  *(__IO uint8_t *)&spi->DR = (uint8_t)(frame >> 8);
+  while (!(spi->SR & SPI_SR_TXE)) {
+  }
+  *(__IO uint8_t *)&spi->DR = (uint8_t)(frame & 0xFF);
+  while (!(spi->SR & SPI_SR_TXE)) {
+  }
+  while (spi->SR & SPI_SR_BSY) {
+  }
+  // Drop the two bytes clocked in meanwhile (and the OVR flag they set)
+  (void)spi->DR;
+  (void)spi->SR;
+  ChipSel_Release(ch->cs);
+  ch->code = frame & 0x0FFF;
+}
@@ -0,0 +1,73 @@
+/*
+ * dsp.c
+ *
+ *  Created on: Mar 24, 2026
+ *      Author: BioFET Team
+ */
+
+#include "dsp.h"
+#include <string.h>
+
+uint8_t Dsp_ConfigValid(const Dsp_Config_t *cfg) {
+  return cfg->Osr >= 1 && cfg->Osr <= DSP_MAX_OSR &&
+         (cfg->Median == 1 || cfg->Median == 3 || cfg->Median == 5) &&
+         cfg->IirShift <= DSP_MAX_IIR_SHIFT;
+}
+
+void Dsp_Reset(Dsp_Channel_t *ch) { memset(ch, 0, sizeof(*ch)); }
+
+static int16_t Dsp_Clamp(int32_t x) {
+  if (x > INT16_MAX)
+    return INT16_MAX;
+  if (x < INT16_MIN)
+    return INT16_MIN;
+  return (int16_t)x;
+}
+
+// Median of the newest n history entries (insertion sort, n <= 5)
+static int16_t Dsp_Median(const Dsp_Channel_t *ch, uint8_t n) {
+  int16_t v[DSP_MAX_MEDIAN];
+
+  for (uint8_t i = 0; i < n; i++) {
+    int16_t x = ch->hist[(ch->hist_pos + DSP_MAX_MEDIAN - 1 - i) %
+                         DSP_MAX_MEDIAN];
+    int8_t j = i - 1;
+    while (j >= 0 && v[j] > x) {
+      v[j + 1] = v[j];
+      j--;
+    }
+    v[j + 1] = x;
+  }
+  return v[n / 2];
+}
+
+int16_t Dsp_Output(Dsp_Channel_t *ch, const Dsp_Config_t *cfg, uint16_t n) {
+  // Rounded average (C division truncates towards zero)
+  int32_t acc = ch->acc;
+  int32_t x = (acc >= 0) ? (acc + n / 2) / n : (acc - n / 2) / n;
+  ch->acc = 0;
+
+  if (cfg->Median > 1) {
+    ch->hist[ch->hist_pos] = (int16_t)x;
+    ch->hist_pos = (ch->hist_pos + 1) % DSP_MAX_MEDIAN;
+    if (ch->hist_len < DSP_MAX_MEDIAN)
+      ch->hist_len++;
+    // Odd window while the history fills up
+    uint8_t w = (ch->hist_len < cfg->Median) ? ((ch->hist_len - 1) | 1)
+                                             : cfg->Median;
+    x = Dsp_Median(ch, w);
+  }
+
+  if (cfg->IirShift > 0) {
+    int32_t x_q8 = x * 256;
+    if (!ch->iir_valid) {
+      ch->iir_q8 = x_q8; // Start settled, no ramp up from 0
+      ch->iir_valid = 1;
+    } else {
+      ch->iir_q8 += (x_q8 - ch->iir_q8) >> cfg->IirShift;
+    }
+    x = (ch->iir_q8 + 128) >> 8;
+  }
+
+  return Dsp_Clamp(x);
+}
@@ -0,0 +1,260 @@
+/*
+ * flash_log.c
+ *
+ *  Created on: Mar 2, 2026
+ *      Author: BioFET Team
+ */
+
+#include "flash_log.h"
+#include <string.h>
+
+_Static_assert(sizeof(LogSector_t) == 16, "LogSector_t layout changed");
+
+#define LOG_SECTORS_PER_BLOCK (FLASH_BLOCK_SIZE / FLASH_SECTOR_SIZE)
+
+/*
+ * Jobs finish in order and the writer only refills a buffer once its jobs
+ * are done, so a program that finishes belongs to the other buffer while
+ * that one still has jobs in flight, else to the current one.
+ */
+static void FlashLog_ProgramDone(void *ctx, uint8_t ok) {
+  FlashLog_t *log = (FlashLog_t *)ctx;
+  uint8_t buf = log->in_flight[log->cur ^ 1] ? log->cur ^ 1 : log->cur;
+
+  log->in_flight[buf]--;
+  if (!ok)
+    log->lost++; // The retries failed too
+}
+
+static void FlashLog_EraseDone(void *ctx, uint8_t ok) {
+  *(volatile uint8_t *)ctx = 0;
+}
+
+static void FlashLog_Submit(const W25Q_Job_t *job) {
+  // Queue full means the flash is falling behind; step it until there is
+  // room rather than dropping data.
+  while (!W25Q_AsyncSubmit(job)) {
+    W25Q_AsyncProcess();
+  }
+}
+
+/*
+ * Queues an erase for the ring slot of sequence seq if it has not been
+ * erased yet. This is where old sectors are reclaimed. Jobs run in order,
+ * so the erase always completes before any page program submitted after it.
+ */
+static void FlashLog_EnsureErased(FlashLog_t *log, uint32_t seq) {
+  if (seq <= log->erased_seq)
+    return;
+
+  W25Q_Job_t job = {0};
+  job.type = W25Q_JOB_ERASE_SECTOR;
+  job.addr = FlashLog_SectorAddr(seq);
+  FlashLog_Submit(&job);
+  log->erased_seq = seq;
+}
+
+/*
+ * Queues the not-yet-submitted tail of the current page buffer. NOR flash
+ * allows programming the still-erased (0xFF) part of a page, so a partial
+ * flush followed by more appends to the same page is safe. Appends only
+ * touch bytes past page_fill, which the queued job never reads.
+ */
+static void FlashLog_ProgramPending(FlashLog_t *log) {
+  if (log->page_fill <= log->page_flushed)
+    return;
+
+  // Also queue the erase of the next sector, so it runs in the background
+  // while this one fills up
+  FlashLog_EnsureErased(log, log->seq);
+  FlashLog_EnsureErased(log, log->seq + 1);
+
+  W25Q_Job_t job = {0};
+  job.type = W25Q_JOB_PROGRAM;
+  job.addr = log->page_addr + log->page_flushed;
+  job.data = &log->page_buf[log->cur][log->page_flushed];
+  job.len = log->page_fill - log->page_flushed;
+  job.done = FlashLog_ProgramDone;
+  job.ctx = log;
+  log->in_flight[log->cur]++;
+  FlashLog_Submit(&job);
+  log->page_flushed = log->page_fill;
+
+  FlashLog_Service(log);
+}
+
+// Copies raw bytes into the page buffers at the physical write pointer
+static void FlashLog_Put(FlashLog_t *log, const uint8_t *data, uint32_t len) {
+  while (len > 0) {
+    uint32_t room = FLASH_PAGE_SIZE - log->page_fill;
+    uint32_t chunk = (len < room) ? len : room;
+
+    memcpy(&log->page_buf[log->cur][log->page_fill], data, chunk);
+    log->page_fill += chunk;
+    data += chunk;
+    len -= chunk;
+
+    if (log->page_fill == FLASH_PAGE_SIZE) {
+      // Page complete: one WREN + one page program for the whole page
+      FlashLog_ProgramPending(log);
+      log->page_addr += FLASH_PAGE_SIZE;
+      log->page_fill = 0;
+      log->page_flushed = 0;
+
+      // Switch buffers. Only wait if the flash is two pages behind.
+      log->cur ^= 1;
+      while (log->in_flight[log->cur]) {
+        W25Q_AsyncProcess();
+      }
+    }
+  }
+}
+
+// Moves the write pointer to the ring slot of log->seq and stamps its header
+static void FlashLog_OpenSector(FlashLog_t *log) {
+  LogSector_t hdr;
+  memset(&hdr, 0xFF, sizeof(hdr)); // Reserved fields stay erased
+  hdr.Magic = LOG_SECTOR_MAGIC;
+  hdr.Sequence = log->seq;
+  hdr.RunId = log->run_id;
+
+  // The previous sector ended on a page boundary (or FlashLog_Init pointed
+  // past the header), so nothing of ours is in the buffer yet
+  log->page_addr = FlashLog_SectorAddr(log->seq);
+  log->page_fill = 0;
+  log->page_flushed = 0;
+  FlashLog_EnsureErased(log, log->seq);
+  FlashLog_Put(log, (const uint8_t *)&hdr, sizeof(hdr));
+}
+
+void FlashLog_Init(FlashLog_t *log, uint32_t seq, uint16_t offset,
+                   uint16_t run_id) {
+  // Jobs from a previous run may still point into the buffers
+  W25Q_AsyncDrain();
+
+  FlashLog_Advance(&seq, &offset, 0); // A full sector resumes in the next
+  log->seq = seq;
+  log->sector_off = offset;
+  log->run_id = run_id;
+  log->size = 0;
+
+  uint32_t addr = FlashLog_DataAddr(seq, offset);
+  log->page_addr = addr - (addr % FLASH_PAGE_SIZE);
+  log->page_fill = addr % FLASH_PAGE_SIZE;
+  log->page_flushed = log->page_fill; // Bytes before start are not ours
+  // Resuming inside a sector continues behind an earlier run, whose writer
+  // already erased it, so erasing it again would destroy that run. A fresh
+  // sector is reclaimed when its header is written.
+  log->erased_seq = (offset > 0) ? seq : seq - 1;
+  log->reserve_seq = log->erased_seq;
+  log->erase_pending = 0;
+  log->cur = 0;
+  log->in_flight[0] = 0;
+  log->in_flight[1] = 0;
+  log->lost = 0;
+}
+
+uint32_t FlashLog_Append(FlashLog_t *log, const uint8_t *data, uint32_t len) {
+  uint32_t accepted = len;
+
+  while (len > 0) {
+    if (log->sector_off == 0)
+      FlashLog_OpenSector(log);
+
+    uint32_t room = LOG_SECTOR_PAYLOAD - log->sector_off;
+    uint32_t chunk = (len < room) ? len : room;
+
+    FlashLog_Put(log, data, chunk);
+    log->sector_off += chunk;
+    log->size += chunk;
+    data += chunk;
+    len -= chunk;
+
+    if (log->sector_off == LOG_SECTOR_PAYLOAD) {
+      log->seq++;
+      log->sector_off = 0;
+    }
+  }
+
+  return accepted;
+}
+
+void FlashLog_Flush(FlashLog_t *log) { FlashLog_ProgramPending(log); }
+
+/*
+ * Plans the erases for a run expected to log len more bytes, plus the
+ * sector after it. Never reaches round to the sector being written.
+ */
+void FlashLog_Reserve(FlashLog_t *log, uint32_t len) {
+  uint32_t seq = log->seq;
+  uint16_t offset = log->sector_off;
+  FlashLog_Advance(&seq, &offset, len);
+  seq++;
+  if (seq - log->seq >= LOG_RING_SECTORS)
+    seq = log->seq + LOG_RING_SECTORS - 1;
+  log->reserve_seq = seq;
+  FlashLog_Service(log);
+}
+
+/*
+ * Queues the next pre-erase if none is outstanding and the queue has room.
+ * Only one is kept in flight, so a page program waits behind at most one
+ * erase. Aligned slots whose whole 64KB block is reserved get a block
+ * erase; block 0 holds config and run directory and is never aligned.
+ */
+void FlashLog_Service(FlashLog_t *log) {
+  if (log->erase_pending || log->erased_seq >= log->reserve_seq)
+    return;
+
+  uint32_t seq = log->erased_seq + 1;
+  W25Q_Job_t job = {0};
+  job.addr = FlashLog_SectorAddr(seq);
+  job.done = FlashLog_EraseDone;
+  job.ctx = (void *)&log->erase_pending;
+
+  uint32_t last = seq;
+  if ((job.addr % FLASH_BLOCK_SIZE) == 0 &&
+      log->reserve_seq - seq >= LOG_SECTORS_PER_BLOCK - 1) {
+    job.type = W25Q_JOB_ERASE_BLOCK;
+    last = seq + LOG_SECTORS_PER_BLOCK - 1;
+  } else {
+    job.type = W25Q_JOB_ERASE_SECTOR;
+  }
+
+  if (W25Q_AsyncSubmit(&job)) {
+    log->erase_pending = 1;
+    log->erased_seq = last;
+  }
+}
+
+uint32_t FlashLog_Size(const FlashLog_t *log) { return log->size; }
+
+uint32_t FlashLog_Lost(const FlashLog_t *log) { return log->lost; }
+
+// ============================================================================
+// POSITION HELPERS
+// ============================================================================
+
+uint32_t FlashLog_SectorAddr(uint32_t seq) {
+  return DATA_ADDR_START + (seq % LOG_RING_SECTORS) * FLASH_SECTOR_SIZE;
+}
+
+uint32_t FlashLog_DataAddr(uint32_t seq, uint16_t offset) {
+  return FlashLog_SectorAddr(seq) + sizeof(LogSector_t) + offset;
+}
+
+void FlashLog_Advance(uint32_t *seq, uint16_t *offset, uint32_t len) {
+  uint32_t pos = *offset + len;
+  *seq += pos / LOG_SECTOR_PAYLOAD;
+  *offset = pos % LOG_SECTOR_PAYLOAD;
+}
+
+/*
+ * A sector still holds log sector seq only if its header carries that
+ * sequence; once the ring wraps, the slot is erased or holds a newer one.
+ */
+uint8_t FlashLog_SectorValid(uint32_t seq) {
+  LogSector_t hdr;
+  W25Q_Read((uint8_t *)&hdr, FlashLog_SectorAddr(seq), sizeof(hdr));
+  return hdr.Magic == LOG_SECTOR_MAGIC && hdr.Sequence == seq;
+}
@@ -0,0 +1,120 @@
+/*
+ * frame.c
+ *
+ *  Created on: Mar 30, 2026
+ *      Author: BioFET Team
+ */
+
+#include "frame.h"
+#include <string.h>
+
+_Static_assert(FRAME_WIRE_SIZE(FRAME_DATA_MAX) <= UART_TX_BULK_CHUNK,
+               "A full frame must fit one bulk DMA chunk");
+
+static uint8_t frame_seq = 0; // Sequence of the next frame sent
+
+// Bytewise CRC-16/CCITT-FALSE without a table (a few ALU ops per byte)
+uint16_t Frame_Crc16(uint16_t crc, const uint8_t *data, uint16_t len) {
+  while (len--) {
+    crc = (crc >> 8) | (crc << 8);
+    crc ^= *data++;
+    crc ^= (crc & 0xFF) >> 4;
+    crc ^= crc << 12;
+    crc ^= (crc & 0xFF) << 5;
+  }
+  return crc;
+}
+
+/*
+ * COBS: each run of non-zero bytes is prefixed with its length + 1, which
+ * stands in for the zero that followed it. Runs are cut at 254 bytes.
+ */
+static uint16_t Frame_Cobs(uint8_t *out, const uint8_t *in, uint16_t len) {
+  uint16_t code_pos = 0;
+  uint16_t o = 1;
+  uint8_t code = 1;
+
+  for (uint16_t i = 0; i < len; i++) {
+    if (in[i] == 0) {
+      out[code_pos] = code;
+      code_pos = o++;
+      code = 1;
+    } else {
+      out[o++] = in[i];
+      if (++code == 0xFF) {
+        out[code_pos] = code;
+        code_pos = o++;
+        code = 1;
+      }
+    }
+  }
+  out[code_pos] = code;
+  return o;
+}
+
+uint16_t Frame_Encode(uint8_t *out, uint8_t type, uint8_t seq,
+                      const void *data, uint16_t len) {
+  uint8_t body[FRAME_DATA_MAX + FRAME_OVERHEAD];
+
+  if (len > FRAME_DATA_MAX)
+    return 0;
+
+  body[0] = type;
+  body[1] = seq;
+  body[2] = len & 0xFF;
+  body[3] = len >> 8;
+  memcpy(&body[4], data, len);
+  uint16_t crc = Frame_Crc16(0xFFFF, body, len + 4);
+  body[len + 4] = crc & 0xFF;
+  body[len + 5] = crc >> 8;
+
+  out[0] = 0x00;
+  uint16_t n = 1 + Frame_Cobs(&out[1], body, len + FRAME_OVERHEAD);
+  out[n++] = 0x00;
+  return n;
+}
+
+/*
+ * buf holds the bytes between two delimiters. The decoded body never
+ * outgrows the encoded one, so it is written over it.
+ */
+uint8_t Frame_Decode(uint8_t *buf, uint16_t len, Frame_t *frame) {
+  uint16_t i = 0;
+  uint16_t o = 0;
+
+  while (i < len) {
+    uint8_t code = buf[i++];
+    if (code == 0 || i + code - 1 > len)
+      return 0;
+    for (uint8_t k = 1; k < code; k++)
+      buf[o++] = buf[i++];
+    if (code < 0xFF && i < len)
+      buf[o++] = 0;
+  }
+
+  if (o < FRAME_OVERHEAD)
+    return 0;
+  uint16_t data_len = buf[2] | (buf[3] << 8);
+  if (data_len != o - FRAME_OVERHEAD)
+    return 0;
+  uint16_t crc = buf[o - 2] | (buf[o - 1] << 8);
+  if (Frame_Crc16(0xFFFF, buf, o - 2) != crc)
+    return 0;
+
+  frame->Type = buf[0];
+  frame->Seq = buf[1];
+  frame->Len = data_len;
+  frame->Data = &buf[4];
+  return 1;
+}
+
+uint8_t Frame_Send(UartTx_Lane_t lane, uint8_t type, const void *data,
+                   uint16_t len) {
+  uint8_t wire[FRAME_WIRE_SIZE(FRAME_DATA_MAX)];
+  uint16_t n = Frame_Encode(wire, type, frame_seq, data, len);
+
+  if (n == 0 || !UartTx_Write(lane, wire, n))
+    return 0;
+  frame_seq++;
+  return 1;
+}
@@ -8,7 +8,25 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 #include "mcp23s17.h"
-#include "w25q32.h" // Flash Driver
+#include "acquisition.h" // Timer-paced FET ADC sampling
+#include "autorange.h"   // Per-FET gain / shunt selection
+#include "chip_select.h" // Native / expander chip selects
+#include "command.h"     // Command table dispatcher
+#include "dac.h"         // Bias DAC driver
+#include "flash_log.h"  // Buffered data log writer
+#include "frame.h"      // Binary host link framing
+#include "log_format.h" // Binary run header / sample records
+#include "offload.h"    // Stepped flash -> UART dump
+#include "perf.h"       // DWT cycle counts per hot-path zone
+#include "profile.h"    // Multi-segment sweep profiles
+#include "run_index.h"  // Persistent run directory
+#include "scheduler.h"  // Fixed-period main-loop tasks
+#include "stream.h"     // Live sample telemetry
+#include "uart_rx.h"    // DMA command reception
+#include "uart_tx.h"    // Queued DMA output
+#include "w25q32.h"     // Flash Driver
+#include "w25q_async.h" // Non-blocking flash job queue
+#include "waveform.h"   // Timer-paced DAC ramps
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,55 +34,82 @@
 /* Private variables ---------------------------------------------------------*/
 SPI_HandleTypeDef hspi1;
 UART_HandleTypeDef huart1;
+DMA_HandleTypeDef hdma_spi1_rx;
+DMA_HandleTypeDef hdma_spi1_tx;
+DMA_HandleTypeDef hdma_usart1_tx;
+DMA_HandleTypeDef hdma_usart1_rx;
+TIM_HandleTypeDef htim2; // Waveform step timer (1 MHz)
+TIM_HandleTypeDef htim5; // ADC acquisition timer (1 MHz)
 
 // Global Handles for the 3 Expanders
 MCP23S17_Handle_t hExpander1; // FET 1 & 2
 MCP23S17_Handle_t hExpander2; // FET 3 & 4
 MCP23S17_Handle_t hExpander3; // Peripherals
 
+// Chip selects of SPI peripherals (native pin or expander pin)
+ChipSel_t g_CsDac0_10V;
+ChipSel_t g_CsDacN1_1V;
+
+// Bias DACs
+DAC_Channel_t g_DacHV; // 0 to 10V
+DAC_Channel_t g_DacLV; // -1 to +1V
+DAC_Channel_t *g_BiasDac = &g_DacHV; // Channel whose setpoint is logged
+
+// Sweep profile for test type 3 (SWEEP_* commands)
+Profile_t g_Profile;
+Profile_Cursor_t g_ProfileCursor;
+
 // ==============================================================================
 //  GLOBAL CONFIGURATION VARIABLES (Controlled via UART)
 // ==============================================================================
 
-uint8_t g_TestType = 2;            // Default to Ramping
-float g_TestRunTimeMinutes = 5.0f; // Default 5 minutes
-float g_ConstantDAC_HV = 5.0f;     // Default 5V
-float g_ConstantDAC_LV = 0.5f;     // Default 0.5V
-uint8_t g_TestRunning = 0;         // 0 = Idle, 1 = Running
-uint32_t g_DataOffset = 0;         // Log Offset
-uint8_t g_TempTestMode = 0;        // 0 = Off, 1 = Blinking, 2 = Solid
+uint8_t g_TestType = 2;             // 1 = Constant, 2 = Ramp, 3 = Profile
+float g_TestRunTimeMinutes = 5.0f;  // Default 5 minutes
+float g_ConstantDAC_HV = 5.0f;      // Default 5V
+float g_ConstantDAC_LV = 0.5f;      // Default 0.5V
+uint8_t g_TestRunning = 0;          // 0 = Idle, 1 = Running
+uint32_t g_SamplePeriodUs = 100000; // Log interval (SET_RATE)
+uint32_t g_DataOffset = 0;          // Bytes logged in the current run
+FlashLog_t g_DataLog;               // Page-buffered writer for test data
+Acq_Reader_t g_LogReader;           // Logger's position in the ADC ring
+uint32_t g_RunStartTick = 0;        // Acquisition tick at run start
+uint8_t g_TempTestMode = 0;         // 0 = Off, 1 = Blinking, 2 = Solid
+volatile uint8_t g_ChipErasing = 0; // 1 while a chip erase is queued/running
+uint8_t g_ClockProfile = BIOFET_CLOCK_PROFILE; // Fallback may change it
+uint8_t g_ReplyFramed = 0; // Last command came as a frame: reply in frames
 
 // Startup / Hardware Config
 #define USER_KEY_PIN KEY_Pin
 #define USER_KEY_PORT KEY_GPIO_Port
 
-// FLASH CONFIG
-// Define the CS Pin for the Flash here (or in main.h)
-// User to confirmation pin: Assuming PB0 for now as placeholder
-#define FLASH_CS_Pin GPIO_PIN_0
-#define FLASH_CS_GPIO_Port GPIOB
-
-// UART Reception Buffer
-#define UART_RX_BUFFER_SIZE 64
-char rx_buffer[UART_RX_BUFFER_SIZE];
-uint8_t rx_index = 0;
+// Longest SET_TIME (one week), so the run length in ms stays in 32 bits
+#define RUN_MAX_MINUTES 10080
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
 static void MX_SPI1_Init(void);
 static void MX_USART1_UART_Init(void);
+static uint8_t UART_BaudValid(uint32_t baud);
+static void UART_SetBaud(uint32_t baud);
+static void MX_DMA_Init(void);
+static void MX_TIM2_Init(void);
+static void MX_TIM5_Init(void);
 static void Expander_Init(void);
-void ProcessCommand(char *cmd);
+static void ChipSelect_Init(void);
+static void Commands_Init(void);
+static void Tasks_Run(void);
+static void ProcessFrame(uint8_t *buf, uint16_t len);
 void SendResponse(const char *msg);
 
-// DAC Helper Prototypes
-void DAC_SetVoltage_0_10V(float voltage);
-void DAC_SetVoltage_N1_1V(float voltage);
-void OffloadMemory(void);
+void OffloadMemory(uint16_t run_id);
+void ListRuns(void);
+static void EndRun(void);
 void SaveConfig(void);
 void LoadConfig(void);
-void ClearFlash(void);
+uint8_t EraseChip(void);
+static void LogRunHeader(uint32_t run_time_ms);
+static void LogSample(const Acq_Sample_t *sample);
 
 /**
  * @brief  The application entry point.
@@ -79,18 +124,47 @@ int main(void) {
 
   /* Configure the system clock */
   SystemClock_Config();
+  SpiBus_Init(&hspi1); // SPI prescalers for the clock profile
+  Perf_Init();         // Cycle counter for PROFILE
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
   MX_SPI1_Init();
   MX_USART1_UART_Init();
+  MX_DMA_Init();
+  MX_TIM2_Init();
+  MX_TIM5_Init();
+  Commands_Init();
+  UartRx_Init(&huart1); // Commands are received from here on
+  UartTx_Init(&huart1);
 
   /* Initialize the SPI Expanders */
   Expander_Init();
+  ChipSelect_Init();
+
+  // Deselects the ADCs, which the cleared expander latch leaves selected,
+  // before the DAC and flash traffic below
+  static const uint8_t adc_cs[ACQ_CHANNELS] = {
+      EXP3_ADC1_CS_PIN, EXP3_ADC2_CS_PIN, EXP3_ADC3_CS_PIN, EXP3_ADC4_CS_PIN};
+  Acq_Init(&htim5, &hspi1, &hExpander3, adc_cs);
+
+  // DACs to 0V (range ends come from the output stage, see dac.h)
+  DAC_Init(&g_DacHV, &hspi1, &g_CsDac0_10V, 0, 10000);
+  DAC_Init(&g_DacLV, &hspi1, &g_CsDacN1_1V, -1000, 1000);
+  Waveform_Init(&htim2);
 
   // Load Saved Settings from Flash (Stub)
   LoadConfig();
 
+  // FET ADCs are sampled continuously at the log rate from here on
+  Acq_SetPeriodUs(g_SamplePeriodUs);
+  Acq_SetBias(g_BiasDac);
+  AutoRange_Init(&hExpander1, &hExpander2); // Before the first burst
+  Acq_Start();
+
+  // Load the run directory; closes a run that was cut by power loss
+  RunIndex_Init();
+
   // -------------------------------------------------------------------------
   // OFFLINE MODE CHECK
   // -------------------------------------------------------------------------
@@ -104,193 +178,618 @@ int main(void) {
     SendResponse("BioFET Ready\n");
   }
 
-  uint32_t start_tick = 0;
-  uint32_t last_led_tick = 0;
-  uint8_t key_last_state = GPIO_PIN_SET; // Assuming PULLUP, SET is unpressed
-  uint8_t led_state = 0;
+  Tasks_Run(); // Does not return
+}
 
-  while (1) {
-    // -----------------------------------------------------------------------
-    // Button Debounce and Toggle Logic
-    // -----------------------------------------------------------------------
-    uint8_t current_key_state = HAL_GPIO_ReadPin(KEY_GPIO_Port, KEY_Pin);
-    if (current_key_state == GPIO_PIN_RESET &&
-        key_last_state != GPIO_PIN_RESET) {
-      // Button pressed
-      g_TempTestMode = (g_TempTestMode + 1) % 3;
-      HAL_Delay(50); // Simple debounce
-    }
-    key_last_state = current_key_state;
-
-    // -----------------------------------------------------------------------
-    // LED Control Logic (using non-blocking timing)
-    // -----------------------------------------------------------------------
-    if (g_TempTestMode == 0) {
-      // LED OFF (Active Low: SET means OFF on BlackPill)
-      HAL_GPIO_WritePin(LED_GPIO_Port, LED_Pin, GPIO_PIN_SET);
-      led_state = 0;
-    } else if (g_TempTestMode == 2) {
-      // LED Solid ON (Active Low, so RESET means ON)
-      HAL_GPIO_WritePin(LED_GPIO_Port, LED_Pin, GPIO_PIN_RESET);
-    } else if (g_TempTestMode == 1) {
-      // LED Blinking (1s ON, 1s OFF)
-      if (HAL_GetTick() - last_led_tick >= 1000) {
-        last_led_tick = HAL_GetTick();
-        led_state = !led_state;
-        HAL_GPIO_WritePin(LED_GPIO_Port, LED_Pin,
-                          led_state ? GPIO_PIN_RESET : GPIO_PIN_SET);
-      }
-    }
+// ============================================================================
+// TASKS
+// ============================================================================
+// Main-loop work, run by the scheduler (scheduler.h) at fixed periods in
+// the priority order of g_Tasks. None of them may block.
+
+#define KEY_DEBOUNCE_POLLS 3 // UI task periods the key must read pressed
+
+static uint8_t g_RunActive = 0; // Run set up by ControlTask, logged by LogTask
+static uint32_t g_RunDurationMs = 0;
 
-    // -----------------------------------------------------------------------
-    // 1. UART COMMAND PROCESSING
-    // -----------------------------------------------------------------------
-    uint8_t rx_byte;
-    if (HAL_UART_Receive(&huart1, &rx_byte, 1, 0) == HAL_OK) {
-      if (rx_byte == '\n' || rx_byte == '\r') {
-        if (rx_index > 0) {
-          rx_buffer[rx_index] = '\0'; // Null terminate
-          ProcessCommand(rx_buffer);
-          rx_index = 0;
-        }
-      } else {
-        if (rx_index < UART_RX_BUFFER_SIZE - 1) {
-          rx_buffer[rx_index++] = rx_byte;
-        } else {
-          // Buffer overflow, reset
-          rx_index = 0;
-        }
-      }
+// Length of a constant or ramp test; 0 if too short to play
+static uint32_t RunTimeMs(float minutes) {
+  return (uint32_t)(minutes * 60.0f * 1000.0f);
+}
+
+// Opens a new run in the log and starts the bias outputs
+static void StartRun(void) {
+  // Append the run after the previous one (see run_index.h). The writer
+  // reclaims each ring sector just before it is first programmed, so no
+  // up-front erase is needed.
+  uint16_t run_id =
+      RunIndex_Begin(g_TestType, g_TestRunTimeMinutes, Acq_PeriodUs());
+  uint32_t run_seq;
+  uint16_t run_off;
+  RunIndex_Head(&run_seq, &run_off);
+  FlashLog_Init(&g_DataLog, run_seq, run_off, run_id);
+  g_DataOffset = 0;
+  g_RunDurationMs =
+      (g_TestType == 3)
+          ? Profile_DurationMs(&g_Profile)
+          : RunTimeMs(g_TestRunTimeMinutes);
+  // Pre-erase what the configured duration will need in the background;
+  // the writer keeps erasing lazily if it runs longer. Anything past the
+  // ring's capacity is overwritten anyway.
+  uint64_t samples = (uint64_t)g_RunDurationMs * 1000 / g_SamplePeriodUs;
+  uint64_t expect = sizeof(Log_Header_t) +
+                    (samples + 1) * LOG_RECORD_SIZE(ACQ_CHANNELS);
+  if (expect > (uint64_t)LOG_RING_SECTORS * LOG_SECTOR_PAYLOAD)
+    expect = (uint64_t)LOG_RING_SECTORS * LOG_SECTOR_PAYLOAD;
+  FlashLog_Reserve(&g_DataLog, (uint32_t)expect);
+  LogRunHeader(g_TestType != 1 ? g_RunDurationMs : 0);
+
+  // Bias outputs. Ramps and profiles are played by the waveform timer;
+  // ControlTask only watches for their end.
+  g_BiasDac = &g_DacHV;
+  if (g_TestType == 3 && g_Profile.Channel == PROF_CH_LV)
+    g_BiasDac = &g_DacLV;
+  Acq_SetBias(g_BiasDac);
+  if (g_TestType == 2) {
+    DAC_SetMv(&g_DacLV, 0);
+    if (Waveform_LoadRamp(&g_DacHV, 0, 10000, g_RunDurationMs))
+      Waveform_Start();
+    else
+      DAC_SetMv(&g_DacHV, 0); // Nothing to play, ControlTask ends the run
+  } else if (g_TestType == 3) {
+    DAC_SetMv(&g_DacHV, 0);
+    DAC_SetMv(&g_DacLV, 0);
+    Profile_Start(&g_Profile, &g_ProfileCursor, g_BiasDac);
+  } else {
+    DAC_SetMv(&g_DacHV, (int32_t)(g_ConstantDAC_HV * 1000.0f));
+    DAC_SetMv(&g_DacLV, (int32_t)(g_ConstantDAC_LV * 1000.0f));
+  }
+  // Log from the next acquisition burst on
+  g_RunStartTick = Acq_ReaderSync(&g_LogReader);
+}
+
+// One record per acquisition burst, however late the task got here
+static void LogPendingSamples(void) {
+  Acq_Sample_t sample;
+  PERF_BEGIN(PERF_ZONE_LOG);
+  while (Acq_Read(&g_LogReader, &sample)) {
+    LogSample(&sample);
+    g_DataOffset = FlashLog_Size(&g_DataLog);
+  }
+  PERF_END(PERF_ZONE_LOG);
+}
+
+// Test sequencing and the DAC waveform
+static void ControlTask(void) {
+  Waveform_Service(); // Steps the timer ISR could not write itself
+
+  if (!g_TestRunning) {
+    g_RunActive = 0; // Ended by STOP
+    return;
+  }
+  if (!g_RunActive) {
+    StartRun();
+    g_RunActive = 1;
+  }
+
+  if (g_TestType != 1 && !Waveform_Running()) {
+    // --- RAMP / PROFILE FINISHED: Auto-stop ---
+    LogPendingSamples(); // Up to the end, LogTask may not have run yet
+    g_TestRunning = 0;
+    g_RunActive = 0;
+    EndRun(); // Commit the partial last page and record the length
+    if (Waveform_Skipped() > 0) {
+      char msg[48];
+      snprintf(msg, sizeof(msg), "WARN: %lu Steps Skipped\n",
+               (unsigned long)Waveform_Skipped());
+      SendResponse(msg);
     }
+    SendResponse("TEST_COMPLETE\n");
+    DAC_SetMv(&g_DacHV, 0);
+    DAC_SetMv(&g_DacLV, 0);
+  }
+}
+
+// FET ranges follow the newest samples
+static void AcqTask(void) { AutoRange_Service(); }
+
+// Flash jobs and the data log of a running test
+static void LogTask(void) {
+  PERF_BEGIN(PERF_ZONE_FLASH);
+  W25Q_AsyncProcess(); // One non-blocking step
+  if (g_TestRunning && g_RunActive)
+    FlashLog_Service(&g_DataLog); // Keep pre-erases ahead of the writer
+  PERF_END(PERF_ZONE_FLASH);
+
+  if (g_TestRunning && g_RunActive)
+    LogPendingSamples();
+}
 
-    // -----------------------------------------------------------------------
-    // 2. TEST LOGIC
-    // -----------------------------------------------------------------------
-    if (g_TestRunning) {
-      if (start_tick == 0) {
-        start_tick = HAL_GetTick(); // First run init
-        // Erase Data Sector 1 (or clearer: The Offload function expects raw
-        // data) For this demo, let's just overwrite. In real app, maybe erase
-        // first? W25Q_EraseSector(DATA_ADDR_START); // Optional: Clear data log
-        // area on start
-      }
-
-      uint32_t current_tick = HAL_GetTick();
-
-      // --- DATA LOGGING ---
-      static uint32_t last_log_tick = 0;
-
-      if (current_tick - last_log_tick >= 100) { // Log every 100ms
-        last_log_tick = current_tick;
-
-        // Format: Timestamp(ms), Voltage(V), Current(uA) -> Binary or Text?
-        // Text CSV is easier for direct offload. "100,5.0,1.2\n"
-        char log_buf[32];
-        float sim_voltage = 0.0f;
-        if (g_TestType == 2) {
-          // Calc sim voltage
-          float duration_ms = g_TestRunTimeMinutes * 60.0f * 1000.0f;
-          float elapsed = (float)(current_tick - start_tick);
-          sim_voltage = (elapsed / duration_ms) * 10.0f;
-        } else {
-          sim_voltage = g_ConstantDAC_HV;
-        }
-
-        int len =
-            sprintf(log_buf, "%lu,%.2f,%.2f\n", (current_tick - start_tick),
-                    sim_voltage, sim_voltage * 0.5f); // Dummy Current
-
-        W25Q_SaveData(g_DataOffset, (uint8_t *)log_buf, len);
-        g_DataOffset += len;
-      }
-
-      if (g_TestType == 1) {
-        // --- CONSTANT VOLTAGE ---
-        DAC_SetVoltage_0_10V(g_ConstantDAC_HV);
-        DAC_SetVoltage_N1_1V(g_ConstantDAC_LV);
-      } else if (g_TestType == 2) {
-        // --- RAMPING VOLTAGE ---
-        float duration_ms = g_TestRunTimeMinutes * 60.0f * 1000.0f;
-        float elapsed_ms = (float)(current_tick - start_tick);
-
-        if (elapsed_ms >= duration_ms) {
-          // Auto-stop
-          g_TestRunning = 0;
-          SendResponse("TEST_COMPLETE\n");
-          DAC_SetVoltage_0_10V(0.0f);
-          start_tick = 0;
-          g_DataOffset = 0; // Reset logging offset? Or keep it?
-          // For this simple demo, we reset start command logic but maybe offset
-          // persists until offload? Left as is: Next START will overwrite from
-          // offset 0 (implied by logic, though static var persists)
-          // FIXME: static data_offset should be reset on START command.
-        } else {
-          float progress = elapsed_ms / duration_ms;
-          float current_voltage = progress * 10.0f;
-          DAC_SetVoltage_0_10V(current_voltage);
-          DAC_SetVoltage_N1_1V(0.0f);
-        }
-      }
+// Commands, flash offload and live stream
+static void CommsTask(void) {
+  // Lines and frames are collected by RX DMA in the background
+  // (uart_rx.h). Replies go back the way the command came.
+  uint8_t rx_buf[UART_RX_FRAME_MAX + 1];
+  uint16_t rx_len;
+  uint8_t rx_kind;
+  while ((rx_kind = UartRx_Get(rx_buf, sizeof(rx_buf), &rx_len)) !=
+         UART_RX_NONE) {
+    PERF_BEGIN(PERF_ZONE_COMMAND);
+    if (rx_kind == UART_RX_LINE) {
+      g_ReplyFramed = 0;
+      Cmd_Execute((char *)rx_buf);
     } else {
-      // Idle
-      start_tick = 0;
+      ProcessFrame(rx_buf, rx_len);
     }
+    PERF_END(PERF_ZONE_COMMAND);
+  }
 
-    // Small delay to prevent tight loop from starving UART if using polling
-    // mostly But since UART is polled with 0 timeout, we don't want a large
-    // delay here. However, for the visual ramp, 10ms is fine.
-    HAL_Delay(10);
+  // Next offload chunk once the TX bulk lane has room
+  Offload_Status_t offload = Offload_Service();
+  if (offload == OFFLOAD_FINISHED && !Offload_Framed()) {
+    UartTx_WriteWait(UART_TX_BULK, "\nEND_DATA\n", 10);
+    UartTx_ReleaseCtrl(); // Responses held behind the data go out now
+  } else if (offload == OFFLOAD_ABORTED) {
+    SendResponse("ERR: Offload Aborted\n");
   }
+
+  // STREAM command, dropped if the link is full
+  Stream_Service(g_BiasDac);
 }
 
-void ProcessCommand(char *cmd) {
-  // Simple command parser
-  // CMD:ARG
+// User key and status LED
+static void UiTask(void) {
+  static uint8_t key_polls = 0;
+  static uint32_t last_led_tick = 0;
+  static uint8_t led_state = 0;
 
-  if (strncmp(cmd, "SET_TYPE", 8) == 0) {
-    int type = atoi(cmd + 9); // Skip "SET_TYPE "
-    if (type == 1 || type == 2) {
-      g_TestType = type;
-      SendResponse("OK: Type Set\n");
-    } else {
-      SendResponse("ERR: Invalid Type\n");
-    }
-  } else if (strncmp(cmd, "SET_TIME", 8) == 0) {
-    float time = atof(cmd + 9);
-    if (time > 0) {
-      g_TestRunTimeMinutes = time;
-      SendResponse("OK: Time Set\n");
-    } else {
-      SendResponse("ERR: Invalid Time\n");
+  // A press counts once the key reads pressed on KEY_DEBOUNCE_POLLS polls
+  // in a row; it must be released before the next one counts
+  if (HAL_GPIO_ReadPin(KEY_GPIO_Port, KEY_Pin) == GPIO_PIN_RESET) {
+    if (key_polls < KEY_DEBOUNCE_POLLS && ++key_polls == KEY_DEBOUNCE_POLLS)
+      g_TempTestMode = (g_TempTestMode + 1) % 3;
+  } else {
+    key_polls = 0;
+  }
+
+  if (g_TempTestMode == 0) {
+    // LED OFF (Active Low: SET means OFF on BlackPill)
+    HAL_GPIO_WritePin(LED_GPIO_Port, LED_Pin, GPIO_PIN_SET);
+    led_state = 0;
+  } else if (g_TempTestMode == 2) {
+    // LED Solid ON (Active Low, so RESET means ON)
+    HAL_GPIO_WritePin(LED_GPIO_Port, LED_Pin, GPIO_PIN_RESET);
+  } else if (g_TempTestMode == 1) {
+    // LED Blinking (1s ON, 1s OFF)
+    if (HAL_GetTick() - last_led_tick >= 1000) {
+      last_led_tick = HAL_GetTick();
+      led_state = !led_state;
+      HAL_GPIO_WritePin(LED_GPIO_Port, LED_Pin,
+                        led_state ? GPIO_PIN_RESET : GPIO_PIN_SET);
     }
-  } else if (strncmp(cmd, "SAVE_CONFIG", 11) == 0) {
-    SaveConfig();
-    SendResponse("OK: Config Saved\n");
-  } else if (strncmp(cmd, "CLEAR_FLASH", 11) == 0) {
-    ClearFlash();
-    SendResponse("OK: Flash Cleared\n");
-  } else if (strncmp(cmd, "START", 5) == 0) {
-    g_TestRunning = 1;
-    g_DataOffset = 0; // Reset Log
-    SendResponse("OK: Started\n");
-  } else if (strncmp(cmd, "STOP", 4) == 0) {
-    g_TestRunning = 0;
-    DAC_SetVoltage_0_10V(0.0f); // Safety Reset
-    SendResponse("OK: Stopped\n");
-  } else if (strncmp(cmd, "TEMP_TEST", 9) == 0) {
-    g_TempTestMode = (g_TempTestMode + 1) % 3;
-    SendResponse("OK: Temp Test Mode Toggled\n");
-  } else if (strncmp(cmd, "READ_FLASH", 10) == 0) {
-    OffloadMemory();
-  } else if (strncmp(cmd, "PING", 4) == 0) {
-    SendResponse("PONG\n");
+  }
+}
+
+// Highest priority first
+static const Sched_Task_t g_Tasks[] = {
+    {"control", ControlTask, 1},
+    {"acq", AcqTask, 1},
+    {"log", LogTask, 1},
+    {"comms", CommsTask, 1},
+    {"ui", UiTask, 10},
+};
+
+static void Tasks_Run(void) {
+  Sched_Init(g_Tasks, sizeof(g_Tasks) / sizeof(g_Tasks[0]));
+  Sched_Run(); // Does not return
+}
+
+// ============================================================================
+// COMMANDS
+// ============================================================================
+// Handlers of the command table below. Arguments arrive parsed and range
+// checked (command.h); handlers only check what depends on device state.
+
+static void SetTypeCommand(const Cmd_Args_t *args) {
+  g_TestType = args->Arg[0].Int;
+  SendResponse("OK: Type Set\n");
+}
+
+static void SetTimeCommand(const Cmd_Args_t *args) {
+  if (RunTimeMs(args->Arg[0].Float) > 0) {
+    g_TestRunTimeMinutes = args->Arg[0].Float;
+    SendResponse("OK: Time Set\n");
   } else {
-    SendResponse("ERR: Unknown Command\n");
+    SendResponse("ERR: Invalid Time\n");
   }
 }
 
+static void SetRateCommand(const Cmd_Args_t *args) {
+  int32_t hz = args->Arg[0].Int; // Samples per second
+  if (!Acq_SetPeriodUs(1000000 / hz)) {
+    SendResponse("ERR: Rate Too High For Filter\n"); // Lower SET_FILTER osr
+  } else {
+    g_SamplePeriodUs = Acq_PeriodUs(); // Rounded to whole bursts
+    SendResponse("OK: Rate Set\n");
+  }
+}
+
+// "SET_FILTER <osr>,<median>,<iir_shift>", see dsp.h
+static void SetFilterCommand(const Cmd_Args_t *args) {
+  Dsp_Config_t cfg;
+  cfg.Osr = args->Arg[0].Int;
+  cfg.Median = args->Arg[1].Int;
+  cfg.IirShift = args->Arg[2].Int;
+  if (Acq_SetFilter(&cfg))
+    SendResponse("OK: Filter Set\n");
+  else
+    SendResponse("ERR: Invalid Filter\n"); // Or bursts too fast
+}
+
+// "SET_RANGE <fet 1-4, 0 = all>,<range 0..n-1 | A>"
+static void SetRangeCommand(const Cmd_Args_t *args) {
+  int32_t fet = args->Arg[0].Int;
+  const char *arg = args->Arg[1].Word;
+  char *end;
+  uint8_t range = 0xFE; // Invalid unless parsed below
+  if ((arg[0] == 'A' || arg[0] == 'a') && arg[1] == '\0') {
+    range = RANGE_AUTO;
+  } else {
+    long v = strtol(arg, &end, 10);
+    if (*end == '\0' && v >= 0 && v < RANGE_AUTO)
+      range = v;
+  }
+  uint8_t ok = 1;
+  for (uint8_t i = 0; ok && i < ACQ_CHANNELS; i++) {
+    if (fet == 0 || fet == i + 1)
+      ok = AutoRange_Set(i, range);
+  }
+  SendResponse(ok ? "OK: Range Set\n" : "ERR: Invalid Range\n");
+}
+
+static void GetRangeCommand(const Cmd_Args_t *args) {
+  char msg[40];
+  int n = snprintf(msg, sizeof(msg), "RANGE");
+  for (uint8_t i = 0; i < ACQ_CHANNELS; i++)
+    n += snprintf(msg + n, sizeof(msg) - n, "%c%u%s", i ? ',' : ' ',
+                  AutoRange_Get(i), AutoRange_IsAuto(i) ? "A" : "");
+  snprintf(msg + n, sizeof(msg) - n, "\n");
+  SendResponse(msg);
+}
+
+static void SaveConfigCommand(const Cmd_Args_t *args) {
+  SaveConfig();
+  SendResponse("OK: Config Saved\n");
+}
+
+static void ClearFlashCommand(const Cmd_Args_t *args) {
+  RunIndex_Clear(); // Metadata only, sectors are reclaimed as needed
+  SendResponse("OK: Flash Cleared\n");
+}
+
+static void EraseChipCommand(const Cmd_Args_t *args) {
+  if (!EraseChip()) {
+    SendResponse("ERR: Flash Busy\n"); // Job queue full, the host retries
+    return;
+  }
+  SendResponse("OK: Erasing Chip\n"); // "OK: Chip Erased" follows when done
+}
+
+static void StartCommand(const Cmd_Args_t *args) {
+  if (g_TestType == 3 && g_Profile.Count == 0) {
+    SendResponse("ERR: Empty Sweep\n");
+    return;
+  }
+  g_TestRunning = 1;
+  g_DataOffset = 0; // Reset Log
+  SendResponse("OK: Started\n");
+}
+
+static void StopCommand(const Cmd_Args_t *args) {
+  g_TestRunning = 0;
+  if (g_RunActive) {
+    g_RunActive = 0; // A START right after opens a new run
+    EndRun(); // Commit the partial last page and record the length
+  }
+  Waveform_Stop();
+  DAC_SetMv(&g_DacHV, 0); // Safety Reset
+  DAC_SetMv(&g_DacLV, 0);
+  SendResponse("OK: Stopped\n");
+}
+
+static void TempTestCommand(const Cmd_Args_t *args) {
+  g_TempTestMode = (g_TempTestMode + 1) % 3;
+  SendResponse("OK: Temp Test Mode Toggled\n");
+}
+
+// "READ_FLASH [run id]", 0 or none = latest
+static void ReadFlashCommand(const Cmd_Args_t *args) {
+  OffloadMemory(args->Count ? args->Arg[0].Int : 0);
+}
+
+static void ListRunsCommand(const Cmd_Args_t *args) { ListRuns(); }
+
+// "STREAM <Hz>" while connected with frames, "STREAM 0" stops
+static void StreamCommand(const Cmd_Args_t *args) {
+  int32_t hz = args->Arg[0].Int;
+  if (hz == 0) {
+    char msg[64];
+    Stream_Stop();
+    snprintf(msg, sizeof(msg), "OK: Stream Off, %lu Sent, %lu Dropped\n",
+             (unsigned long)Stream_Sent(), (unsigned long)Stream_Dropped());
+    SendResponse(msg);
+  } else if (!g_ReplyFramed) {
+    SendResponse("ERR: Stream Needs Frames\n");
+  } else {
+    Stream_Start(hz);
+    SendResponse("OK: Streaming\n");
+  }
+}
+
+static void SetBaudCommand(const Cmd_Args_t *args) {
+  uint32_t baud = args->Arg[0].Int;
+  if (Offload_Active()) {
+    SendResponse("ERR: Offload Busy\n");
+  } else if (!UART_BaudValid(baud)) {
+    SendResponse("ERR: Invalid Baud\n");
+  } else {
+    SendResponse("OK: Baud Set\n"); // Still at the old rate
+    UART_SetBaud(baud);
+  }
+}
+
+static void PingCommand(const Cmd_Args_t *args) { SendResponse("PONG\n"); }
+
+// "CLOCK profile,sysclk_hz,flash_hz,expander_hz,dac_hz,adc_hz"
+static void GetClockCommand(const Cmd_Args_t *args) {
+  char msg[80];
+  snprintf(msg, sizeof(msg), "CLOCK %u,%lu,%lu,%lu,%lu,%lu\n", g_ClockProfile,
+           (unsigned long)HAL_RCC_GetSysClockFreq(),
+           (unsigned long)SpiBus_Hz(SPI_DEV_FLASH),
+           (unsigned long)SpiBus_Hz(SPI_DEV_EXPANDER),
+           (unsigned long)SpiBus_Hz(SPI_DEV_DAC),
+           (unsigned long)SpiBus_Hz(SPI_DEV_ADC));
+  SendResponse(msg);
+}
+
+// "TASK name,period_ms,runs,max_late_us,max_run_us,avg_run_us,overruns"
+static void TasksCommand(const Cmd_Args_t *args) {
+  char msg[80];
+  Sched_Stats_t st;
+  for (uint8_t i = 0; i < Sched_TaskCount(); i++) {
+    const Sched_Task_t *task = Sched_Task(i);
+    Sched_GetStats(i, &st);
+    snprintf(msg, sizeof(msg), "TASK %s,%u,%lu,%lu,%lu,%lu,%lu\n", task->Name,
+             task->PeriodMs, (unsigned long)st.Runs,
+             (unsigned long)st.MaxLateUs, (unsigned long)st.MaxRunUs,
+             (unsigned long)(st.Runs ? st.TotalRunUs / st.Runs : 0),
+             (unsigned long)st.Overruns);
+    SendResponse(msg);
+  }
+  snprintf(msg, sizeof(msg), "OK: %u Tasks\n", Sched_TaskCount());
+  SendResponse(msg);
+}
+
+static void TasksResetCommand(const Cmd_Args_t *args) {
+  Sched_ResetStats();
+  SendResponse("OK: Task Stats Reset\n");
+}
+
+// "ZONE name,count,min_cycles,avg_cycles,max_cycles,max_us,total_ms"
+static void ProfileCommand(const Cmd_Args_t *args) {
+#if BIOFET_PERF
+  char msg[80];
+  for (uint8_t i = 0; i < PERF_ZONE_COUNT; i++) {
+    // Copied first: the responses below count in the UART zone
+    Perf_Stats_t st = g_PerfStats[i];
+    uint32_t avg = st.Count ? (uint32_t)(st.TotalCycles / st.Count) : 0;
+    uint32_t total_ms =
+        (uint32_t)((st.TotalCycles * 1000) / SystemCoreClock);
+    snprintf(msg, sizeof(msg), "ZONE %s,%lu,%lu,%lu,%lu,%lu,%lu\n",
+             Perf_ZoneName((Perf_Zone_t)i), (unsigned long)st.Count,
+             (unsigned long)(st.Count ? st.MinCycles : 0), (unsigned long)avg,
+             (unsigned long)st.MaxCycles,
+             (unsigned long)Perf_CyclesToUs(st.MaxCycles),
+             (unsigned long)total_ms);
+    SendResponse(msg);
+  }
+  snprintf(msg, sizeof(msg), "OK: %u Zones\n", PERF_ZONE_COUNT);
+  SendResponse(msg);
+#else
+  SendResponse("ERR: Profiling Disabled\n");
+#endif
+}
+
+static void ProfileResetCommand(const Cmd_Args_t *args) {
+  Perf_Reset();
+  SendResponse("OK: Profile Reset\n");
+}
+
+/*
+ * Sweep profile editing (test type 3):
+ *   SWEEP_CLEAR                          Remove all segments
+ *   SWEEP_ADD <R|S|H|P>,v1,v2,ms,param,repeat
+ *                                        Append a segment (see profile.h)
+ *   SWEEP_CYCLES <n>                     Play the segment list n times
+ *   SWEEP_CHAN <0|1>                     0 = 0-10V DAC, 1 = -1..+1V DAC
+ *   SWEEP_SHOW                           List segments, then totals
+ * Voltages are in mV. SAVE_CONFIG keeps the profile across resets. All but
+ * SWEEP_SHOW are refused while a test runs, as the ISR reads the profile.
+ */
+static void SweepClearCommand(const Cmd_Args_t *args) {
+  Profile_Clear(&g_Profile);
+  SendResponse("OK: Sweep Cleared\n");
+}
+
+static void SweepAddCommand(const Cmd_Args_t *args) {
+  Profile_Segment_t seg = {0};
+  seg.Type = (uint8_t)args->Arg[0].Char;
+  seg.V1Mv = (int16_t)args->Arg[1].Int;
+  seg.V2Mv = (int16_t)args->Arg[2].Int;
+  seg.DurationMs = args->Arg[3].Int;
+  seg.Param = (uint16_t)args->Arg[4].Int;
+  seg.Repeat = (uint16_t)args->Arg[5].Int;
+  if (Profile_AddSegment(&g_Profile, &seg))
+    SendResponse("OK: Segment Added\n");
+  else
+    SendResponse("ERR: Invalid Segment\n");
+}
+
+static void SweepCyclesCommand(const Cmd_Args_t *args) {
+  g_Profile.Cycles = args->Arg[0].Int;
+  SendResponse("OK: Cycles Set\n");
+}
+
+static void SweepChanCommand(const Cmd_Args_t *args) {
+  g_Profile.Channel = args->Arg[0].Int;
+  SendResponse("OK: Channel Set\n");
+}
+
+static void SweepShowCommand(const Cmd_Args_t *args) {
+  char msg[80];
+  for (uint8_t i = 0; i < g_Profile.Count; i++) {
+    const Profile_Segment_t *seg = &g_Profile.Segment[i];
+    snprintf(msg, sizeof(msg), "SEG %u,%c,%d,%d,%lu,%u,%u\n", i, seg->Type,
+             seg->V1Mv, seg->V2Mv, (unsigned long)seg->DurationMs, seg->Param,
+             seg->Repeat);
+    SendResponse(msg);
+  }
+  snprintf(msg, sizeof(msg), "OK: %u Segments,%u Cycles,Chan %u,%lu ms\n",
+           g_Profile.Count, g_Profile.Cycles, g_Profile.Channel,
+           (unsigned long)Profile_DurationMs(&g_Profile));
+  SendResponse(msg);
+}
+
+// Name, handler, flags, min / max args, response to bad arguments (NULL =
+// "ERR: Invalid Argument"), argument types and ranges
+static const Cmd_t g_Commands[] = {
+    {"SET_TYPE", SetTypeCommand, 0, 1, 1, "ERR: Invalid Type\n",
+     {{CMD_ARG_INT, 1, 3}}},
+    {"SET_TIME", SetTimeCommand, 0, 1, 1, "ERR: Invalid Time\n",
+     {{CMD_ARG_FLOAT, 0, RUN_MAX_MINUTES}}},
+    // Record times assume one rate, so no changes during a run
+    {"SET_RATE", SetRateCommand, CMD_FLAG_IDLE, 1, 1, "ERR: Invalid Rate\n",
+     {{CMD_ARG_INT, 1, 1000}}},
+    {"SET_FILTER", SetFilterCommand, CMD_FLAG_IDLE, 3, 3,
+     "ERR: Invalid Filter\n",
+     {{CMD_ARG_INT, 0, DSP_MAX_OSR},
+      {CMD_ARG_INT, 0, DSP_MAX_MEDIAN},
+      {CMD_ARG_INT, 0, DSP_MAX_IIR_SHIFT}}},
+    {"SET_RANGE", SetRangeCommand, 0, 2, 2, "ERR: Invalid Range\n",
+     {{CMD_ARG_INT, 0, ACQ_CHANNELS}, {CMD_ARG_WORD, 0, 0}}},
+    {"GET_RANGE", GetRangeCommand, 0, 0, 0, NULL, {{0}}},
+    {"SAVE_CONFIG", SaveConfigCommand, CMD_FLAG_FLASH | CMD_FLAG_IDLE, 0, 0,
+     NULL, {{0}}},
+    {"CLEAR_FLASH", ClearFlashCommand, CMD_FLAG_FLASH | CMD_FLAG_IDLE, 0, 0,
+     NULL, {{0}}},
+    {"ERASE_CHIP", EraseChipCommand, CMD_FLAG_FLASH | CMD_FLAG_IDLE, 0, 0,
+     NULL, {{0}}},
+    {"START", StartCommand, CMD_FLAG_FLASH, 0, 0, NULL, {{0}}},
+    {"STOP", StopCommand, 0, 0, 0, NULL, {{0}}},
+    {"TEMP_TEST", TempTestCommand, 0, 0, 0, NULL, {{0}}},
+    {"READ_FLASH", ReadFlashCommand, CMD_FLAG_FLASH, 0, 1, NULL,
+     {{CMD_ARG_INT, 0, UINT16_MAX}}},
+    {"LIST_RUNS", ListRunsCommand, CMD_FLAG_FLASH, 0, 0, NULL, {{0}}},
+    {"STREAM", StreamCommand, 0, 1, 1, "ERR: Invalid Rate\n",
+     {{CMD_ARG_INT, 0, STREAM_MAX_HZ}}},
+    {"SET_BAUD", SetBaudCommand, 0, 1, 1, "ERR: Invalid Baud\n",
+     {{CMD_ARG_INT, 1, INT32_MAX}}},
+    {"PING", PingCommand, 0, 0, 0, NULL, {{0}}},
+    {"GET_CLOCK", GetClockCommand, 0, 0, 0, NULL, {{0}}},
+    {"TASKS", TasksCommand, 0, 0, 0, NULL, {{0}}},
+    {"TASKS_RESET", TasksResetCommand, 0, 0, 0, NULL, {{0}}},
+    {"PROFILE", ProfileCommand, 0, 0, 0, NULL, {{0}}},
+    {"PROFILE_RESET", ProfileResetCommand, 0, 0, 0, NULL, {{0}}},
+    {"SWEEP_CLEAR", SweepClearCommand, CMD_FLAG_IDLE, 0, 0, NULL, {{0}}},
+    {"SWEEP_ADD", SweepAddCommand, CMD_FLAG_IDLE, 6, 6,
+     "ERR: Invalid Segment\n",
+     {{CMD_ARG_CHAR, 0, 0},
+      {CMD_ARG_INT, INT16_MIN, INT16_MAX},
+      {CMD_ARG_INT, INT16_MIN, INT16_MAX},
+      {CMD_ARG_INT, 0, INT32_MAX},
+      {CMD_ARG_INT, 0, UINT16_MAX},
+      {CMD_ARG_INT, 0, UINT16_MAX}}},
+    {"SWEEP_CYCLES", SweepCyclesCommand, CMD_FLAG_IDLE, 1, 1,
+     "ERR: Invalid Cycles\n", {{CMD_ARG_INT, 1, UINT16_MAX}}},
+    {"SWEEP_CHAN", SweepChanCommand, CMD_FLAG_IDLE, 1, 1,
+     "ERR: Invalid Channel\n", {{CMD_ARG_INT, PROF_CH_HV, PROF_CH_LV}}},
+    {"SWEEP_SHOW", SweepShowCommand, 0, 0, 0, NULL, {{0}}},
+};
+
+static const char *CommandGuard(const Cmd_t *cmd) {
+  if ((cmd->Flags & CMD_FLAG_FLASH) && g_ChipErasing)
+    return "ERR: Flash Busy\n"; // Would block on the chip erase
+  if ((cmd->Flags & CMD_FLAG_IDLE) && g_TestRunning)
+    return "ERR: Test Running\n";
+  return NULL;
+}
+
+static void Commands_Init(void) {
+  Cmd_Init(g_Commands, sizeof(g_Commands) / sizeof(g_Commands[0]),
+           CommandGuard, SendResponse);
+}
+
+/*
+ * Queues msg on the control lane; TX DMA sends it in the background. A
+ * full lane is only waited on while it drains: behind a running offload
+ * the response is dropped, as waiting would stall the offload itself.
+ * Responses to a tagged command carry its tag.
+ */
 void SendResponse(const char *msg) {
-  HAL_UART_Transmit(&huart1, (uint8_t *)msg, strlen(msg), 100);
+  char tagged[CMD_TAG_MAX + 128];
+  const char *tag = Cmd_Tag();
+  PERF_BEGIN(PERF_ZONE_UART);
+  if (tag[0] != '\0') {
+    snprintf(tagged, sizeof(tagged), "%s %s", tag, msg);
+    msg = tagged;
+  }
+
+  uint16_t len = strlen(msg);
+  for (;;) {
+    if (g_ReplyFramed ? Frame_Send(UART_TX_CTRL, FRAME_TEXT, msg, len)
+                      : UartTx_Write(UART_TX_CTRL, msg, len))
+      break;
+    if (UartTx_CtrlHeld() || len > FRAME_DATA_MAX)
+      break;
+  }
+  PERF_END(PERF_ZONE_UART);
+}
+
+/*
+ * A frame from the host. Damaged frames are dropped without a reply: a
+ * lost command times out on the host, a lost ACK is covered by the
+ * offload timeout.
+ */
+static void ProcessFrame(uint8_t *buf, uint16_t len) {
+  Frame_t frame;
+  char cmd[UART_RX_LINE_MAX];
+  uint32_t offset;
+
+  if (!Frame_Decode(buf, len, &frame))
+    return;
+
+  switch (frame.Type) {
+  case FRAME_CMD:
+    if (frame.Len >= sizeof(cmd))
+      return;
+    memcpy(cmd, frame.Data, frame.Len);
+    cmd[frame.Len] = '\0';
+    g_ReplyFramed = 1;
+    Cmd_Execute(cmd);
+    break;
+  case FRAME_ACK:
+  case FRAME_NAK:
+    if (frame.Len != sizeof(offset))
+      return;
+    memcpy(&offset, frame.Data, sizeof(offset));
+    if (frame.Type == FRAME_ACK)
+      Offload_OnAck(offset);
+    else
+      Offload_OnNak(offset);
+    break;
+  default:
+    break;
+  }
 }
 
 void SaveConfig(void) {
@@ -300,11 +799,15 @@ void SaveConfig(void) {
   cfg.MagicNumber = 0xB10FE701;
 
   W25Q_SaveConfig(&cfg);
+  Profile_Save(&g_Profile); // Same sector, erased by W25Q_SaveConfig
 }
 
 void LoadConfig(void) {
   BioFET_Config_t cfg;
-  if (W25Q_LoadConfig(&cfg) == 1) {
+  // Also rejects a time saved before SET_TIME had its bounds
+  if (W25Q_LoadConfig(&cfg) == 1 && cfg.RunTimeMinutes > 0 &&
+      cfg.RunTimeMinutes <= RUN_MAX_MINUTES &&
+      RunTimeMs(cfg.RunTimeMinutes) > 0) {
     // Valid Config Found
     g_TestType = cfg.TestType;
     g_TestRunTimeMinutes = cfg.RunTimeMinutes;
@@ -313,107 +816,161 @@ void LoadConfig(void) {
     g_TestType = 2;
     g_TestRunTimeMinutes = 5.0f;
   }
+  Profile_Load(&g_Profile); // Empty profile if none saved
 }
 
-void ClearFlash(void) {
-  // Erase chip (Takes a while!)
-  // Or just erase Data Sectors? Chip erase is simplest for "Clear All"
-  W25Q_EraseChip();
+static void EraseChipDone(void *ctx, uint8_t ok) {
+  g_ChipErasing = 0;
+  RunIndex_Init(); // Directory sector is blank now
+  SendResponse("OK: Chip Erased\n");
 }
 
-void OffloadMemory(void) {
-  SendResponse("BEGIN_DATA\n");
-
-  // Read stored data from Flash
-  // We know g_DataOffset is the end of data (assuming it wasn't reset by
-  // reboot) If rebooted, g_DataOffset is 0. We might need to store "Data
-  // Length" in Config Sector? For now, let's assume we read until 0xFF or some
-  // limit. Better: For this demo, we only offload if we have g_DataOffset > 0,
-  // same session. OR we scan.
-
-  // Simple approach: Read 4KB chunks and send
-  // Since we don't have stored length after reboot, reading until 0xFF is risky
-  // (uninitialized flash). Let's just read first 4KB for demo or use
-  // g_DataOffset if valid.
-
-  uint32_t len_to_read = g_DataOffset;
-  if (len_to_read == 0)
-    len_to_read = 1024; // Fallback to 1KB dump logic if 0
-
-  uint8_t buf[64];
-  uint32_t read_ptr = 0;
-
-  while (read_ptr < len_to_read) {
-    W25Q_Read(buf, DATA_ADDR_START + read_ptr, 64);
-    // Ensure null term or send as bytes?
-    // Our data is text "100,5.0...\n".
-    // We can just pipe it out.
-    // Be careful with newlines.
-
-    HAL_UART_Transmit(&huart1, buf, 64, 100);
-    read_ptr += 64;
-  }
+uint8_t EraseChip(void) {
+  // Full wipe including the config sector (Takes a while!). CLEAR_FLASH is
+  // the everyday way to drop old runs; this is a factory reset. Runs in the
+  // background; the main loop keeps running and EraseChipDone reports
+  // completion. Returns 0 if the job queue is full: a blocking erase would
+  // stall the main loop for the whole ~20 s.
+  W25Q_Job_t job = {0};
+  job.type = W25Q_JOB_ERASE_CHIP;
+  job.done = EraseChipDone;
+  if (!W25Q_AsyncSubmit(&job))
+    return 0;
+  g_ChipErasing = 1;
+  return 1;
+}
 
-  SendResponse("\nEND_DATA\n");
+static void LogRunHeader(uint32_t run_time_ms) {
+  Log_Header_t hdr = {0};
+  hdr.Magic = LOG_MAGIC;
+  hdr.Version = LOG_FORMAT_VERSION;
+  hdr.HeaderSize = sizeof(Log_Header_t);
+  hdr.ChannelCount = ACQ_CHANNELS;
+  hdr.RecordSize = LOG_RECORD_SIZE(hdr.ChannelCount);
+  hdr.SamplePeriodUs = Acq_PeriodUs();
+  hdr.RunTimeMs = run_time_ms;
+  hdr.TestType = g_TestType;
+  hdr.DacLsb_uV = LOG_DAC_LSB_UV;
+  for (uint8_t r = 0; r < LOG_MAX_RANGES; r++)
+    hdr.RangeLsb_fA[r] = AutoRange_LsbFa(r); // 0 past the ladder
+  FlashLog_Append(&g_DataLog, (uint8_t *)&hdr, sizeof(hdr));
 }
+
 /*
- * DAC CONTROL FUNCTIONS (STUBS)
- * USER: You need to implement the actual SPI commands here based on your DAC
- * part number.
+ * Binary fixed-point record (see log_format.h), decoded to CSV by the GUI.
+ * Time comes from the acquisition tick, so it is exact even if the loop
+ * ran late. Setpoint in mV (what the DAC was outputting at the burst).
  */
+static void LogSample(const Acq_Sample_t *sample) {
+  Log_Record_t rec;
+  rec.TimeMs = (uint32_t)((uint64_t)(sample->Tick - g_RunStartTick) *
+                          Acq_PeriodUs() / 1000);
+  rec.DacSetpoint = (int16_t)DAC_CodeToMv(g_BiasDac, sample->DacCode);
+  rec.Ranges = sample->Ranges;
+  for (uint8_t i = 0; i < ACQ_CHANNELS; i++)
+    rec.Reading[i] = sample->Raw[i]; // Scaled by the range on the host
+  FlashLog_Append(&g_DataLog, (uint8_t *)&rec, LOG_RECORD_SIZE(ACQ_CHANNELS));
+}
 
-void DAC_SetVoltage_0_10V(float voltage) {
-  // 1. Enable DAC CS (Expander 3, Pin 0 for DAC 0-10V)
-  MCP_WritePin(&hExpander3, EXP3_DAC_0_10V_CS_PIN, GPIO_PIN_RESET);
-
-  // 2. Send SPI Command to DAC
-  // Example for 12-bit DAC:
-  // uint16_t code = (uint16_t)((voltage / 10.0f) * 4095.0f);
-  // uint8_t data[2] = { (code >> 8) & 0xFF, code & 0xFF };
-  // HAL_SPI_Transmit(&hspi1, data, 2, 100);
+// Only with a run open. START waits for ERASE_CHIP (CMD_FLAG_FLASH), so the
+// drain never sits behind a chip erase.
+static void EndRun(void) {
+  // Data must be on flash before the directory says it is
+  FlashLog_Flush(&g_DataLog);
+  W25Q_AsyncDrain();
+  RunIndex_End(FlashLog_Size(&g_DataLog));
+  if (FlashLog_Lost(&g_DataLog) > 0) {
+    char msg[48];
+    snprintf(msg, sizeof(msg), "WARN: %lu Pages Lost\n",
+             (unsigned long)FlashLog_Lost(&g_DataLog));
+    SendResponse(msg);
+  }
+}
 
-  // 3. Disable DAC CS
-  MCP_WritePin(&hExpander3, EXP3_DAC_0_10V_CS_PIN, GPIO_PIN_SET);
+void ListRuns(void) {
+  // One line per run: id, log sector, offset, length, sample period, type,
+  // configured duration in seconds
+  char msg[80];
+  RunEntry_t e;
+  FlashLog_Flush(&g_DataLog); // A new run is listed once its sector is
+  W25Q_AsyncDrain();          // stamped on flash
+  uint16_t cursor = 0;
+  uint16_t count = 0;
+  while (RunIndex_Next(&cursor, &e)) {
+    count++;
+    uint32_t len = (e.Length == RUN_LENGTH_OPEN) ? g_DataOffset : e.Length;
+    snprintf(msg, sizeof(msg), "RUN %u,%lu,%u,%lu,%lu,%u,%lu\n", e.RunId,
+             (unsigned long)e.StartSeq, e.StartOffset, (unsigned long)len,
+             (unsigned long)e.SamplePeriodUs, e.TestType,
+             (unsigned long)(e.RunTimeMinutes * 60.0f));
+    SendResponse(msg);
+  }
+  snprintf(msg, sizeof(msg), "OK: %u Runs\n", count);
+  SendResponse(msg);
 }
 
-void DAC_SetVoltage_N1_1V(float voltage) {
-  // 1. Enable DAC CS (Expander 3, Pin 1 for DAC -1 to 1V)
-  MCP_WritePin(&hExpander3, EXP3_DAC_N1_1V_CS_PIN, GPIO_PIN_RESET);
+void OffloadMemory(uint16_t run_id) {
+  if (Offload_Active()) {
+    SendResponse("ERR: Offload Busy\n");
+    return;
+  }
 
-  // 2. Send SPI Command implementation ...
+  FlashLog_Flush(&g_DataLog); // Make sure buffered records are on flash
+  W25Q_AsyncDrain();
+
+  // The run directory gives the exact location and length of each run, so
+  // this also works after a reboot (e.g. offline tests).
+  RunEntry_t run;
+  uint8_t found =
+      (run_id == 0) ? RunIndex_Latest(&run) : RunIndex_Find(run_id, &run);
+  if (!found) {
+    SendResponse("ERR: No Such Run\n");
+    return;
+  }
 
-  // 3. Disable DAC CS
-  MCP_WritePin(&hExpander3, EXP3_DAC_N1_1V_CS_PIN, GPIO_PIN_SET);
-}
+  uint32_t len_to_read = run.Length;
+  if (len_to_read == RUN_LENGTH_OPEN)
+    len_to_read = FlashLog_Size(&g_DataLog); // Run still in progress
+
+  // Data is binary (log_format.h), so announce the exact byte count; the
+  // GUI reads that many raw bytes instead of splitting on newlines.
+  // Framed: the offload sends BEGIN, then DATA frames as the host
+  // acknowledges them
+  if (g_ReplyFramed) {
+    Offload_Start(run.StartSeq, run.StartOffset, len_to_read, 1);
+    return;
+  }
 
+  // The whole transfer goes on the bulk lane, with later responses held
+  // back so they cannot land inside the raw data. The main loop steps the
+  // offload and queues END_DATA once the last chunk is read.
+  char msg[32];
+  int n = snprintf(msg, sizeof(msg), "BEGIN_DATA %lu\n",
+                   (unsigned long)len_to_read);
+  UartTx_HoldCtrl();
+  UartTx_WriteWait(UART_TX_BULK, msg, n);
+  Offload_Start(run.StartSeq, run.StartOffset, len_to_read, 0);
+}
 /**
  * @brief System Clock Configuration
  * @retval None
- * @note This is a generic configuration for STM32F401.
- *       If your board has a crystal, you might need to enable HSE.
- *       Here we use HSI (16MHz) for safety/simplicity.
+ * @note Sets up BIOFET_CLOCK_PROFILE (main.h). If the crystal of the PLL
+ *       profile does not start, the board runs on the 16MHz HSI instead;
+ *       g_ClockProfile holds the profile actually in use. Timers, UART and
+ *       SPI prescalers are all derived from the resulting clocks.
  */
 void SystemClock_Config(void) {
   RCC_OscInitTypeDef RCC_OscInitStruct = {0};
   RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+  uint32_t latency = FLASH_LATENCY_0;
 
   /** Configure the main internal regulator output voltage
    */
   __HAL_RCC_PWR_CLK_ENABLE();
-  __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE2);
-  /** Initializes the RCC Oscillators according to the specified parameters
-   * in the RCC_OscInitTypeDef structure.
-   */
-  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI;
-  RCC_OscInitStruct.HSIState = RCC_HSI_ON;
-  RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
-  RCC_OscInitStruct.PLL.PLLState =
-      RCC_PLL_NONE; // Run directly from HSI for now
-  if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK) {
-    Error_Handler();
-  }
-  /** Initializes the CPU, AHB and APB buses clocks
-   */
+  __HAL_PWR_VOLTAGESCALING_CONFIG(g_ClockProfile == CLOCK_PROFILE_LOW_POWER
+                                      ? PWR_REGULATOR_VOLTAGE_SCALE3
+                                      : PWR_REGULATOR_VOLTAGE_SCALE2);
+
   RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK |
                                 RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
   RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
@@ -421,7 +978,38 @@ void SystemClock_Config(void) {
   RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
   RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
 
-  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_0) != HAL_OK) {
+  if (g_ClockProfile == CLOCK_PROFILE_PLL84) {
+    // 25MHz / 25 * 336 / 4 = 84MHz (PLLQ 7 gives 48MHz for USB)
+    RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSE;
+    RCC_OscInitStruct.HSEState = RCC_HSE_ON;
+    RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
+    RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSE;
+    RCC_OscInitStruct.PLL.PLLM = HSE_VALUE / 1000000;
+    RCC_OscInitStruct.PLL.PLLN = 336;
+    RCC_OscInitStruct.PLL.PLLP = RCC_PLLP_DIV4;
+    RCC_OscInitStruct.PLL.PLLQ = 7;
+    if (HAL_RCC_OscConfig(&RCC_OscInitStruct) == HAL_OK) {
+      RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+      RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV2; // APB1 max 42MHz
+      latency = FLASH_LATENCY_2; // 2 wait states for 64-90MHz at 3.3V
+    } else {
+      g_ClockProfile = CLOCK_PROFILE_HSI; // No crystal: stay on HSI
+    }
+  }
+
+  if (g_ClockProfile != CLOCK_PROFILE_PLL84) {
+    RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI;
+    RCC_OscInitStruct.HSIState = RCC_HSI_ON;
+    RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+    RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
+    if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK) {
+      Error_Handler();
+    }
+    if (g_ClockProfile == CLOCK_PROFILE_LOW_POWER)
+      RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV2;
+  }
+
+  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, latency) != HAL_OK) {
     Error_Handler();
   }
 }
@@ -439,8 +1027,8 @@ static void MX_SPI1_Init(void) {
   hspi1.Init.CLKPolarity = SPI_POLARITY_LOW;
   hspi1.Init.CLKPhase = SPI_PHASE_1EDGE;
   hspi1.Init.NSS = SPI_NSS_SOFT; // Software Slave Select (managed by GPIOs)
-  hspi1.Init.BaudRatePrescaler =
-      SPI_BAUDRATEPRESCALER_16; // Adjust speed as needed
+  // Slowest device; each transaction selects its own (spi_bus.h)
+  hspi1.Init.BaudRatePrescaler = g_SpiBusCr1[SPI_DEV_EXPANDER] & SPI_CR1_BR;
   hspi1.Init.FirstBit = SPI_FIRSTBIT_MSB;
   hspi1.Init.TIMode = SPI_TIMODE_DISABLE;
   hspi1.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
@@ -469,6 +1057,179 @@ static void MX_USART1_UART_Init(void) {
   }
 }
 
+/*
+ * The divider gives PCLK2 / n for a whole n >= 8 (oversampling by 8 above
+ * PCLK2 / 16). Rates it cannot hit within 2% are refused.
+ */
+static uint8_t UART_BaudValid(uint32_t baud) {
+  uint32_t pclk = HAL_RCC_GetPCLK2Freq();
+  if (baud < 1200 || baud > pclk / 8)
+    return 0;
+
+  uint32_t actual = pclk / ((pclk + baud / 2) / baud);
+  uint32_t error = (actual > baud) ? actual - baud : baud - actual;
+  return error * 50 <= baud;
+}
+
+// Not saved: the link always starts at 115200 after a reset
+static void UART_SetBaud(uint32_t baud) {
+  UartTx_Flush(); // The reply goes out at the old rate
+  UartRx_Stop();
+  huart1.Init.BaudRate = baud;
+  huart1.Init.OverSampling = (baud > HAL_RCC_GetPCLK2Freq() / 16)
+                                 ? UART_OVERSAMPLING_8
+                                 : UART_OVERSAMPLING_16;
+  if (HAL_UART_Init(&huart1) != HAL_OK) {
+    Error_Handler();
+  }
+  UartRx_Restart();
+}
+
+/**
+ * @brief DMA Initialization Function
+ * @note  Streams (STM32F401 DMA2 request map):
+ *        SPI1_RX   -> DMA2 Stream0 Channel 3
+ *        SPI1_TX   -> DMA2 Stream3 Channel 3 (clocks out dummy bytes on RX)
+ *        USART1_RX -> DMA2 Stream2 Channel 4 (circular)
+ *        USART1_TX -> DMA2 Stream7 Channel 4
+ * @retval None
+ */
+static void MX_DMA_Init(void) {
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  hdma_spi1_rx.Instance = DMA2_Stream0;
+  hdma_spi1_rx.Init.Channel = DMA_CHANNEL_3;
+  hdma_spi1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_spi1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_spi1_rx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_spi1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_spi1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_spi1_rx.Init.Mode = DMA_NORMAL;
+  hdma_spi1_rx.Init.Priority = DMA_PRIORITY_HIGH;
+  hdma_spi1_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_spi1_rx) != HAL_OK) {
+    Error_Handler();
+  }
+  __HAL_LINKDMA(&hspi1, hdmarx, hdma_spi1_rx);
+
+  hdma_spi1_tx.Instance = DMA2_Stream3;
+  hdma_spi1_tx.Init.Channel = DMA_CHANNEL_3;
+  hdma_spi1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_spi1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_spi1_tx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_spi1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_spi1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_spi1_tx.Init.Mode = DMA_NORMAL;
+  hdma_spi1_tx.Init.Priority = DMA_PRIORITY_MEDIUM;
+  hdma_spi1_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_spi1_tx) != HAL_OK) {
+    Error_Handler();
+  }
+  __HAL_LINKDMA(&hspi1, hdmatx, hdma_spi1_tx);
+
+  hdma_usart1_tx.Instance = DMA2_Stream7;
+  hdma_usart1_tx.Init.Channel = DMA_CHANNEL_4;
+  hdma_usart1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_usart1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_usart1_tx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_usart1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_usart1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_usart1_tx.Init.Mode = DMA_NORMAL;
+  hdma_usart1_tx.Init.Priority = DMA_PRIORITY_LOW;
+  hdma_usart1_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_usart1_tx) != HAL_OK) {
+    Error_Handler();
+  }
+  __HAL_LINKDMA(&huart1, hdmatx, hdma_usart1_tx);
+
+  hdma_usart1_rx.Instance = DMA2_Stream2;
+  hdma_usart1_rx.Init.Channel = DMA_CHANNEL_4;
+  hdma_usart1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_usart1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_usart1_rx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_usart1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_usart1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_usart1_rx.Init.Mode = DMA_CIRCULAR;
+  hdma_usart1_rx.Init.Priority = DMA_PRIORITY_MEDIUM;
+  hdma_usart1_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_usart1_rx) != HAL_OK) {
+    Error_Handler();
+  }
+  __HAL_LINKDMA(&huart1, hdmarx, hdma_usart1_rx);
+
+  HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+  HAL_NVIC_SetPriority(DMA2_Stream3_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream3_IRQn);
+  HAL_NVIC_SetPriority(DMA2_Stream2_IRQn, 2, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream2_IRQn);
+  HAL_NVIC_SetPriority(DMA2_Stream7_IRQn, 2, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream7_IRQn);
+  HAL_NVIC_SetPriority(SPI1_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(SPI1_IRQn);
+  // UART TX DMA completes through the USART TC interrupt, RX lines end
+  // with the IDLE interrupt
+  HAL_NVIC_SetPriority(USART1_IRQn, 2, 0);
+  HAL_NVIC_EnableIRQ(USART1_IRQn);
+}
+
+/**
+ * @brief TIM2 Initialization Function
+ * @note  32-bit timer counting at 1 MHz; the waveform engine sets the
+ *        period (ARR) per ramp. Same priority as the SPI/DMA interrupts so
+ *        it never lands in the middle of their state updates.
+ * @retval None
+ */
+static void MX_TIM2_Init(void) {
+  __HAL_RCC_TIM2_CLK_ENABLE();
+
+  // APB1 timers run at 2x PCLK1 whenever the APB1 prescaler is not 1
+  uint32_t tim_clk = HAL_RCC_GetPCLK1Freq();
+  if (tim_clk != HAL_RCC_GetHCLKFreq())
+    tim_clk *= 2;
+
+  htim2.Instance = TIM2;
+  htim2.Init.Prescaler = tim_clk / WAVE_TIMER_HZ - 1;
+  htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim2.Init.Period = 1000 - 1;
+  htim2.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_Base_Init(&htim2) != HAL_OK) {
+    Error_Handler();
+  }
+
+  HAL_NVIC_SetPriority(TIM2_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(TIM2_IRQn);
+}
+
+/**
+ * @brief TIM5 Initialization Function (ADC acquisition ticks)
+ * @param None
+ * @retval None
+ */
+static void MX_TIM5_Init(void) {
+  __HAL_RCC_TIM5_CLK_ENABLE();
+
+  // Same clock as TIM2 (APB1); 32-bit, so slow rates need no prescaler tricks
+  uint32_t tim_clk = HAL_RCC_GetPCLK1Freq();
+  if (tim_clk != HAL_RCC_GetHCLKFreq())
+    tim_clk *= 2;
+
+  htim5.Instance = TIM5;
+  htim5.Init.Prescaler = tim_clk / ACQ_TIMER_HZ - 1;
+  htim5.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim5.Init.Period = ACQ_DEFAULT_PERIOD_US - 1;
+  htim5.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim5.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_Base_Init(&htim5) != HAL_OK) {
+    Error_Handler();
+  }
+
+  // Same priority as TIM2: the two bus users never preempt each other
+  HAL_NVIC_SetPriority(TIM5_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(TIM5_IRQn);
+}
+
 /**
  * @brief GPIO Initialization Function
  * @param None
@@ -493,6 +1254,19 @@ static void MX_GPIO_Init(void) {
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
   HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
 
+#if DAC_NATIVE_CS
+  /*Configure GPIO pins : DAC chip selects */
+  HAL_GPIO_WritePin(DAC_0_10V_CS_GPIO_Port, DAC_0_10V_CS_Pin, GPIO_PIN_SET);
+  HAL_GPIO_WritePin(DAC_N1_1V_CS_GPIO_Port, DAC_N1_1V_CS_Pin, GPIO_PIN_SET);
+  GPIO_InitStruct.Pin = DAC_0_10V_CS_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+  HAL_GPIO_Init(DAC_0_10V_CS_GPIO_Port, &GPIO_InitStruct);
+  GPIO_InitStruct.Pin = DAC_N1_1V_CS_Pin;
+  HAL_GPIO_Init(DAC_N1_1V_CS_GPIO_Port, &GPIO_InitStruct);
+#endif
+
   /*Configure GPIO pin : C13 (LED) */
   HAL_GPIO_WritePin(
       LED_GPIO_Port, LED_Pin,
@@ -509,7 +1283,7 @@ static void MX_GPIO_Init(void) {
   GPIO_InitStruct.Pull = GPIO_PULLUP;
   HAL_GPIO_Init(KEY_GPIO_Port, &GPIO_InitStruct);
 
-  /*Configure GPIO pin : FLASH_CS (PB0) */
+  /*Configure GPIO pin : FLASH_CS (PB12) */
   HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin,
                     GPIO_PIN_SET); // Default High (Inactive)
   GPIO_InitStruct.Pin = FLASH_CS_Pin;
@@ -523,6 +1297,15 @@ static void MX_GPIO_Init(void) {
  * @brief Initialize the 3 MCP23S17 Expanders
  */
 static void Expander_Init(void) {
+#if EXP_SHARED_CS
+  // One CS line, hardware addresses
+  MCP_Init(&hExpander1, &hspi1, EXP1_CS_GPIO_Port, EXP1_CS_Pin,
+           EXP1_SPI_ADDR);
+  MCP_Init(&hExpander2, &hspi1, EXP1_CS_GPIO_Port, EXP1_CS_Pin,
+           EXP2_SPI_ADDR);
+  MCP_Init(&hExpander3, &hspi1, EXP1_CS_GPIO_Port, EXP1_CS_Pin,
+           EXP3_SPI_ADDR);
+#else
   // Expander 1: FET 1 & 2
   MCP_Init(&hExpander1, &hspi1, EXP1_CS_GPIO_Port, EXP1_CS_Pin, 0x40);
 
@@ -531,6 +1314,79 @@ static void Expander_Init(void) {
 
   // Expander 3: Peripherals
   MCP_Init(&hExpander3, &hspi1, EXP3_CS_GPIO_Port, EXP3_CS_Pin, 0x40);
+#endif
+}
+
+/**
+ * @brief Bind peripheral chip selects to native pins or expander pins
+ */
+static void ChipSelect_Init(void) {
+#if DAC_NATIVE_CS
+  ChipSel_InitNative(&g_CsDac0_10V, DAC_0_10V_CS_GPIO_Port, DAC_0_10V_CS_Pin);
+  ChipSel_InitNative(&g_CsDacN1_1V, DAC_N1_1V_CS_GPIO_Port, DAC_N1_1V_CS_Pin);
+#else
+  ChipSel_InitExpander(&g_CsDac0_10V, &hExpander3, EXP3_DAC_0_10V_CS_PIN);
+  ChipSel_InitExpander(&g_CsDacN1_1V, &hExpander3, EXP3_DAC_N1_1V_CS_PIN);
+#endif
+}
+
+// ==============================================================================
+//  INTERRUPT HANDLERS
+// ==============================================================================
+
+void DMA2_Stream0_IRQHandler(void) { HAL_DMA_IRQHandler(&hdma_spi1_rx); }
+
+void DMA2_Stream3_IRQHandler(void) { HAL_DMA_IRQHandler(&hdma_spi1_tx); }
+
+void DMA2_Stream2_IRQHandler(void) { HAL_DMA_IRQHandler(&hdma_usart1_rx); }
+
+void DMA2_Stream7_IRQHandler(void) { HAL_DMA_IRQHandler(&hdma_usart1_tx); }
+
+void SPI1_IRQHandler(void) { HAL_SPI_IRQHandler(&hspi1); }
+
+void USART1_IRQHandler(void) { HAL_UART_IRQHandler(&huart1); }
+
+void TIM2_IRQHandler(void) { HAL_TIM_IRQHandler(&htim2); }
+
+void TIM5_IRQHandler(void) { HAL_TIM_IRQHandler(&htim5); }
+
+void SysTick_Handler(void) {
+  HAL_IncTick();
+  Sched_OnTick();
+}
+
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
+  UartRx_OnEvent(huart, Size);
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+  UartTx_OnTxComplete(huart);
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+  UartRx_OnError(huart);
+  UartTx_OnError(huart);
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi) {
+  SpiBus_OnComplete(hspi);
+}
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi) {
+  SpiBus_OnComplete(hspi);
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) {
+  SpiBus_OnComplete(hspi);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) { SpiBus_OnError(hspi); }
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+  if (htim->Instance == TIM2)
+    Waveform_OnTick();
+  else if (htim->Instance == TIM5)
+    Acq_OnTick();
 }
 
 void Error_Handler(void) {
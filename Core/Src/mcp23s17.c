@@ -6,6 +6,30 @@
  */
 
 #include "mcp23s17.h"
+#include "perf.h"
+#include "spi_bus.h"
+
+/*
+ * Writes n consecutive registers starting at reg in one CS cycle. The
+ * address pointer auto-increments in sequential mode (IOCON.BANK = 0, so
+ * each A register is directly followed by its B register).
+ */
+static void MCP_WriteRegs(MCP23S17_Handle_t *dev, uint8_t reg,
+                          const uint8_t *val, uint8_t n) {
+  uint8_t data[4];
+  data[0] = dev->device_addr; // Write
+  data[1] = reg;
+  for (uint8_t i = 0; i < n; i++)
+    data[2 + i] = val[i];
+
+  SpiBus_Xfer_t x = {0};
+  x.Dev = SPI_DEV_EXPANDER;
+  x.CsPort = dev->cs_port;
+  x.CsPin = dev->cs_pin;
+  x.Tx = data;
+  x.Len = 2 + n;
+  SpiBus_Transfer(&x, 1);
+}
 
 /*
  * Initializes the MCP23S17 instance.
@@ -23,29 +47,23 @@ void MCP_Init(MCP23S17_Handle_t *dev, SPI_HandleTypeDef *hspi,
   // Deselect initially
   HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
 
-  // Configure IODIRA and IODIRB to all OUTPUTS (0x00)
-  // Opcode = addr | 0x00 (Write)
-  // Register Address
-  // Data
-
-  uint8_t data[3];
-
-  // Set Port A to Output
-  data[0] = dev->device_addr; // Write
-  data[1] = MCP_IODIRA;
-  data[2] = 0x00; // All Output
-
-  HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_RESET);
-  HAL_SPI_Transmit(dev->hspi, data, 3, 100);
-  HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
+  // A non-zero hardware address needs HAEN. Until it is set, every chip on
+  // the CS line answers to MCP_BASE_ADDR, so this reaches all of them.
+  if (addr != MCP_BASE_ADDR) {
+    uint8_t iocon = MCP_IOCON_HAEN;
+    dev->device_addr = MCP_BASE_ADDR;
+    MCP_WriteRegs(dev, MCP_IOCON, &iocon, 1);
+    dev->device_addr = addr;
+  }
 
-  // Set Port B to Output
-  data[1] = MCP_IODIRB;
-  data[2] = 0x00; // All Output
+  // Port A and B to all OUTPUTS (0x00): IODIRA, IODIRB in one write
+  uint8_t regs[2] = {0x00, 0x00};
+  MCP_WriteRegs(dev, MCP_IODIRA, regs, 2);
 
-  HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_RESET);
-  HAL_SPI_Transmit(dev->hspi, data, 3, 100);
-  HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
+  // Latches may hold stale values if only the MCU was reset, so clear them
+  // once; from here on latched_output mirrors OLATA/OLATB
+  MCP_WriteRegs(dev, MCP_OLATA, regs, 2);
+  dev->latched_output = 0x0000;
 }
 
 void MCP_WritePin(MCP23S17_Handle_t *dev, uint16_t pin, uint8_t state) {
@@ -63,25 +81,51 @@ void MCP_TogglePin(MCP23S17_Handle_t *dev, uint16_t pin) {
 }
 
 /*
- * Writes the cached 16-bit value to OLATA and OLATB
+ * Writes a 16-bit value to OLATA (low byte) and OLATB (high byte).
+ * Ports whose latch already holds the value are skipped; if both changed
+ * they go out in one 4-byte sequential write.
  */
 void MCP_WritePort(MCP23S17_Handle_t *dev, uint16_t val) {
-  uint8_t data[3];
+  uint16_t changed = val ^ dev->latched_output;
+  uint8_t regs[2] = {(uint8_t)(val & 0xFF), (uint8_t)((val >> 8) & 0xFF)};
+
+  dev->current_output = val;
+  if (changed == 0)
+    return;
+
+  // Updated first: an ISR burst that writes the latch itself (acquisition.h)
+  // restores whatever latched_output says when it finishes
+  dev->latched_output = val;
+  PERF_BEGIN(PERF_ZONE_EXPANDER);
+  if ((changed & 0x00FF) && (changed & 0xFF00)) {
+    MCP_WriteRegs(dev, MCP_OLATA, regs, 2);
+  } else if (changed & 0x00FF) {
+    MCP_WriteRegs(dev, MCP_OLATA, &regs[0], 1);
+  } else {
+    MCP_WriteRegs(dev, MCP_OLATB, &regs[1], 1);
+  }
+  PERF_END(PERF_ZONE_EXPANDER);
+}
 
-  // Write Port A (Low Byte)
-  data[0] = dev->device_addr;
-  data[1] = MCP_GPIOA; // Address for GPIOA
-  data[2] = (uint8_t)(val & 0xFF);
+void MCP_SetPin(MCP23S17_Handle_t *dev, uint16_t pin, uint8_t state) {
+  MCP_SetBits(dev, 1 << pin, state ? (1 << pin) : 0);
+}
 
-  HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_RESET);
-  HAL_SPI_Transmit(dev->hspi, data, 3, 100);
-  HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
+void MCP_SetBits(MCP23S17_Handle_t *dev, uint16_t mask, uint16_t bits) {
+  dev->current_output = (dev->current_output & ~mask) | (bits & mask);
+}
 
-  // Write Port B (High Byte)
-  data[1] = MCP_GPIOB; // Address for GPIOB
-  data[2] = (uint8_t)((val >> 8) & 0xFF);
+void MCP_Flush(MCP23S17_Handle_t *dev) {
+  MCP_WritePort(dev, dev->current_output);
+}
 
-  HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_RESET);
-  HAL_SPI_Transmit(dev->hspi, data, 3, 100);
-  HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
+/*
+ * Sends the staged changes of several expanders back to back. Every
+ * MCP23S17 frame starts with its own opcode, so each changed expander
+ * still gets one CS cycle, but unchanged ones cost nothing and there is
+ * no per-pin traffic.
+ */
+void MCP_FlushGroup(MCP23S17_Handle_t *const *devs, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++)
+    MCP_Flush(devs[i]);
 }
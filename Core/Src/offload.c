@@ -0,0 +1,184 @@
+/*
+ * offload.c
+ *
+ *  Created on: Mar 6, 2026
+ *      Author: BioFET Team
+ */
+
+#include "offload.h"
+#include "flash_log.h"
+#include "frame.h"
+#include "uart_tx.h"
+#include <string.h>
+
+_Static_assert(OFFLOAD_FRAME_DATA + 4 <= FRAME_DATA_MAX,
+               "FRAME_DATA payload too long");
+
+static uint32_t off_seq; // Log position of byte 0
+static uint16_t off_offset;
+static uint32_t off_len;
+static uint32_t off_next = 0;    // Next byte to read
+static uint32_t off_acked = 0;   // Framed: bytes the host confirmed
+static uint16_t off_reading = 0; // Bytes of the DMA read in flight
+static uint8_t off_framed = 0;
+static uint8_t off_begun = 0; // Framed: FRAME_BEGIN is queued
+static uint8_t off_active = 0;
+static uint8_t off_retries = 0;
+static uint32_t off_last_progress = 0; // Tick of the last ACK progress
+
+// Read buffer for framed mode: offset, then the data (FRAME_DATA layout)
+static uint8_t off_frame_buf[4 + OFFLOAD_FRAME_DATA];
+
+void Offload_Start(uint32_t seq, uint16_t offset, uint32_t len,
+                   uint8_t framed) {
+  off_seq = seq;
+  off_offset = offset;
+  off_len = len;
+  off_next = 0;
+  off_acked = 0;
+  off_reading = 0;
+  off_framed = framed;
+  off_begun = 0;
+  off_retries = 0;
+  off_last_progress = HAL_GetTick();
+  off_active = 1;
+}
+
+uint8_t Offload_Active(void) { return off_active; }
+
+uint8_t Offload_Framed(void) { return off_framed; }
+
+void Offload_OnAck(uint32_t offset) {
+  if (!off_active || !off_framed || offset <= off_acked || offset > off_len)
+    return;
+  off_acked = offset;
+  if (off_next < offset)
+    off_next = offset; // ACK for frames sent before a rewind
+  off_retries = 0;
+  off_last_progress = HAL_GetTick();
+}
+
+// Everything before offset arrived, the frame at offset did not
+void Offload_OnNak(uint32_t offset) {
+  if (!off_active || !off_framed || offset < off_acked || offset > off_next)
+    return;
+  Offload_OnAck(offset);
+  off_next = offset; // Frames still queued past it are ignored by the host
+  off_last_progress = HAL_GetTick();
+}
+
+/*
+ * Bytes to read next at byte pos of the transfer, at most max. Reads stop
+ * at sector ends so the header of the next sector is never sent.
+ */
+static uint32_t Offload_NextChunk(uint32_t pos, uint32_t max,
+                                  uint32_t *addr) {
+  uint32_t seq = off_seq;
+  uint16_t offset = off_offset;
+  FlashLog_Advance(&seq, &offset, pos);
+  *addr = FlashLog_DataAddr(seq, offset);
+
+  uint32_t n = off_len - pos;
+  if (n > max)
+    n = max;
+  if (n > LOG_SECTOR_PAYLOAD - offset)
+    n = LOG_SECTOR_PAYLOAD - offset;
+  return n;
+}
+
+static Offload_Status_t Offload_ServiceRaw(void) {
+  if (off_reading > 0) {
+    if (!W25Q_ReadDMAComplete())
+      return OFFLOAD_BUSY;
+    UartTx_Commit(UART_TX_BULK, off_reading);
+    off_reading = 0;
+  }
+
+  if (off_next == off_len) {
+    off_active = 0;
+    return OFFLOAD_FINISHED;
+  }
+
+  uint8_t *dst;
+  uint32_t addr;
+  uint32_t n = UartTx_Reserve(UART_TX_BULK, &dst);
+  uint32_t want = Offload_NextChunk(off_next, OFFLOAD_STEP_SIZE, &addr);
+
+  // Tiny reads waste the command overhead: while the lane is nearly full,
+  // wait for it to drain. Space cut short by the ring end is always taken.
+  if (n < want && n < OFFLOAD_MIN_STEP && UartTx_Room(UART_TX_BULK) == n)
+    return OFFLOAD_BUSY;
+  if (n > want)
+    n = want;
+
+  if (W25Q_ReadDMA(dst, addr, n) != HAL_OK)
+    return OFFLOAD_BUSY; // SPI busy, retry next pass
+
+  off_next += n;
+  off_reading = n;
+  return OFFLOAD_BUSY;
+}
+
+static Offload_Status_t Offload_ServiceFramed(void) {
+  if (!off_begun) {
+    // Waits here for lane room instead of in the command handler
+    if (!Frame_Send(UART_TX_BULK, FRAME_BEGIN, &off_len, 4))
+      return OFFLOAD_BUSY;
+    off_begun = 1;
+    off_last_progress = HAL_GetTick(); // ACK timeout runs from here
+  }
+
+  if (off_reading > 0) {
+    if (!W25Q_ReadDMAComplete())
+      return OFFLOAD_BUSY;
+    // Room was checked before the read, and the stream stays off the lane
+    // meanwhile (stream.c). Should the frame still not fit, it is read
+    // again rather than left for the host to NAK.
+    uint32_t at;
+    memcpy(&at, off_frame_buf, 4);
+    if (!Frame_Send(UART_TX_BULK, FRAME_DATA, off_frame_buf,
+                    4 + off_reading) &&
+        at < off_next)
+      off_next = at;
+    off_reading = 0;
+  }
+
+  if (off_acked == off_len) {
+    if (!Frame_Send(UART_TX_BULK, FRAME_END, &off_len, 4))
+      return OFFLOAD_BUSY;
+    off_active = 0;
+    return OFFLOAD_FINISHED;
+  }
+
+  if (HAL_GetTick() - off_last_progress > OFFLOAD_ACK_TIMEOUT_MS) {
+    // Lost frames or ACKs: go back to the first unconfirmed byte
+    if (++off_retries > OFFLOAD_MAX_RETRIES) {
+      off_active = 0;
+      return OFFLOAD_ABORTED;
+    }
+    off_next = off_acked;
+    off_last_progress = HAL_GetTick();
+  }
+
+  if (off_next == off_len || off_next - off_acked >= OFFLOAD_WINDOW)
+    return OFFLOAD_BUSY; // Waiting for ACKs
+
+  uint32_t addr;
+  uint32_t n = Offload_NextChunk(off_next, OFFLOAD_FRAME_DATA, &addr);
+  if (UartTx_Room(UART_TX_BULK) < FRAME_WIRE_SIZE(4 + n))
+    return OFFLOAD_BUSY;
+
+  if (W25Q_ReadDMA(&off_frame_buf[4], addr, n) != HAL_OK)
+    return OFFLOAD_BUSY;
+
+  memcpy(off_frame_buf, &off_next, 4); // Little-endian, as on the wire
+  off_next += n;
+  off_reading = n;
+  return OFFLOAD_BUSY;
+}
+
+Offload_Status_t Offload_Service(void) {
+  if (!off_active)
+    return OFFLOAD_DONE;
+  return off_framed ? Offload_ServiceFramed() : Offload_ServiceRaw();
+}
@@ -0,0 +1,45 @@
+/*
+ * perf.c
+ *
+ *  Created on: Apr 14, 2026
+ *      Author: BioFET Team
+ */
+
+#include "perf.h"
+
+Perf_Stats_t g_PerfStats[PERF_ZONE_COUNT];
+
+static const char *const zone_names[PERF_ZONE_COUNT] = {
+    [PERF_ZONE_COMMAND] = "command",
+    [PERF_ZONE_LOG] = "log",
+    [PERF_ZONE_FLASH] = "flash",
+    [PERF_ZONE_FLASH_WAIT] = "flash_wait",
+    [PERF_ZONE_DAC] = "dac",
+    [PERF_ZONE_EXPANDER] = "expander",
+    [PERF_ZONE_UART] = "uart",
+};
+
+void Perf_Init(void) {
+#if BIOFET_PERF
+  // The counter runs only while trace is enabled
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+  Perf_Reset();
+}
+
+void Perf_Reset(void) {
+  for (uint8_t i = 0; i < PERF_ZONE_COUNT; i++) {
+    g_PerfStats[i].Count = 0;
+    g_PerfStats[i].MinCycles = UINT32_MAX;
+    g_PerfStats[i].MaxCycles = 0;
+    g_PerfStats[i].TotalCycles = 0;
+  }
+}
+
+const char *Perf_ZoneName(Perf_Zone_t zone) { return zone_names[zone]; }
+
+uint32_t Perf_CyclesToUs(uint32_t cycles) {
+  return (uint32_t)(((uint64_t)cycles * 1000000) / SystemCoreClock);
+}
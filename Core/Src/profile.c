@@ -0,0 +1,169 @@
+/*
+ * profile.c
+ *
+ *  Created on: Mar 20, 2026
+ *      Author: BioFET Team
+ */
+
+#include "profile.h"
+#include <string.h>
+
+void Profile_Clear(Profile_t *prof) {
+  memset(prof, 0, sizeof(*prof));
+  prof->Magic = PROFILE_MAGIC;
+  prof->Channel = PROF_CH_HV;
+  prof->Cycles = 1;
+}
+
+uint8_t Profile_AddSegment(Profile_t *prof, const Profile_Segment_t *seg) {
+  if (prof->Count >= PROFILE_MAX_SEGMENTS || seg->DurationMs == 0 ||
+      seg->DurationMs > PROFILE_MAX_SEGMENT_MS || seg->Repeat == 0)
+    return 0;
+
+  switch (seg->Type) {
+  case PROF_SEG_RAMP:
+  case PROF_SEG_HOLD:
+    break;
+  case PROF_SEG_STAIR:
+    if (seg->Param == 0 || seg->Param > DAC_MAX_CODE + 1)
+      return 0;
+    break;
+  case PROF_SEG_PULSE:
+    if (seg->Param == 0 || seg->Param >= seg->DurationMs)
+      return 0;
+    break;
+  default:
+    return 0;
+  }
+
+  prof->Segment[prof->Count++] = *seg;
+  return 1;
+}
+
+uint32_t Profile_DurationMs(const Profile_t *prof) {
+  uint64_t total = 0;
+  for (uint8_t i = 0; i < prof->Count; i++)
+    total += (uint64_t)prof->Segment[i].DurationMs * prof->Segment[i].Repeat;
+  total *= prof->Cycles;
+  return (total > UINT32_MAX) ? UINT32_MAX : (uint32_t)total;
+}
+
+void Profile_Save(const Profile_t *prof) {
+  W25Q_Write((uint8_t *)prof, PROFILE_ADDR_START, sizeof(*prof));
+}
+
+uint8_t Profile_Load(Profile_t *prof) {
+  W25Q_Read((uint8_t *)prof, PROFILE_ADDR_START, sizeof(*prof));
+  if (prof->Magic != PROFILE_MAGIC || prof->Count > PROFILE_MAX_SEGMENTS ||
+      prof->Cycles == 0 || prof->Channel > PROF_CH_LV) {
+    Profile_Clear(prof);
+    return 0;
+  }
+  return 1;
+}
+
+// ============================================================================
+// STEP GENERATOR
+// ============================================================================
+
+// Sets up the steps of the current repetition of the current segment
+static void Profile_BeginRep(Profile_Cursor_t *cur) {
+  const Profile_Segment_t *seg = &cur->prof->Segment[cur->seg];
+
+  cur->c0 = DAC_MvToCode(cur->ch, seg->V1Mv);
+  cur->c1 = DAC_MvToCode(cur->ch, seg->V2Mv);
+  cur->dur_us = (uint64_t)seg->DurationMs * 1000;
+  cur->step = 0;
+
+  switch (seg->Type) {
+  case PROF_SEG_RAMP: {
+    // One step per code, both ends included, fewer if the steps would be
+    // too short
+    uint32_t codes = ((cur->c1 > cur->c0) ? cur->c1 - cur->c0
+                                          : cur->c0 - cur->c1) + 1;
+    uint64_t max_steps = cur->dur_us / WAVE_MIN_PERIOD_US;
+    cur->steps = (codes < max_steps) ? codes : (uint32_t)max_steps;
+    break;
+  }
+  case PROF_SEG_STAIR:
+    cur->steps = seg->Param;
+    break;
+  case PROF_SEG_PULSE:
+    cur->steps = 2;
+    break;
+  default:
+    cur->steps = 1;
+    break;
+  }
+  if (cur->steps == 0)
+    cur->steps = 1;
+}
+
+// Moves to the next repetition, segment or cycle; returns 0 at the end
+static uint8_t Profile_Advance(Profile_Cursor_t *cur) {
+  if (++cur->rep < cur->prof->Segment[cur->seg].Repeat)
+    return 1;
+  cur->rep = 0;
+  if (++cur->seg < cur->prof->Count)
+    return 1;
+  cur->seg = 0;
+  return ++cur->cycle < cur->prof->Cycles;
+}
+
+/*
+ * Waveform source: the code and hold time of the next step. Step k of n
+ * starts at dur * k / n, so the hold times add up to the exact segment
+ * duration without accumulating rounding.
+ */
+static uint8_t Profile_Next(void *ctx, uint16_t *frame, uint32_t *hold_us) {
+  Profile_Cursor_t *cur = (Profile_Cursor_t *)ctx;
+
+  if (cur->done)
+    return 0;
+  if (cur->step >= cur->steps) {
+    if (!Profile_Advance(cur)) {
+      cur->done = 1;
+      return 0;
+    }
+    Profile_BeginRep(cur);
+  }
+
+  const Profile_Segment_t *seg = &cur->prof->Segment[cur->seg];
+  uint32_t k = cur->step++;
+  uint32_t n = cur->steps;
+  int32_t code;
+
+  switch (seg->Type) {
+  case PROF_SEG_RAMP: // The last step outputs V2, like Waveform_LoadRamp
+  case PROF_SEG_STAIR:
+    code = (n > 1) ? cur->c0 + (int32_t)(((int64_t)(cur->c1 - cur->c0) * k) /
+                                         (n - 1))
+                   : cur->c0;
+    break;
+  case PROF_SEG_PULSE: {
+    uint64_t width_us = (uint64_t)seg->Param * 1000;
+    *frame = DAC_FRAME(k == 0 ? cur->c1 : cur->c0);
+    *hold_us = (uint32_t)(k == 0 ? width_us : cur->dur_us - width_us);
+    return 1;
+  }
+  default:
+    code = cur->c0;
+    break;
+  }
+
+  *frame = DAC_FRAME(code);
+  *hold_us = (uint32_t)(cur->dur_us * (k + 1) / n - cur->dur_us * k / n);
+  return 1;
+}
+
+uint8_t Profile_Start(const Profile_t *prof, Profile_Cursor_t *cur,
+                      DAC_Channel_t *ch) {
+  if (prof->Count == 0)
+    return 0;
+
+  memset(cur, 0, sizeof(*cur));
+  cur->prof = prof;
+  cur->ch = ch;
+  Profile_BeginRep(cur);
+  return Waveform_StartSource(ch, Profile_Next, cur);
+}
@@ -0,0 +1,257 @@
+/*
+ * run_index.c
+ *
+ *  Created on: Mar 11, 2026
+ *      Author: BioFET Team
+ */
+
+#include "run_index.h"
+#include "flash_log.h"
+#include <stddef.h>
+#include <string.h>
+
+static uint16_t entry_count = 0; // Entries used in the directory sector
+static uint16_t first_listed = 0; // Entries before the last CLEAR are hidden
+static uint16_t next_run_id = 1;
+static uint32_t head_seq = 1; // Where the next run goes
+static uint16_t head_off = 0;
+static uint8_t run_open = 0; // Last entry still has RUN_LENGTH_OPEN
+
+// Entries kept across a directory compaction
+static RunEntry_t keep_buf[RUN_KEEP_ENTRIES];
+
+static uint32_t RunIndex_EntryAddr(uint16_t index) {
+  return RUNDIR_ADDR_START + (uint32_t)index * sizeof(RunEntry_t);
+}
+
+static uint8_t RunIndex_ReadEntry(uint16_t index, RunEntry_t *e) {
+  W25Q_Read((uint8_t *)e, RunIndex_EntryAddr(index), sizeof(*e));
+  return e->Magic == RUN_ENTRY_MAGIC;
+}
+
+static void RunIndex_WriteEntry(const RunEntry_t *e) {
+  W25Q_Write((uint8_t *)e, RunIndex_EntryAddr(entry_count), sizeof(*e));
+  entry_count++;
+}
+
+// A run is listed until the ring reclaims the sector holding its header
+static uint8_t RunIndex_Listed(uint16_t index, RunEntry_t *e) {
+  return index >= first_listed && RunIndex_ReadEntry(index, e) &&
+         FlashLog_SectorValid(e->StartSeq);
+}
+
+/*
+ * Finds the end of a run that was never closed (power lost while logging).
+ * FlashLog writes sectors in sequence and stamps each header first, so the
+ * run continues for as long as the next slot carries the next sequence.
+ * Only one header per sector plus the pages of the last sector are read.
+ */
+static uint32_t RunIndex_RecoverLength(const RunEntry_t *e) {
+  uint8_t buf[FLASH_PAGE_SIZE];
+
+  if (!FlashLog_SectorValid(e->StartSeq))
+    return 0; // Lost before the first page was programmed
+
+  uint32_t seq = e->StartSeq;
+  while (seq - e->StartSeq < LOG_RING_SECTORS - 1 &&
+         FlashLog_SectorValid(seq + 1))
+    seq++;
+
+  uint32_t data = FlashLog_DataAddr(seq, 0);
+  uint32_t end =
+      (seq == e->StartSeq) ? FlashLog_DataAddr(seq, e->StartOffset) : data;
+  uint32_t page = end - (end % FLASH_PAGE_SIZE);
+  uint32_t sector_end = FlashLog_SectorAddr(seq) + FLASH_SECTOR_SIZE;
+
+  for (; page < sector_end; page += FLASH_PAGE_SIZE) {
+    W25Q_Read(buf, page, FLASH_PAGE_SIZE);
+    // Trailing 0xFF bytes are indistinguishable from erased flash; the
+    // host decoder drops a partial last record.
+    int32_t i = FLASH_PAGE_SIZE - 1;
+    while (i >= 0 && buf[i] == 0xFF)
+      i--;
+    if (i < 0)
+      break;
+    if (page + i + 1 > end)
+      end = page + i + 1;
+  }
+
+  return (seq - e->StartSeq) * LOG_SECTOR_PAYLOAD + (end - data) -
+         ((seq == e->StartSeq) ? e->StartOffset : 0);
+}
+
+static void RunIndex_Reset(void) {
+  W25Q_EraseSector(RUNDIR_ADDR_START);
+  entry_count = 0;
+  first_listed = 0;
+  run_open = 0;
+}
+
+/*
+ * Rewrites a full directory with only the newest listed runs, followed by
+ * a head entry so appending resumes where it left off. Hidden and
+ * reclaimed runs are dropped. A reset during the few ms between erase and
+ * rewrite loses the directory, not the data sectors.
+ */
+static void RunIndex_Compact(void) {
+  uint16_t kept = 0;
+  RunEntry_t e;
+
+  for (int32_t i = entry_count - 1; i >= 0 && kept < RUN_KEEP_ENTRIES; i--) {
+    if (RunIndex_Listed(i, &e))
+      keep_buf[kept++] = e;
+  }
+
+  RunIndex_Reset();
+  while (kept > 0)
+    RunIndex_WriteEntry(&keep_buf[--kept]); // Oldest first
+
+  memset(&e, 0xFF, sizeof(e));
+  e.Magic = RUN_HEAD_MAGIC;
+  e.StartSeq = head_seq;
+  e.StartOffset = head_off;
+  RunIndex_WriteEntry(&e);
+}
+
+void RunIndex_Init(void) {
+  RunEntry_t e;
+
+  entry_count = 0;
+  first_listed = 0;
+  next_run_id = 1;
+  head_seq = 1;
+  head_off = 0;
+  run_open = 0;
+
+  // Directory is append-only: entries are used until the first blank one
+  while (entry_count < RUN_MAX_ENTRIES) {
+    RunIndex_ReadEntry(entry_count, &e);
+    if (e.Magic == 0xFFFFFFFF)
+      break;
+
+    if (e.Magic == RUN_ENTRY_MAGIC) {
+      next_run_id = e.RunId + 1;
+      if (e.Length == RUN_LENGTH_OPEN) {
+        // Run was cut by a reset (e.g. offline test ended by power-off):
+        // work out how far it got and close the entry.
+        e.Length = RunIndex_RecoverLength(&e);
+        W25Q_Write((uint8_t *)&e.Length,
+                   RunIndex_EntryAddr(entry_count) +
+                       offsetof(RunEntry_t, Length),
+                   sizeof(e.Length));
+      }
+      head_seq = e.StartSeq;
+      head_off = e.StartOffset;
+      FlashLog_Advance(&head_seq, &head_off, e.Length);
+    } else if (e.Magic == RUN_CLEAR_MAGIC || e.Magic == RUN_HEAD_MAGIC) {
+      head_seq = e.StartSeq;
+      head_off = e.StartOffset;
+      if (e.Magic == RUN_CLEAR_MAGIC)
+        first_listed = entry_count + 1;
+    } else {
+      // Written by an older firmware with a different layout
+      RunIndex_Reset();
+      return;
+    }
+    entry_count++;
+  }
+}
+
+uint16_t RunIndex_Begin(uint8_t test_type, float run_time_minutes,
+                        uint32_t sample_period_us) {
+  if (entry_count >= RUN_MAX_ENTRIES)
+    RunIndex_Compact();
+
+  RunEntry_t e;
+  memset(&e, 0xFF, sizeof(e)); // Unused fields stay erased
+  e.Magic = RUN_ENTRY_MAGIC;
+  e.RunId = next_run_id++;
+  e.TestType = test_type;
+  e.StartSeq = head_seq;
+  e.StartOffset = head_off;
+  e.SamplePeriodUs = sample_period_us;
+  e.RunTimeMinutes = run_time_minutes;
+  e.Length = RUN_LENGTH_OPEN;
+
+  RunIndex_WriteEntry(&e);
+  run_open = 1;
+  return e.RunId;
+}
+
+void RunIndex_End(uint32_t length) {
+  if (!run_open)
+    return;
+
+  W25Q_Write((uint8_t *)&length,
+             RunIndex_EntryAddr(entry_count - 1) +
+                 offsetof(RunEntry_t, Length),
+             sizeof(length));
+  FlashLog_Advance(&head_seq, &head_off, length);
+  run_open = 0;
+}
+
+void RunIndex_Clear(void) {
+  if (run_open)
+    return; // The open entry must stay last until RunIndex_End
+
+  if (entry_count >= RUN_MAX_ENTRIES)
+    RunIndex_Compact();
+
+  RunEntry_t e;
+  memset(&e, 0xFF, sizeof(e));
+  e.Magic = RUN_CLEAR_MAGIC;
+  e.StartSeq = head_seq;
+  e.StartOffset = head_off;
+  RunIndex_WriteEntry(&e);
+  first_listed = entry_count;
+}
+
+void RunIndex_Head(uint32_t *seq, uint16_t *offset) {
+  *seq = head_seq;
+  *offset = head_off;
+}
+
+uint8_t RunIndex_Next(uint16_t *cursor, RunEntry_t *entry) {
+  if (*cursor < first_listed)
+    *cursor = first_listed;
+  while (*cursor < entry_count) {
+    if (RunIndex_Listed((*cursor)++, entry))
+      return 1;
+  }
+  return 0;
+}
+
+uint16_t RunIndex_Count(void) {
+  RunEntry_t e;
+  uint16_t cursor = 0;
+  uint16_t n = 0;
+  while (RunIndex_Next(&cursor, &e))
+    n++;
+  return n;
+}
+
+uint8_t RunIndex_Get(uint16_t index, RunEntry_t *entry) {
+  uint16_t cursor = 0;
+  while (RunIndex_Next(&cursor, entry)) {
+    if (index-- == 0)
+      return 1;
+  }
+  return 0;
+}
+
+uint8_t RunIndex_Find(uint16_t run_id, RunEntry_t *entry) {
+  uint16_t cursor = 0;
+  while (RunIndex_Next(&cursor, entry)) {
+    if (entry->RunId == run_id)
+      return 1;
+  }
+  return 0;
+}
+
+uint8_t RunIndex_Latest(RunEntry_t *entry) {
+  for (int32_t i = entry_count - 1; i >= first_listed; i--) {
+    if (RunIndex_Listed(i, entry))
+      return 1;
+  }
+  return 0;
+}
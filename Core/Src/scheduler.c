@@ -0,0 +1,115 @@
+/*
+ * scheduler.c
+ *
+ *  Created on: Apr 9, 2026
+ *      Author: BioFET Team
+ */
+
+#include "scheduler.h"
+#include "main.h"
+#include <string.h>
+
+static const Sched_Task_t *sched_tasks = NULL;
+static uint8_t sched_count = 0;
+static volatile uint32_t sched_ms = 0; // Ticks since Sched_Init
+
+// Written by the tick ISR
+static volatile uint8_t sched_released[SCHED_MAX_TASKS];
+static volatile uint32_t sched_release_ms[SCHED_MAX_TASKS];
+static volatile uint32_t sched_overruns[SCHED_MAX_TASKS];
+static uint16_t sched_countdown[SCHED_MAX_TASKS];
+
+// Written by Sched_Run
+static Sched_Stats_t sched_stats[SCHED_MAX_TASKS];
+
+void Sched_Init(const Sched_Task_t *tasks, uint8_t count) {
+  __disable_irq();
+  sched_tasks = tasks;
+  sched_count = (count < SCHED_MAX_TASKS) ? count : SCHED_MAX_TASKS;
+  for (uint8_t i = 0; i < sched_count; i++) {
+    sched_released[i] = 0;
+    sched_overruns[i] = 0;
+    sched_countdown[i] = tasks[i].PeriodMs;
+  }
+  __enable_irq();
+  Sched_ResetStats();
+}
+
+void Sched_OnTick(void) {
+  uint32_t now = ++sched_ms;
+
+  for (uint8_t i = 0; i < sched_count; i++) {
+    if (--sched_countdown[i] != 0)
+      continue;
+    sched_countdown[i] = sched_tasks[i].PeriodMs;
+    if (sched_released[i]) {
+      sched_overruns[i]++; // Still waiting from the last release
+    } else {
+      sched_release_ms[i] = now;
+      sched_released[i] = 1;
+    }
+  }
+}
+
+/*
+ * Milliseconds from the tick count plus the fraction of the current tick
+ * from the SysTick down-counter. Retries if the tick moved while reading.
+ */
+uint32_t Sched_Micros(void) {
+  uint32_t ms, val, load;
+
+  do {
+    ms = sched_ms;
+    val = SysTick->VAL;
+    load = SysTick->LOAD;
+  } while (ms != sched_ms);
+
+  return ms * 1000 + ((load - val) * 1000) / (load + 1);
+}
+
+void Sched_Run(void) {
+  for (;;) {
+    // Highest priority released task. Interrupts stay masked from the
+    // check into WFI, so a release in between still wakes the core.
+    __disable_irq();
+    uint8_t i = 0;
+    while (i < sched_count && !sched_released[i])
+      i++;
+    if (i == sched_count) {
+      __WFI();
+      __enable_irq();
+      continue;
+    }
+    sched_released[i] = 0;
+    uint32_t release_us = sched_release_ms[i] * 1000;
+    __enable_irq();
+
+    uint32_t start = Sched_Micros();
+    sched_tasks[i].Run();
+    uint32_t run = Sched_Micros() - start;
+
+    Sched_Stats_t *st = &sched_stats[i];
+    uint32_t late = start - release_us;
+    st->Runs++;
+    st->TotalRunUs += run;
+    if (late > st->MaxLateUs)
+      st->MaxLateUs = late;
+    if (run > st->MaxRunUs)
+      st->MaxRunUs = run;
+  }
+}
+
+uint8_t Sched_TaskCount(void) { return sched_count; }
+
+const Sched_Task_t *Sched_Task(uint8_t index) { return &sched_tasks[index]; }
+
+void Sched_GetStats(uint8_t index, Sched_Stats_t *stats) {
+  *stats = sched_stats[index];
+  stats->Overruns = sched_overruns[index];
+}
+
+void Sched_ResetStats(void) {
+  memset(sched_stats, 0, sizeof(sched_stats));
+  for (uint8_t i = 0; i < SCHED_MAX_TASKS; i++)
+    sched_overruns[i] = 0;
+}
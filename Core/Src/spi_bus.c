@@ -0,0 +1,274 @@
+/*
+ * spi_bus.c
+ *
+ *  Created on: Mar 18, 2026
+ *      Author: BioFET Team
+ */
+
+#include "spi_bus.h"
+
+volatile uint8_t g_SpiBusClaims = 0;
+volatile uint8_t g_SpiBusActive = 0;
+uint16_t g_SpiBusCr1[SPI_DEV_COUNT];
+
+static const uint32_t dev_max_hz[SPI_DEV_COUNT] = {
+    [SPI_DEV_EXPANDER] = SPI_EXPANDER_MAX_HZ,
+    [SPI_DEV_FLASH] = SPI_FLASH_MAX_HZ,
+    [SPI_DEV_DAC] = SPI_DAC_MAX_HZ,
+    // The burst also writes the expander latch at this rate
+    [SPI_DEV_ADC] = (SPI_ADC_MAX_HZ < SPI_EXPANDER_MAX_HZ)
+                        ? SPI_ADC_MAX_HZ
+                        : SPI_EXPANDER_MAX_HZ,
+};
+
+// CPOL/CPHA bits. All fitted parts run in mode 0 (they also accept mode 3).
+// A device behind an expander CS sees its CS fall while the bus is still in
+// expander mode, so it must share the expander's CPOL.
+static const uint16_t dev_mode[SPI_DEV_COUNT] = {
+    [SPI_DEV_EXPANDER] = 0,
+    [SPI_DEV_FLASH] = 0,
+    [SPI_DEV_DAC] = 0,
+    [SPI_DEV_ADC] = 0, // USER: Mode of the fitted FET ADCs
+};
+
+static SPI_HandleTypeDef *bus_spi = NULL;
+static SpiBus_Xfer_t queue[SPI_BUS_QUEUE_LEN];
+static uint8_t q_head = 0; // Descriptor running or next to run
+static volatile uint8_t q_count = 0;
+static SpiBus_Job_t high_job = NULL; // Deferred high-priority job
+
+/*
+ * Picks the smallest divider (PCLK2 / 2 .. / 256) that keeps each device
+ * within its limit. The BR field holds log2(divider) - 1.
+ */
+void SpiBus_Init(SPI_HandleTypeDef *hspi) {
+  uint32_t pclk = HAL_RCC_GetPCLK2Freq();
+
+  bus_spi = hspi;
+  for (uint8_t dev = 0; dev < SPI_DEV_COUNT; dev++) {
+    uint32_t br = 0;
+    while (br < 7 && (pclk >> (br + 1)) > dev_max_hz[dev])
+      br++;
+    g_SpiBusCr1[dev] = (br << 3) | dev_mode[dev];
+  }
+}
+
+uint32_t SpiBus_Hz(SpiBus_Dev_t dev) {
+  uint32_t br = (g_SpiBusCr1[dev] & SPI_CR1_BR) >> 3;
+  return HAL_RCC_GetPCLK2Freq() >> (br + 1);
+}
+
+uint8_t SpiBus_Idle(SPI_HandleTypeDef *hspi) {
+  if (g_SpiBusClaims || g_SpiBusActive)
+    return 0;
+  if (HAL_SPI_GetState(hspi) != HAL_SPI_STATE_READY)
+    return 0;
+  if (hspi->Instance->SR & SPI_SR_BSY)
+    return 0;
+  return 1;
+}
+
+// ============================================================================
+// QUEUE (interrupts masked or interrupt context)
+// ============================================================================
+
+static void SpiBus_Finish(uint8_t ok);
+
+static void SpiBus_Start(void) {
+  SpiBus_Xfer_t *x = &queue[q_head];
+  HAL_StatusTypeDef status;
+
+  g_SpiBusActive = 1;
+  SpiBus_Select(bus_spi, x->Dev); // Mode settles before CS falls
+  if (x->CsPort != NULL)
+    GPIO_FAST_LOW(x->CsPort, x->CsPin); // Already low mid-chain
+
+  if (x->Rx == NULL)
+    status = HAL_SPI_Transmit_DMA(bus_spi, (uint8_t *)x->Tx, x->Len);
+  else if (x->Tx == NULL)
+    status = HAL_SPI_Receive_DMA(bus_spi, x->Rx, x->Len);
+  else
+    status = HAL_SPI_TransmitReceive_DMA(bus_spi, (uint8_t *)x->Tx, x->Rx,
+                                         x->Len);
+  if (status != HAL_OK)
+    SpiBus_Finish(0);
+}
+
+// Starts the next chain if nobody owns the bus
+static void SpiBus_Kick(void) {
+  if (q_count > 0 && !g_SpiBusActive && g_SpiBusClaims == 0)
+    SpiBus_Start();
+}
+
+static void SpiBus_RunPending(void) {
+  SpiBus_Job_t job = high_job;
+  if (job == NULL)
+    return;
+  high_job = NULL;
+  job();
+}
+
+/*
+ * Retires the running descriptor. A failed phase takes the rest of its
+ * CS cycle with it, so a data phase never runs without its command, and
+ * their Done callbacks all see ok = 0. A deferred high-priority job gets
+ * the bus between two chains.
+ */
+static void SpiBus_Finish(uint8_t ok) {
+  SpiBus_Xfer_t *x;
+  uint8_t more;
+
+  do {
+    x = &queue[q_head];
+    q_head = (q_head + 1) % SPI_BUS_QUEUE_LEN;
+    q_count--;
+    more = (x->Flags & SPI_XFER_KEEP_CS) && q_count > 0;
+    if (x->Done != NULL)
+      x->Done(x->Ctx, ok);
+  } while (!ok && more);
+
+  if (ok && more) {
+    SpiBus_Start(); // Next phase of the same CS cycle
+    return;
+  }
+
+  if (x->CsPort != NULL)
+    GPIO_FAST_HIGH(x->CsPort, x->CsPin);
+  g_SpiBusActive = 0;
+  SpiBus_RunPending();
+  SpiBus_Kick();
+}
+
+void SpiBus_OnComplete(SPI_HandleTypeDef *hspi) {
+  if (hspi == bus_spi && g_SpiBusActive)
+    SpiBus_Finish(1);
+}
+
+void SpiBus_OnError(SPI_HandleTypeDef *hspi) {
+  if (hspi == bus_spi && g_SpiBusActive)
+    SpiBus_Finish(0);
+}
+
+// ============================================================================
+// OWNERSHIP
+// ============================================================================
+
+void SpiBus_Claim(void) {
+  uint32_t primask;
+
+  while (1) {
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (!g_SpiBusActive)
+      break;
+    __set_PRIMASK(primask);
+  }
+  g_SpiBusClaims++;
+  __set_PRIMASK(primask);
+}
+
+/*
+ * A deferred job is taken under the mask but run with it restored, so a
+ * whole ADC burst does not hold off TIM2, USART and DMA. The job claims the
+ * bus itself and restarts the queue when it unclaims.
+ */
+void SpiBus_Unclaim(void) {
+  uint32_t primask = __get_PRIMASK();
+  SpiBus_Job_t job = NULL;
+
+  __disable_irq();
+  if (--g_SpiBusClaims == 0) {
+    job = high_job;
+    high_job = NULL;
+    if (job == NULL)
+      SpiBus_Kick();
+  }
+  __set_PRIMASK(primask);
+
+  if (job != NULL)
+    job();
+}
+
+// ============================================================================
+// TRANSFERS
+// ============================================================================
+
+HAL_StatusTypeDef SpiBus_Transfer(const SpiBus_Xfer_t *xfers, uint8_t n) {
+  HAL_StatusTypeDef status = HAL_OK;
+
+  SpiBus_Claim();
+  for (uint8_t i = 0; i < n; i++) {
+    const SpiBus_Xfer_t *x = &xfers[i];
+    uint32_t timeout = SPI_BUS_TIMEOUT_MS + x->Len / 16;
+
+    SpiBus_Select(bus_spi, x->Dev);
+    if (x->CsPort != NULL)
+      GPIO_FAST_LOW(x->CsPort, x->CsPin);
+
+    if (x->Rx == NULL)
+      status = HAL_SPI_Transmit(bus_spi, (uint8_t *)x->Tx, x->Len, timeout);
+    else if (x->Tx == NULL)
+      status = HAL_SPI_Receive(bus_spi, x->Rx, x->Len, timeout);
+    else
+      status = HAL_SPI_TransmitReceive(bus_spi, (uint8_t *)x->Tx, x->Rx,
+                                       x->Len, timeout);
+
+    uint8_t last = !(x->Flags & SPI_XFER_KEEP_CS) || i + 1 == n;
+    if (x->CsPort != NULL && (last || status != HAL_OK))
+      GPIO_FAST_HIGH(x->CsPort, x->CsPin);
+    if (status != HAL_OK)
+      break;
+  }
+  SpiBus_Unclaim();
+  return status;
+}
+
+uint8_t SpiBus_Submit(const SpiBus_Xfer_t *xfers, uint8_t n) {
+  uint32_t primask = __get_PRIMASK();
+  uint8_t ok = 0;
+
+  __disable_irq();
+  if (n > 0 && q_count + n <= SPI_BUS_QUEUE_LEN) {
+    for (uint8_t i = 0; i < n; i++) {
+      queue[(q_head + q_count) % SPI_BUS_QUEUE_LEN] = xfers[i];
+      q_count++;
+    }
+    // The chain must end its CS cycle, or the bus would stay owned
+    queue[(q_head + q_count - 1) % SPI_BUS_QUEUE_LEN].Flags &=
+        ~SPI_XFER_KEEP_CS;
+    SpiBus_Kick();
+    ok = 1;
+  }
+  __set_PRIMASK(primask);
+  return ok;
+}
+
+// ============================================================================
+// HIGH-PRIORITY LANE
+// ============================================================================
+
+SpiBus_High_t SpiBus_RunHigh(SpiBus_Job_t job) {
+  if (SpiBus_Idle(bus_spi)) {
+    job();
+    return SPI_HIGH_RAN;
+  }
+  if (high_job != NULL)
+    return SPI_HIGH_BUSY;
+  high_job = job;
+  return SPI_HIGH_DEFERRED;
+}
+
+/*
+ * Returns 0 if nothing was waiting, including a job SpiBus_Unclaim() has
+ * already taken off the lane: that one still runs.
+ */
+uint8_t SpiBus_CancelHigh(void) {
+  uint32_t primask = __get_PRIMASK();
+  uint8_t dropped;
+
+  __disable_irq();
+  dropped = (high_job != NULL);
+  high_job = NULL;
+  __set_PRIMASK(primask);
+  return dropped;
+}
@@ -0,0 +1,115 @@
+/*
+ * stream.c
+ *
+ *  Created on: Apr 2, 2026
+ *      Author: BioFET Team
+ */
+
+#include "stream.h"
+#include "autorange.h"
+#include "frame.h"
+#include "offload.h"
+
+_Static_assert(sizeof(Stream_Record_t) == 24, "Stream_Record_t layout changed");
+_Static_assert(sizeof(Stream_Header_t) +
+                       STREAM_BATCH * sizeof(Stream_Record_t) <=
+                   FRAME_DATA_MAX,
+               "Stream batch does not fit one frame");
+
+static Acq_Reader_t stream_reader;
+static uint8_t stream_active = 0;
+static uint16_t stream_hz;
+static uint32_t stream_skip = 0;    // Samples left until the next one sent
+static uint32_t stream_sent = 0;    // Samples sent
+static uint32_t stream_dropped = 0; // Samples dropped (link full)
+static uint32_t stream_batch_tick;  // HAL tick of the batch's first sample
+
+static struct {
+  Stream_Header_t hdr;
+  Stream_Record_t rec[STREAM_BATCH];
+} stream_frame;
+static uint8_t stream_count = 0; // Records in stream_frame
+
+void Stream_Start(uint16_t hz) {
+  Acq_ReaderSync(&stream_reader);
+  stream_hz = hz;
+  stream_skip = 0;
+  stream_sent = 0;
+  stream_dropped = 0;
+  stream_count = 0;
+  stream_active = 1;
+}
+
+void Stream_Stop(void) { stream_active = 0; }
+
+uint8_t Stream_Active(void) { return stream_active; }
+
+uint32_t Stream_Sent(void) { return stream_sent; }
+
+uint32_t Stream_Dropped(void) {
+  return stream_dropped + stream_reader.lost;
+}
+
+// Samples per one sent, from the current output rate
+static uint32_t Stream_Decimation(void) {
+  uint32_t n = 1000000 / (Acq_PeriodUs() * stream_hz);
+  return (n > 0) ? n : 1;
+}
+
+static void Stream_Flush(void) {
+  if (stream_count == 0)
+    return;
+
+  stream_frame.hdr.Dropped = Stream_Dropped();
+  stream_frame.hdr.PeriodUs = Acq_PeriodUs();
+  // A flash dump owns the bulk lane until it ends: raw data must not be
+  // interleaved, and framed DATA frames are sized to the room left
+  if (!Offload_Active() &&
+      Frame_Send(UART_TX_BULK, FRAME_SAMPLES, &stream_frame,
+                 sizeof(Stream_Header_t) +
+                     stream_count * sizeof(Stream_Record_t)))
+    stream_sent += stream_count;
+  else
+    stream_dropped += stream_count; // Link saturated: never wait
+  stream_count = 0;
+}
+
+static void Stream_Add(const Acq_Sample_t *sample,
+                       const DAC_Channel_t *bias) {
+  Stream_Record_t *rec = &stream_frame.rec[stream_count];
+
+  rec->Tick = sample->Tick;
+  rec->DacMv = (int16_t)DAC_CodeToMv(bias, sample->DacCode);
+  rec->Ranges = sample->Ranges;
+  for (uint8_t ch = 0; ch < ACQ_CHANNELS; ch++) {
+    uint8_t range = ACQ_RANGE_OF(sample->Ranges, ch);
+    rec->CurrentPa[ch] =
+        (range == ACQ_RANGE_SWITCHING)
+            ? 0
+            : (int32_t)((int64_t)sample->Raw[ch] * AutoRange_LsbFa(range) /
+                        1000);
+  }
+
+  if (stream_count++ == 0)
+    stream_batch_tick = HAL_GetTick();
+  if (stream_count == STREAM_BATCH)
+    Stream_Flush();
+}
+
+void Stream_Service(const DAC_Channel_t *bias) {
+  if (!stream_active)
+    return;
+
+  Acq_Sample_t sample;
+  while (Acq_Read(&stream_reader, &sample)) {
+    if (stream_skip > 0) {
+      stream_skip--;
+      continue;
+    }
+    stream_skip = Stream_Decimation() - 1;
+    Stream_Add(&sample, bias);
+  }
+
+  if (stream_count > 0 && HAL_GetTick() - stream_batch_tick >= STREAM_FLUSH_MS)
+    Stream_Flush();
+}
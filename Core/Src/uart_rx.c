@@ -0,0 +1,141 @@
+/*
+ * uart_rx.c
+ *
+ *  Created on: Mar 26, 2026
+ *      Author: BioFET Team
+ */
+
+#include "uart_rx.h"
+#include <string.h>
+
+static UART_HandleTypeDef *rx_uart = NULL;
+static uint8_t rx_dma_buf[UART_RX_DMA_SIZE];
+static uint16_t rx_pos = 0; // Next DMA ring byte not yet looked at
+
+// Line or frame being assembled (interrupt context only)
+static uint8_t rx_line[UART_RX_FRAME_MAX];
+static uint16_t rx_line_len = 0;
+static uint8_t rx_line_overflow = 0;
+static uint8_t rx_in_frame = 0; // Inside 0x00 ... 0x00
+
+typedef struct {
+  uint8_t kind; // UART_RX_LINE or UART_RX_FRAME
+  uint8_t len;
+  uint8_t data[UART_RX_FRAME_MAX];
+} UartRx_Entry_t;
+
+// Single producer (ISR), single consumer (main loop)
+static UartRx_Entry_t rx_queue[UART_RX_QUEUE_LEN];
+static volatile uint8_t rx_head = 0; // Lines queued so far
+static volatile uint8_t rx_tail = 0; // Lines taken so far
+static volatile uint32_t rx_dropped = 0;
+
+static void UartRx_Start(void) {
+  rx_pos = 0;
+  HAL_UARTEx_ReceiveToIdle_DMA(rx_uart, rx_dma_buf, UART_RX_DMA_SIZE);
+}
+
+void UartRx_Init(UART_HandleTypeDef *huart) {
+  rx_uart = huart;
+  UartRx_Start();
+}
+
+// Reception must be stopped around a change of the UART settings
+void UartRx_Stop(void) { HAL_UART_AbortReceive(rx_uart); }
+
+void UartRx_Restart(void) {
+  rx_line_len = 0;
+  rx_line_overflow = 0;
+  rx_in_frame = 0;
+  UartRx_Start();
+}
+
+static void UartRx_EndLine(uint8_t kind) {
+  if (rx_line_overflow) {
+    rx_dropped++;
+  } else if (rx_line_len > 0) {
+    if ((uint8_t)(rx_head - rx_tail) >= UART_RX_QUEUE_LEN) {
+      rx_dropped++;
+    } else {
+      UartRx_Entry_t *slot = &rx_queue[rx_head % UART_RX_QUEUE_LEN];
+      slot->kind = kind;
+      slot->len = rx_line_len;
+      memcpy(slot->data, rx_line, rx_line_len);
+      rx_head++;
+    }
+  }
+  rx_line_len = 0;
+  rx_line_overflow = 0;
+}
+
+/*
+ * A 0x00 opens a frame, which runs to the next 0x00 and may contain any
+ * other byte. Outside frames, text lines end at '\r' / '\n'. Text never
+ * holds a zero, so bytes ended by one are a frame whatever the state: a
+ * lost delimiter costs one frame instead of swapping frames and gaps.
+ */
+static void UartRx_Byte(uint8_t c) {
+  uint16_t max = rx_in_frame ? UART_RX_FRAME_MAX : UART_RX_LINE_MAX - 1;
+
+  if (c == 0x00) {
+    if (rx_line_len > 0 || rx_line_overflow) {
+      UartRx_EndLine(UART_RX_FRAME);
+      rx_in_frame = 0;
+    } else {
+      rx_in_frame = 1;
+    }
+  } else if (!rx_in_frame && (c == '\n' || c == '\r')) {
+    UartRx_EndLine(UART_RX_LINE); // An empty line ("\r\n") is ignored
+  } else if (rx_line_len < max) {
+    rx_line[rx_line_len++] = c;
+  } else {
+    rx_line_overflow = 1;
+  }
+}
+
+/*
+ * pos is how far the DMA has got in the ring. It wraps to 0 (reported as
+ * UART_RX_DMA_SIZE first) when the circular buffer fills.
+ */
+void UartRx_OnEvent(UART_HandleTypeDef *huart, uint16_t pos) {
+  if (huart != rx_uart)
+    return;
+
+  while (rx_pos != pos) {
+    UartRx_Byte(rx_dma_buf[rx_pos]);
+    rx_pos++;
+    if (rx_pos >= UART_RX_DMA_SIZE) {
+      rx_pos = 0;
+      if (pos == UART_RX_DMA_SIZE)
+        break;
+    }
+  }
+}
+
+// Overrun, framing or noise error: the HAL aborted the reception
+void UartRx_OnError(UART_HandleTypeDef *huart) {
+  if (huart != rx_uart || huart->RxState != HAL_UART_STATE_READY)
+    return;
+  rx_line_overflow = 1; // The line in progress lost bytes
+  UartRx_Start();
+}
+
+/*
+ * Takes the oldest line or frame. Lines are NUL terminated; a frame is
+ * the raw COBS body (without delimiters), for Frame_Decode().
+ */
+uint8_t UartRx_Get(uint8_t *buf, uint16_t size, uint16_t *len) {
+  if (rx_tail == rx_head)
+    return UART_RX_NONE;
+
+  const UartRx_Entry_t *slot = &rx_queue[rx_tail % UART_RX_QUEUE_LEN];
+  uint8_t kind = slot->kind;
+  uint16_t n = (slot->len < size - 1) ? slot->len : size - 1;
+  memcpy(buf, slot->data, n);
+  buf[n] = '\0';
+  *len = n;
+  rx_tail++; // Slot free for the ISR only after the copy
+  return kind;
+}
+
+uint32_t UartRx_Dropped(void) { return rx_dropped; }
@@ -0,0 +1,234 @@
+/*
+ * uart_tx.c
+ *
+ *  Created on: Mar 27, 2026
+ *      Author: BioFET Team
+ */
+
+#include "uart_tx.h"
+#include <string.h>
+
+_Static_assert((UART_TX_CTRL_SIZE & (UART_TX_CTRL_SIZE - 1)) == 0 &&
+                   (UART_TX_BULK_SIZE & (UART_TX_BULK_SIZE - 1)) == 0,
+               "UART TX lane sizes must be powers of two");
+
+#define UART_TX_UNITS 16 // Write / commit boundaries tracked per lane
+
+// Single producer (main loop) and the DMA as consumer. Indexes run freely
+// and are reduced modulo the size on access.
+typedef struct {
+  uint8_t *buf;
+  uint16_t size;
+  uint16_t max_chunk;
+  volatile uint32_t head; // Bytes queued so far
+  volatile uint32_t tail; // Bytes sent so far
+  // End positions of the units (writes, commits) not yet fully sent
+  uint32_t unit_end[UART_TX_UNITS];
+  uint8_t unit_head;
+  uint8_t unit_tail;
+} UartTx_Ring_t;
+
+static uint8_t ctrl_buf[UART_TX_CTRL_SIZE];
+static uint8_t bulk_buf[UART_TX_BULK_SIZE];
+
+static UartTx_Ring_t lanes[UART_TX_LANES] = {
+    {.buf = ctrl_buf, .size = UART_TX_CTRL_SIZE,
+     .max_chunk = UART_TX_CTRL_SIZE},
+    {.buf = bulk_buf, .size = UART_TX_BULK_SIZE,
+     .max_chunk = UART_TX_BULK_CHUNK},
+};
+
+static UART_HandleTypeDef *tx_uart = NULL;
+static volatile uint8_t tx_busy = 0; // A DMA transfer is running
+static uint8_t tx_lane;              // ... from this lane
+static uint16_t tx_len;              // ... of this many bytes
+static uint8_t tx_split = 0; // That transfer stopped inside a unit
+
+static volatile uint8_t ctrl_hold = 0;
+static volatile uint32_t ctrl_hold_pos = 0; // Control bytes queued before
+static volatile uint8_t ctrl_release = 0;   // Hold ends at ctrl_release_pos
+static volatile uint32_t ctrl_release_pos = 0; // ... of the bulk lane
+
+void UartTx_Init(UART_HandleTypeDef *huart) { tx_uart = huart; }
+
+static uint8_t UartTx_CtrlAllowed(void) {
+  if (!ctrl_hold)
+    return 1;
+  if (ctrl_release &&
+      (int32_t)(lanes[UART_TX_BULK].tail - ctrl_release_pos) >= 0) {
+    ctrl_hold = 0;
+    ctrl_release = 0;
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Longest transfer from lane r of at most n bytes that ends on a unit
+ * boundary, or 0 if the oldest unit alone is longer than n.
+ */
+static uint32_t UartTx_UnitCut(UartTx_Ring_t *r, uint32_t n) {
+  uint32_t cut = 0;
+
+  while (r->unit_tail != r->unit_head &&
+         (int32_t)(r->unit_end[r->unit_tail % UART_TX_UNITS] - r->tail) <= 0)
+    r->unit_tail++;
+
+  for (uint8_t u = r->unit_tail; u != r->unit_head; u++) {
+    uint32_t len = r->unit_end[u % UART_TX_UNITS] - r->tail;
+    if (len > n)
+      break;
+    cut = len;
+  }
+  return cut;
+}
+
+/*
+ * Starts the next DMA transfer if none is running. Called from the TX
+ * complete interrupt and, with interrupts masked, from the main loop.
+ * A transfer never wraps round the end of a ring and, where it can, ends
+ * on a unit boundary. One that could not (a unit longer than a chunk, or
+ * cut by the ring end) is continued before any other lane is served, so
+ * a frame is never split by bytes from the other lane.
+ */
+static void UartTx_Kick(void) {
+  if (tx_busy || tx_uart == NULL)
+    return;
+
+  for (uint8_t i = 0; i < UART_TX_LANES; i++) {
+    uint8_t l = tx_split ? tx_lane : i;
+    UartTx_Ring_t *r = &lanes[l];
+    uint32_t used = r->head - r->tail;
+    if (l == UART_TX_CTRL && !UartTx_CtrlAllowed())
+      used = ctrl_hold_pos - r->tail; // Responses from before the hold
+    if (used == 0)
+      continue;
+
+    uint16_t start = r->tail & (r->size - 1);
+    uint32_t n = r->size - start;
+    if (n > used)
+      n = used;
+    if (n > r->max_chunk)
+      n = r->max_chunk;
+
+    uint32_t cut = UartTx_UnitCut(r, n);
+    tx_split = (cut == 0);
+    if (cut > 0)
+      n = cut;
+
+    tx_busy = 1;
+    tx_lane = l;
+    tx_len = n;
+    HAL_UART_Transmit_DMA(tx_uart, &r->buf[start], n);
+    return;
+  }
+}
+
+/*
+ * Makes len more bytes of a lane visible to the DMA as one unit. When all
+ * unit slots are taken the unit is merged into the newest one.
+ */
+static void UartTx_Publish(UartTx_Lane_t lane, uint16_t len) {
+  UartTx_Ring_t *r = &lanes[lane];
+  uint32_t primask = __get_PRIMASK(); // Callers may already mask IRQs
+
+  __disable_irq();
+  r->head += len;
+  if ((uint8_t)(r->unit_head - r->unit_tail) >= UART_TX_UNITS) {
+    r->unit_end[(uint8_t)(r->unit_head - 1) % UART_TX_UNITS] = r->head;
+  } else {
+    r->unit_end[r->unit_head % UART_TX_UNITS] = r->head;
+    r->unit_head++;
+  }
+  UartTx_Kick();
+  __set_PRIMASK(primask);
+}
+
+static void UartTx_KickFromMain(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  UartTx_Kick();
+  __set_PRIMASK(primask);
+}
+
+void UartTx_OnTxComplete(UART_HandleTypeDef *huart) {
+  if (huart != tx_uart || !tx_busy)
+    return;
+  lanes[tx_lane].tail += tx_len;
+  tx_busy = 0;
+  UartTx_Kick();
+}
+
+// A DMA error aborts the transfer without a TX complete: send it again
+void UartTx_OnError(UART_HandleTypeDef *huart) {
+  if (huart != tx_uart || !tx_busy || huart->gState != HAL_UART_STATE_READY)
+    return;
+  tx_busy = 0;
+  UartTx_Kick();
+}
+
+uint16_t UartTx_Room(UartTx_Lane_t lane) {
+  UartTx_Ring_t *r = &lanes[lane];
+  return r->size - (uint16_t)(r->head - r->tail);
+}
+
+uint16_t UartTx_Reserve(UartTx_Lane_t lane, uint8_t **ptr) {
+  UartTx_Ring_t *r = &lanes[lane];
+  uint16_t start = r->head & (r->size - 1);
+  uint16_t room = UartTx_Room(lane);
+  uint16_t contiguous = r->size - start;
+
+  *ptr = &r->buf[start];
+  return (room < contiguous) ? room : contiguous;
+}
+
+void UartTx_Commit(UartTx_Lane_t lane, uint16_t len) {
+  UartTx_Publish(lane, len);
+}
+
+uint8_t UartTx_Write(UartTx_Lane_t lane, const void *data, uint16_t len) {
+  UartTx_Ring_t *r = &lanes[lane];
+  const uint8_t *src = (const uint8_t *)data;
+
+  if (len > UartTx_Room(lane))
+    return 0;
+
+  // At most two copies: up to the end of the ring, then from its start
+  uint16_t start = r->head & (r->size - 1);
+  uint16_t first = r->size - start;
+  if (first > len)
+    first = len;
+  memcpy(&r->buf[start], src, first);
+  memcpy(r->buf, src + first, len - first);
+  UartTx_Publish(lane, len);
+  return 1;
+}
+
+void UartTx_WriteWait(UartTx_Lane_t lane, const void *data, uint16_t len) {
+  while (!UartTx_Write(lane, data, len)) {
+  }
+}
+
+void UartTx_HoldCtrl(void) {
+  ctrl_hold_pos = lanes[UART_TX_CTRL].head;
+  ctrl_release = 0;
+  ctrl_hold = 1;
+}
+
+void UartTx_ReleaseCtrl(void) {
+  ctrl_release_pos = lanes[UART_TX_BULK].head;
+  ctrl_release = 1;
+  UartTx_KickFromMain();
+}
+
+uint8_t UartTx_CtrlHeld(void) { return ctrl_hold; }
+
+uint8_t UartTx_Idle(void) {
+  return !tx_busy && lanes[UART_TX_CTRL].head == lanes[UART_TX_CTRL].tail &&
+         lanes[UART_TX_BULK].head == lanes[UART_TX_BULK].tail;
+}
+
+void UartTx_Flush(void) {
+  while (!UartTx_Idle()) {
+  }
+}
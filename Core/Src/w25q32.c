@@ -6,31 +6,81 @@
  */
 
 #include "w25q32.h"
+#include "perf.h"
+#include "spi_bus.h"
 #include <stdio.h> // for NULL
 
-// Helper macros
-#define CS_LO()                                                                \
-  HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_RESET)
-#define CS_HI()                                                                \
-  HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET)
+static const uint8_t wren_cmd = CMD_WRITE_ENABLE;
+static uint8_t prog_cmd[4]; // Read by the DMA after StartPageProgram returns
+static uint8_t read_cmd[5];
+static volatile uint8_t prog_queued = 0;
+static volatile uint8_t prog_failed = 0; // Last queued program never arrived
+static volatile uint8_t dma_read_active = 0;
+
+// One phase of a flash CS cycle (spi_bus.h)
+static void W25Q_Phase(SpiBus_Xfer_t *x, const uint8_t *tx, uint8_t *rx,
+                       uint16_t len, uint8_t flags) {
+  x->Dev = SPI_DEV_FLASH;
+  x->CsPort = FLASH_CS_GPIO_Port;
+  x->CsPin = FLASH_CS_Pin;
+  x->Tx = tx;
+  x->Rx = rx;
+  x->Len = len;
+  x->Flags = flags;
+  x->Done = NULL;
+  x->Ctx = NULL;
+}
+
+// Command frame, optionally followed by a data phase in the same CS cycle
+static void W25Q_Command(const uint8_t *cmd, uint16_t cmd_len,
+                         uint8_t *rx, uint16_t rx_len) {
+  SpiBus_Xfer_t x[2];
+  W25Q_Phase(&x[0], cmd, NULL, cmd_len, SPI_XFER_KEEP_CS);
+  W25Q_Phase(&x[1], NULL, rx, rx_len, 0);
+  SpiBus_Transfer(x, (rx_len > 0) ? 2 : 1);
+}
+
+static void W25Q_AddressCmd(uint8_t *cmd, uint8_t opcode, uint32_t address) {
+  cmd[0] = opcode;
+  cmd[1] = (address >> 16) & 0xFF;
+  cmd[2] = (address >> 8) & 0xFF;
+  cmd[3] = address & 0xFF;
+}
 
 static void W25Q_WriteEnable(void) {
-  CS_LO();
-  uint8_t cmd = CMD_WRITE_ENABLE;
-  HAL_SPI_Transmit(W25Q_SPI_HANDLE, &cmd, 1, 100);
-  CS_HI();
-  HAL_Delay(1);
+  W25Q_Command(&wren_cmd, 1, NULL, 0);
+  // No delay needed: WEL is set as soon as CS rises
 }
 
-static void W25Q_WaitForWriteEnd(void) {
+static void W25Q_ProgramDone(void *ctx, uint8_t ok) {
+  (void)ctx;
+  prog_failed = !ok;
+  prog_queued = 0;
+}
+
+static void W25Q_ReadDone(void *ctx, uint8_t ok) {
+  (void)ctx;
+  (void)ok;
+  dma_read_active = 0;
+}
+
+uint8_t W25Q_IsBusy(void) {
+  // Queued DMA traffic comes first: a page program still on its way to the
+  // chip, or a read holding CS. Report busy without touching the bus.
+  if (prog_queued || dma_read_active)
+    return 1;
+
   uint8_t cmd = CMD_READ_STATUS_1;
-  uint8_t status;
-  do {
-    CS_LO();
-    HAL_SPI_Transmit(W25Q_SPI_HANDLE, &cmd, 1, 100);
-    HAL_SPI_Receive(W25Q_SPI_HANDLE, &status, 1, 100);
-    CS_HI();
-  } while ((status & 0x01) == 0x01); // BUSY bit
+  uint8_t status = 0;
+  W25Q_Command(&cmd, 1, &status, 1);
+  return status & 0x01; // BUSY bit
+}
+
+static void W25Q_WaitForWriteEnd(void) {
+  PERF_BEGIN(PERF_ZONE_FLASH_WAIT);
+  while (W25Q_IsBusy()) {
+  }
+  PERF_END(PERF_ZONE_FLASH_WAIT);
 }
 
 void W25Q_Reset(void) {
@@ -40,74 +90,132 @@ void W25Q_Reset(void) {
 uint32_t W25Q_ReadID(void) {
   uint8_t cmd = CMD_JEDEC_ID;
   uint8_t id[3];
-  CS_LO();
-  HAL_SPI_Transmit(W25Q_SPI_HANDLE, &cmd, 1, 100);
-  HAL_SPI_Receive(W25Q_SPI_HANDLE, id, 3, 100);
-  CS_HI();
+  W25Q_Command(&cmd, 1, id, 3);
   return ((id[0] << 16) | (id[1] << 8) | id[2]);
 }
 
-void W25Q_EraseSector(uint32_t address) {
-  W25Q_WaitForWriteEnd();
-  W25Q_WriteEnable();
+// ----------------------------------------------------------------------------
+// Start* functions issue the command and return immediately. The caller must
+// make sure the chip is not busy before, and poll W25Q_IsBusy() after.
+// ----------------------------------------------------------------------------
+static void W25Q_StartErase(uint8_t opcode, uint32_t address) {
   uint8_t cmd[4];
-  cmd[0] = CMD_SECTOR_ERASE;
-  cmd[1] = (address >> 16) & 0xFF;
-  cmd[2] = (address >> 8) & 0xFF;
-  cmd[3] = address & 0xFF;
+  W25Q_AddressCmd(cmd, opcode, address);
 
-  CS_LO();
-  HAL_SPI_Transmit(W25Q_SPI_HANDLE, cmd, 4, 100);
-  CS_HI();
-  W25Q_WaitForWriteEnd();
+  W25Q_WriteEnable();
+  W25Q_Command(cmd, 4, NULL, 0);
 }
 
-void W25Q_EraseChip(void) {
-  W25Q_WaitForWriteEnd();
-  W25Q_WriteEnable();
+void W25Q_StartEraseSector(uint32_t address) {
+  W25Q_StartErase(CMD_SECTOR_ERASE, address);
+}
+
+// One command instead of 16 sector erases, and faster in total
+// (~150ms typ vs 16 x ~45ms)
+void W25Q_StartEraseBlock(uint32_t address) {
+  W25Q_StartErase(CMD_BLOCK_ERASE, address);
+}
+
+void W25Q_StartEraseChip(void) {
   uint8_t cmd = CMD_CHIP_ERASE;
 
-  CS_LO();
-  HAL_SPI_Transmit(W25Q_SPI_HANDLE, &cmd, 1, 100);
-  CS_HI();
-  W25Q_WaitForWriteEnd();
+  W25Q_WriteEnable();
+  W25Q_Command(&cmd, 1, NULL, 0);
 }
 
-void W25Q_Write(uint8_t *pData, uint32_t writeAddr, uint32_t size) {
-  // Basic implementation: Assumes simple writes (handling page boundaries needs
-  // more logic if crossing) For config saving (small data), this is fine if
-  // aligned. For data logging, we should manage pages.
+/*
+ * Queues WREN, the command and the data for DMA and returns while they are
+ * still being clocked out. W25Q_IsBusy() reports busy until the program
+ * has finished on the chip, so pData must stay untouched until then.
+ */
+void W25Q_StartPageProgram(const uint8_t *pData, uint32_t writeAddr,
+                           uint32_t size) {
+  // Range must stay inside one 256-byte page, otherwise the chip wraps
+  // around to the start of the page and corrupts data.
+  SpiBus_Xfer_t x[3];
+  W25Q_AddressCmd(prog_cmd, CMD_PAGE_PROGRAM, writeAddr);
+  W25Q_Phase(&x[0], &wren_cmd, NULL, 1, 0);
+  W25Q_Phase(&x[1], prog_cmd, NULL, 4, SPI_XFER_KEEP_CS);
+  W25Q_Phase(&x[2], pData, NULL, size, 0);
+  x[2].Done = W25Q_ProgramDone;
+
+  prog_queued = 1;
+  prog_failed = 0;
+  while (!SpiBus_Submit(x, 3)) {
+    // Queue full: it drains from the DMA interrupt
+  }
+}
 
+// ----------------------------------------------------------------------------
+// Blocking wrappers
+// ----------------------------------------------------------------------------
+void W25Q_EraseSector(uint32_t address) {
   W25Q_WaitForWriteEnd();
-  W25Q_WriteEnable();
+  W25Q_StartEraseSector(address);
+  W25Q_WaitForWriteEnd();
+}
 
-  uint8_t cmd[4];
-  cmd[0] = CMD_PAGE_PROGRAM;
-  cmd[1] = (writeAddr >> 16) & 0xFF;
-  cmd[2] = (writeAddr >> 8) & 0xFF;
-  cmd[3] = writeAddr & 0xFF;
-
-  CS_LO();
-  HAL_SPI_Transmit(W25Q_SPI_HANDLE, cmd, 4, 100);
-  HAL_SPI_Transmit(W25Q_SPI_HANDLE, pData, size, 1000);
-  CS_HI();
+void W25Q_EraseChip(void) {
+  W25Q_WaitForWriteEnd();
+  W25Q_StartEraseChip();
+  W25Q_WaitForWriteEnd();
+}
+
+void W25Q_Write(uint8_t *pData, uint32_t writeAddr, uint32_t size) {
+  // Split the write into chunks that never cross a page boundary
   W25Q_WaitForWriteEnd();
+  while (size > 0) {
+    uint32_t chunk = FLASH_PAGE_SIZE - (writeAddr % FLASH_PAGE_SIZE);
+    if (chunk > size)
+      chunk = size;
+
+    for (uint8_t tries = 0; tries <= W25Q_PROGRAM_RETRIES; tries++) {
+      W25Q_StartPageProgram(pData, writeAddr, chunk);
+      W25Q_WaitForWriteEnd();
+      if (!W25Q_ProgramFailed())
+        break;
+    }
+    pData += chunk;
+    writeAddr += chunk;
+    size -= chunk;
+  }
 }
 
 void W25Q_Read(uint8_t *pBuffer, uint32_t readAddr, uint32_t size) {
   W25Q_WaitForWriteEnd();
   uint8_t cmd[4];
-  cmd[0] = CMD_READ_DATA;
-  cmd[1] = (readAddr >> 16) & 0xFF;
-  cmd[2] = (readAddr >> 8) & 0xFF;
-  cmd[3] = readAddr & 0xFF;
+  W25Q_AddressCmd(cmd, CMD_READ_DATA, readAddr);
+  W25Q_Command(cmd, 4, pBuffer, size);
+}
 
-  CS_LO();
-  HAL_SPI_Transmit(W25Q_SPI_HANDLE, cmd, 4, 100);
-  HAL_SPI_Receive(W25Q_SPI_HANDLE, pBuffer, size, 2000);
-  CS_HI();
+HAL_StatusTypeDef W25Q_ReadDMA(uint8_t *pBuffer, uint32_t readAddr,
+                               uint16_t size) {
+  W25Q_WaitForWriteEnd();
+  W25Q_AddressCmd(read_cmd, CMD_FAST_READ, readAddr);
+  read_cmd[4] = 0x00; // Dummy byte
+
+  SpiBus_Xfer_t x[2];
+  W25Q_Phase(&x[0], read_cmd, NULL, 5, SPI_XFER_KEEP_CS);
+  W25Q_Phase(&x[1], NULL, pBuffer, size, 0);
+  x[1].Done = W25Q_ReadDone;
+
+  dma_read_active = 1;
+  if (!SpiBus_Submit(x, 2)) {
+    dma_read_active = 0;
+    return HAL_BUSY;
+  }
+  return HAL_OK;
 }
 
+uint8_t W25Q_ReadDMAComplete(void) { return !dma_read_active; }
+
+/*
+ * A program whose chain failed (SPI or DMA error) may have reached the chip
+ * partly or not at all. Programming the same data again is safe: bits that
+ * already went to 0 stay 0.
+ */
+uint8_t W25Q_ProgramFailed(void) { return !prog_queued && prog_failed; }
+
 // ============================================================================
 // HIGH LEVEL APP FUNCTIONS
 // ============================================================================
@@ -129,18 +237,8 @@ uint8_t W25Q_LoadConfig(BioFET_Config_t *cfg) {
 }
 
 void W25Q_SaveData(uint32_t offset, uint8_t *data, uint16_t len) {
-  // Write data to DATA_ADDR_START + offset
-  // Check if we cross a page boundary!
-  // For simplicity in this demo, we assume small writes that don't cross
-  // 256-byte page boundaries often OR we just use the simple Write function
-  // which might need improvement for crossing. Let's stick to the current
-  // W25Q_Write which does NOT handle page crossing automatically in my
-  // implementation above. IMPROVEMENT: Update W25Q_Write to handle page
-  // crossing or just call it carefully.
-
-  // For this prototype, simply write.
-  // NOTE: Real implementation should check (writeAddr % 256 + size > 256) and
-  // split writes.
-
+  // Direct (unbuffered) write to DATA_ADDR_START + offset. Fine for one-off
+  // records; continuous logging should go through FlashLog (flash_log.h),
+  // which batches records into whole-page programs.
   W25Q_Write(data, DATA_ADDR_START + offset, len);
 }
@@ -0,0 +1,87 @@
+/*
+ * w25q_async.c
+ *
+ *  Created on: Mar 4, 2026
+ *      Author: BioFET Team
+ */
+
+#include "w25q_async.h"
+
+// Ring of pending jobs. queue[head] is the running job while active == 1.
+static W25Q_Job_t queue[W25Q_ASYNC_QUEUE_LEN];
+static uint8_t head = 0;
+static uint8_t count = 0;
+static uint8_t active = 0;
+static uint8_t retries = 0; // Of the running PROGRAM job
+
+static void W25Q_AsyncStart(const W25Q_Job_t *job) {
+  switch (job->type) {
+  case W25Q_JOB_PROGRAM:
+    W25Q_StartPageProgram(job->data, job->addr, job->len);
+    break;
+  case W25Q_JOB_ERASE_SECTOR:
+    W25Q_StartEraseSector(job->addr);
+    break;
+  case W25Q_JOB_ERASE_BLOCK:
+    W25Q_StartEraseBlock(job->addr);
+    break;
+  case W25Q_JOB_ERASE_CHIP:
+    W25Q_StartEraseChip();
+    break;
+  }
+}
+
+uint8_t W25Q_AsyncSubmit(const W25Q_Job_t *job) {
+  if (count >= W25Q_ASYNC_QUEUE_LEN)
+    return 0;
+
+  queue[(head + count) % W25Q_ASYNC_QUEUE_LEN] = *job;
+  count++;
+  return 1;
+}
+
+void W25Q_AsyncProcess(void) {
+  if (count == 0)
+    return;
+
+  // One status read per step; a blocking driver call may also be using the
+  // chip, so never start a job while BUSY is set.
+  if (W25Q_IsBusy())
+    return;
+
+  if (active) {
+    uint8_t ok = 1;
+    if (queue[head].type == W25Q_JOB_PROGRAM && W25Q_ProgramFailed()) {
+      if (retries < W25Q_PROGRAM_RETRIES) {
+        retries++;
+        W25Q_AsyncStart(&queue[head]); // Same data again, see w25q32.c
+        return;
+      }
+      ok = 0;
+    }
+
+    // Running job finished: retire it before starting the next one
+    W25Q_Job_t done = queue[head];
+    head = (head + 1) % W25Q_ASYNC_QUEUE_LEN;
+    count--;
+    active = 0;
+
+    if (done.done)
+      done.done(done.ctx, ok);
+
+    if (count == 0)
+      return;
+  }
+
+  W25Q_AsyncStart(&queue[head]);
+  active = 1;
+  retries = 0;
+}
+
+uint8_t W25Q_AsyncIdle(void) { return count == 0; }
+
+void W25Q_AsyncDrain(void) {
+  while (!W25Q_AsyncIdle()) {
+    W25Q_AsyncProcess();
+  }
+}
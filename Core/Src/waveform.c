@@ -0,0 +1,163 @@
+/*
+ * waveform.c
+ *
+ *  Created on: Mar 18, 2026
+ *      Author: BioFET Team
+ */
+
+#include "waveform.h"
+
+static uint16_t wave_table[WAVE_TABLE_LEN]; // DAC frames
+static uint16_t wave_len = 0;
+static uint16_t wave_index = 0;
+static uint32_t wave_period_us = 0; // Hold time of each table entry
+
+static Waveform_Source_t wave_next = NULL;
+static void *wave_ctx = NULL;
+static volatile uint16_t wave_frame = 0; // Frame of the current step
+static volatile uint8_t wave_running = 0;
+static volatile uint8_t wave_pending = 0; // Step not yet on the DAC
+static uint32_t wave_deferred = 0;
+static uint32_t wave_skipped = 0; // Pending steps replaced before written
+static DAC_Channel_t *wave_ch = NULL;
+static TIM_HandleTypeDef *wave_tim = NULL;
+
+void Waveform_Init(TIM_HandleTypeDef *htim) { wave_tim = htim; }
+
+// Step source that plays the table built by Waveform_LoadRamp
+static uint8_t Waveform_TableNext(void *ctx, uint16_t *frame,
+                                  uint32_t *hold_us) {
+  if (wave_index >= wave_len)
+    return 0;
+  *frame = wave_table[wave_index++];
+  *hold_us = wave_period_us;
+  return 1;
+}
+
+/*
+ * Fills the table with a linear ramp. The number of entries is limited by
+ * the number of distinct codes, the table size and WAVE_MIN_PERIOD_US, so
+ * short ramps use fewer, faster steps.
+ * Returns 0 if the ramp cannot be played (no timer, zero duration).
+ */
+uint8_t Waveform_LoadRamp(DAC_Channel_t *ch, int32_t start_mv,
+                          int32_t end_mv, uint32_t duration_ms) {
+  if (wave_tim == NULL || duration_ms == 0) {
+    wave_len = 0; // Waveform_Start() must not replay an older ramp
+    return 0;
+  }
+  Waveform_Stop();
+
+  int32_t c0 = DAC_MvToCode(ch, start_mv);
+  int32_t c1 = DAC_MvToCode(ch, end_mv);
+  uint32_t steps = (uint32_t)((c1 > c0) ? c1 - c0 : c0 - c1) + 1;
+  uint64_t duration_us = (uint64_t)duration_ms * 1000;
+
+  uint32_t n = (steps < WAVE_TABLE_LEN) ? steps : WAVE_TABLE_LEN;
+  if (n < 2)
+    n = 2;
+  if (duration_us / (n - 1) < WAVE_MIN_PERIOD_US)
+    n = (uint32_t)(duration_us / WAVE_MIN_PERIOD_US) + 1;
+  if (n < 2)
+    n = 2;
+
+  for (uint32_t i = 0; i < n; i++) {
+    int32_t code = c0 + (int32_t)(((int64_t)(c1 - c0) * i) / (n - 1));
+    wave_table[i] = DAC_FRAME(code);
+  }
+
+  wave_ch = ch;
+  wave_len = n;
+  wave_index = 0;
+  // Entry n-1 is reached exactly at the end of the ramp
+  wave_period_us = (uint32_t)(duration_us / (n - 1));
+  return 1;
+}
+
+void Waveform_Start(void) {
+  if (wave_len == 0)
+    return;
+  wave_index = 0;
+  Waveform_StartSource(wave_ch, Waveform_TableNext, NULL);
+}
+
+/*
+ * Takes the next step from the source and sets the timer to fire when it
+ * ends. Called right after an update event, while the counter is still far
+ * below any new ARR, so the new period applies to the step just started.
+ */
+static uint8_t Waveform_Fetch(void) {
+  uint16_t frame;
+  uint32_t hold_us;
+  if (!wave_next(wave_ctx, &frame, &hold_us))
+    return 0;
+  if (hold_us < WAVE_MIN_PERIOD_US)
+    hold_us = WAVE_MIN_PERIOD_US;
+  wave_frame = frame;
+  __HAL_TIM_SET_AUTORELOAD(wave_tim, hold_us - 1);
+  return 1;
+}
+
+uint8_t Waveform_StartSource(DAC_Channel_t *ch, Waveform_Source_t next,
+                             void *ctx) {
+  if (wave_tim == NULL)
+    return 0;
+  Waveform_Stop();
+
+  wave_ch = ch;
+  wave_next = next;
+  wave_ctx = ctx;
+  wave_deferred = 0;
+  wave_skipped = 0;
+  if (!Waveform_Fetch())
+    return 0;
+
+  DAC_WriteFrame(wave_ch, wave_frame);
+  wave_running = 1;
+  __HAL_TIM_SET_COUNTER(wave_tim, 0);
+  HAL_TIM_Base_Start_IT(wave_tim);
+  return 1;
+}
+
+void Waveform_Stop(void) {
+  if (wave_tim != NULL)
+    HAL_TIM_Base_Stop_IT(wave_tim);
+  wave_running = 0;
+  wave_pending = 0;
+}
+
+uint8_t Waveform_Running(void) { return wave_running || wave_pending; }
+
+uint32_t Waveform_Deferred(void) { return wave_deferred; }
+
+uint32_t Waveform_Skipped(void) { return wave_skipped; }
+
+void Waveform_OnTick(void) {
+  if (!wave_running)
+    return;
+
+  if (!Waveform_Fetch()) {
+    HAL_TIM_Base_Stop_IT(wave_tim); // Source exhausted
+    wave_running = 0;
+    return;
+  }
+
+  if (wave_ch->cs->kind == CHIPSEL_NATIVE && SpiBus_Idle(wave_ch->hspi)) {
+    DAC_WriteFrameFast(wave_ch, wave_frame);
+    wave_pending = 0;
+  } else {
+    if (wave_pending)
+      wave_skipped++; // The previous step never reached the DAC
+    wave_pending = 1;
+  }
+}
+
+void Waveform_Service(void) {
+  if (!wave_pending)
+    return;
+
+  // Clear first: a tick arriving during the write sets it again
+  wave_pending = 0;
+  wave_deferred++;
+  DAC_WriteFrame(wave_ch, wave_frame);
+}
@@ -5,19 +5,76 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../Core/Src/acquisition.c \
+../Core/Src/autorange.c \
+../Core/Src/chip_select.c \
+../Core/Src/command.c \
+../Core/Src/dac.c \
+../Core/Src/dsp.c \
+../Core/Src/flash_log.c \
+../Core/Src/frame.c \
 ../Core/Src/main.c \
 ../Core/Src/mcp23s17.c \
-../Core/Src/w25q32.c 
+../Core/Src/offload.c \
+../Core/Src/perf.c \
+../Core/Src/profile.c \
+../Core/Src/run_index.c \
+../Core/Src/scheduler.c \
+../Core/Src/spi_bus.c \
+../Core/Src/stream.c \
+../Core/Src/uart_rx.c \
+../Core/Src/uart_tx.c \
+../Core/Src/w25q32.c \
+../Core/Src/w25q_async.c \
+../Core/Src/waveform.c 
 
 C_DEPS += \
+./Core/Src/acquisition.d \
+./Core/Src/autorange.d \
+./Core/Src/chip_select.d \
+./Core/Src/command.d \
+./Core/Src/dac.d \
+./Core/Src/dsp.d \
+./Core/Src/flash_log.d \
+./Core/Src/frame.d \
 ./Core/Src/main.d \
 ./Core/Src/mcp23s17.d \
-./Core/Src/w25q32.d 
+./Core/Src/offload.d \
+./Core/Src/perf.d \
+./Core/Src/profile.d \
+./Core/Src/run_index.d \
+./Core/Src/scheduler.d \
+./Core/Src/spi_bus.d \
+./Core/Src/stream.d \
+./Core/Src/uart_rx.d \
+./Core/Src/uart_tx.d \
+./Core/Src/w25q32.d \
+./Core/Src/w25q_async.d \
+./Core/Src/waveform.d 
 
 OBJS += \
+./Core/Src/acquisition.o \
+./Core/Src/autorange.o \
+./Core/Src/chip_select.o \
+./Core/Src/command.o \
+./Core/Src/dac.o \
+./Core/Src/dsp.o \
+./Core/Src/flash_log.o \
+./Core/Src/frame.o \
 ./Core/Src/main.o \
 ./Core/Src/mcp23s17.o \
-./Core/Src/w25q32.o 
+./Core/Src/offload.o \
+./Core/Src/perf.o \
+./Core/Src/profile.o \
+./Core/Src/run_index.o \
+./Core/Src/scheduler.o \
+./Core/Src/spi_bus.o \
+./Core/Src/stream.o \
+./Core/Src/uart_rx.o \
+./Core/Src/uart_tx.o \
+./Core/Src/w25q32.o \
+./Core/Src/w25q_async.o \
+./Core/Src/waveform.o 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -27,7 +84,7 @@ Core/Src/%.o Core/Src/%.su Core/Src/%.cyclo: ../Core/Src/%.c Core/Src/subdir.mk
 clean: clean-Core-2f-Src
 
 clean-Core-2f-Src:
-	-$(RM) ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/mcp23s17.cyclo ./Core/Src/mcp23s17.d ./Core/Src/mcp23s17.o ./Core/Src/mcp23s17.su ./Core/Src/w25q32.cyclo ./Core/Src/w25q32.d ./Core/Src/w25q32.o ./Core/Src/w25q32.su
+	-$(RM) ./Core/Src/acquisition.cyclo ./Core/Src/acquisition.d ./Core/Src/acquisition.o ./Core/Src/acquisition.su ./Core/Src/autorange.cyclo ./Core/Src/autorange.d ./Core/Src/autorange.o ./Core/Src/autorange.su ./Core/Src/chip_select.cyclo ./Core/Src/chip_select.d ./Core/Src/chip_select.o ./Core/Src/chip_select.su ./Core/Src/command.cyclo ./Core/Src/command.d ./Core/Src/command.o ./Core/Src/command.su ./Core/Src/dac.cyclo ./Core/Src/dac.d ./Core/Src/dac.o ./Core/Src/dac.su ./Core/Src/dsp.cyclo ./Core/Src/dsp.d ./Core/Src/dsp.o ./Core/Src/dsp.su ./Core/Src/flash_log.cyclo ./Core/Src/flash_log.d ./Core/Src/flash_log.o ./Core/Src/flash_log.su ./Core/Src/frame.cyclo ./Core/Src/frame.d ./Core/Src/frame.o ./Core/Src/frame.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/mcp23s17.cyclo ./Core/Src/mcp23s17.d ./Core/Src/mcp23s17.o ./Core/Src/mcp23s17.su ./Core/Src/offload.cyclo ./Core/Src/offload.d ./Core/Src/offload.o ./Core/Src/offload.su ./Core/Src/perf.cyclo ./Core/Src/perf.d ./Core/Src/perf.o ./Core/Src/perf.su ./Core/Src/profile.cyclo ./Core/Src/profile.d ./Core/Src/profile.o ./Core/Src/profile.su ./Core/Src/run_index.cyclo ./Core/Src/run_index.d ./Core/Src/run_index.o ./Core/Src/run_index.su ./Core/Src/scheduler.cyclo ./Core/Src/scheduler.d ./Core/Src/scheduler.o ./Core/Src/scheduler.su ./Core/Src/spi_bus.cyclo ./Core/Src/spi_bus.d ./Core/Src/spi_bus.o ./Core/Src/spi_bus.su ./Core/Src/stream.cyclo ./Core/Src/stream.d ./Core/Src/stream.o ./Core/Src/stream.su ./Core/Src/uart_rx.cyclo ./Core/Src/uart_rx.d ./Core/Src/uart_rx.o ./Core/Src/uart_rx.su ./Core/Src/uart_tx.cyclo ./Core/Src/uart_tx.d ./Core/Src/uart_tx.o ./Core/Src/uart_tx.su ./Core/Src/w25q32.cyclo ./Core/Src/w25q32.d ./Core/Src/w25q32.o ./Core/Src/w25q32.su ./Core/Src/w25q_async.cyclo ./Core/Src/w25q_async.d ./Core/Src/w25q_async.o ./Core/Src/w25q_async.su ./Core/Src/waveform.cyclo ./Core/Src/waveform.d ./Core/Src/waveform.o ./Core/Src/waveform.su
 
 .PHONY: clean-Core-2f-Src
 
@@ -0,0 +1,248 @@
+/*
+ * sim.h
+ *
+ *  Created on: Apr 16, 2026
+ *      Author: BioFET Team
+ *
+ *  Host simulation of the BioFET board: the firmware in Core/Src runs
+ *  unchanged on Linux against the HAL in stm32f4xx_hal.h, with models of
+ *  the W25Q32 flash, the three MCP23S17 expanders and the UART link.
+ *
+ *  Time is simulated and deterministic. It is kept in picoseconds and only
+ *  moves when the firmware touches the hardware: every HAL call and CMSIS
+ *  intrinsic costs a fixed number of core cycles (SIM_CYC_*), SPI and UART
+ *  transfers take their wire time, and __WFI jumps to the next event.
+ *  Firmware computation between two calls costs nothing, so cycle counts
+ *  (PROFILE) show where the bus and peripheral time goes, not how long the
+ *  C code itself takes on the Cortex-M4.
+ *
+ *  Interrupts are taken at the end of a HAL call or intrinsic, when
+ *  PRIMASK is clear and no handler is running (no nesting). A pending
+ *  interrupt is never lost; priorities only order the pending ones. A
+ *  firmware loop that polls a variable without any HAL call is caught by
+ *  a CPU-time watchdog (SIGALRM), which moves time on to the next event.
+ *  The same loop with interrupts masked, or inside a handler, can never
+ *  end: the simulation reports a deadlock and exits.
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include "stm32f4xx_hal.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#define SIM_PS_PER_S 1000000000000ULL
+#define SIM_PS_PER_MS 1000000000ULL
+#define SIM_PS_PER_US 1000000ULL
+
+// Core cycles charged per call (Cortex-M4, HAL at -O0 or so)
+#define SIM_CYC_INTRINSIC 2
+#define SIM_CYC_GPIO_FAST 2    // One BSRR store
+#define SIM_CYC_GPIO 12        // HAL_GPIO_WritePin / ReadPin
+#define SIM_CYC_REG 2          // Trapped peripheral register access
+#define SIM_CYC_HAL 40         // Small HAL calls (GetState, GetTick, ...)
+#define SIM_CYC_SPI_CALL 120   // Blocking HAL SPI transfer, set-up
+#define SIM_CYC_SPI_BYTE 24    // ... polling loop, per byte at least
+#define SIM_CYC_DMA_START 180  // HAL *_DMA start
+#define SIM_CYC_IRQ_ENTRY 12   // Exception entry + exit
+#define SIM_CYC_IRQ_HAL 60     // HAL IRQ handler bookkeeping
+#define SIM_CYC_INIT 400       // HAL_*_Init
+
+// ============================================================================
+// TIME AND INTERRUPTS (sim_core.c)
+// ============================================================================
+
+// Timed sources, in tie-break order
+typedef enum {
+  SIM_EV_SYSTICK,
+  SIM_EV_TIM2,
+  SIM_EV_TIM5,
+  SIM_EV_SPI_DMA,
+  SIM_EV_UART_TX,
+  SIM_EV_UART_RX,
+  SIM_EV_UART_IDLE,
+  SIM_EV_HOST,
+  SIM_EV_COUNT
+} Sim_Event_t;
+
+typedef void (*Sim_EventFn_t)(void);
+
+// Interrupt lines the firmware has handlers for
+typedef enum {
+  SIM_IRQ_SYSTICK,
+  SIM_IRQ_DMA2_S0,
+  SIM_IRQ_DMA2_S2,
+  SIM_IRQ_DMA2_S3,
+  SIM_IRQ_DMA2_S7,
+  SIM_IRQ_SPI1,
+  SIM_IRQ_USART1,
+  SIM_IRQ_TIM2,
+  SIM_IRQ_TIM5,
+  SIM_IRQ_COUNT
+} Sim_Irq_t;
+
+typedef void (*Sim_DmaFn_t)(void);
+
+extern uint64_t g_SimNow; // ps since power-up
+
+void Sim_Init(void); // Power-on state of the core and all models
+void Sim_Enter(const char *what);
+void Sim_Leave(uint32_t cycles);
+void Sim_LeaveQuiet(uint32_t cycles); // No interrupt taken (trap handlers)
+void Sim_Spend(uint32_t cycles);
+void Sim_Wait(uint64_t ps); // Wire time, events run meanwhile
+uint64_t Sim_CyclesToPs(uint32_t cycles);
+uint32_t Sim_CoreHz(void);
+uint32_t Sim_Pclk2Hz(void);
+uint32_t Sim_Pclk1Hz(void);
+
+void Sim_Schedule(Sim_Event_t ev, uint64_t at, Sim_EventFn_t fn);
+void Sim_Cancel(Sim_Event_t ev);
+uint64_t Sim_Due(Sim_Event_t ev); // UINT64_MAX when off
+void Sim_Pend(Sim_Irq_t irq);
+Sim_Irq_t Sim_CurrentIrq(void); // Line being handled
+void Sim_SetDmaHandler(Sim_Irq_t irq, Sim_DmaFn_t fn); // HAL_DMA_IRQHandler
+
+// Runs events until t (host side, outside the firmware)
+void Sim_RunUntil(uint64_t t);
+void Sim_Fatal(const char *fmt, ...)
+    __attribute__((noreturn, format(printf, 1, 2)));
+
+// Realtime pacing for interactive use; speed 0 runs flat out
+void Sim_SetRealtime(double speed);
+void Sim_SetHseFails(uint8_t fails);
+void Sim_SetKey(uint8_t pressed);
+// Right before firmware code first runs: host setup must not look like a
+// stall
+void Sim_StartWatchdog(void);
+
+// ============================================================================
+// GPIO AND SPI BUS (sim_core.c, sim_spi.c)
+// ============================================================================
+
+uint8_t Sim_GpioLevel(GPIO_TypeDef *port, uint16_t pin);
+
+typedef enum {
+  SIM_SPI_FLASH,
+  SIM_SPI_EXP1,
+  SIM_SPI_EXP2,
+  SIM_SPI_EXP3,
+  SIM_SPI_DAC_HV,
+  SIM_SPI_DAC_LV,
+  SIM_SPI_ADC1,
+  SIM_SPI_ADC2,
+  SIM_SPI_ADC3,
+  SIM_SPI_ADC4,
+  SIM_SPI_TARGET_COUNT
+} Sim_SpiTarget_t;
+
+typedef struct {
+  uint64_t Bytes;
+  uint64_t CsCycles;
+  uint64_t BusPs;      // Time with SCK running for this target
+  uint32_t ModeErrors; // CPOL/CPHA the part does not accept
+  uint32_t SckErrors;  // SCK above the part's limit
+} Sim_SpiStats_t;
+
+typedef struct {
+  Sim_SpiStats_t Target[SIM_SPI_TARGET_COUNT];
+  uint64_t Bytes;      // All bytes clocked
+  uint64_t RegBytes;   // ... of them by register-level code
+  uint64_t Unselected; // ... with no chip selected
+  uint64_t Shared;     // ... with more than one selected
+  uint32_t Contention; // ... with the flash and another chip selected
+  uint16_t DacCode[2]; // Last code latched by the HV / LV DAC
+  uint32_t DacWrites[2];
+} Sim_SpiBusStats_t;
+
+extern Sim_SpiBusStats_t g_SimSpi;
+
+void Sim_SpiInit(void);
+void Sim_SpiCsChanged(void); // Re-evaluates all chip selects
+const char *Sim_SpiTargetName(Sim_SpiTarget_t t);
+
+// ============================================================================
+// DEVICE MODELS (sim_w25q32.c, sim_mcp23s17.c)
+// ============================================================================
+
+typedef struct {
+  uint32_t PagePrograms;
+  uint32_t SectorErases;
+  uint32_t BlockErases;
+  uint32_t ChipErases;
+  uint64_t BytesRead;
+  uint64_t BytesProgrammed;
+  uint32_t PageWraps;      // Page program data wrapped inside its page
+  uint32_t ZeroToOne;      // Program tried to set a 0 bit (needs erase)
+  uint32_t BusyCommands;   // Command other than 05h while BUSY
+  uint32_t NoWel;          // Program / erase without Write Enable
+  uint32_t ReadOverclock;  // 03h above 50 MHz
+  uint64_t BusyPs;         // Time spent programming / erasing
+  uint32_t MaxSectorErases;
+} Sim_FlashStats_t;
+
+extern Sim_FlashStats_t g_SimFlash;
+
+void Sim_FlashInit(void);
+void Sim_FlashSelect(uint8_t selected);
+uint8_t Sim_FlashByte(uint8_t out, uint32_t sck_hz);
+uint8_t *Sim_FlashMemory(void); // FLASH_TOTAL_SIZE bytes
+int Sim_FlashLoad(const char *path);
+int Sim_FlashSave(const char *path);
+
+typedef struct {
+  uint64_t Frames;
+  uint64_t RegWrites;
+  uint32_t Ignored; // Frames for another hardware address
+} Sim_ExpStats_t;
+
+#define SIM_EXPANDERS 3
+
+void Sim_ExpInit(void);
+void Sim_ExpSelect(uint8_t cs_line, uint8_t selected);
+uint8_t Sim_ExpByte(uint8_t cs_line, uint8_t out);
+uint16_t Sim_ExpPins(uint8_t exp); // Driven levels, GPB in the high byte
+uint16_t Sim_ExpOutputs(uint8_t exp); // Pins configured as outputs
+const Sim_ExpStats_t *Sim_ExpStats(uint8_t exp);
+
+// ============================================================================
+// UART LINK (sim_uart.c)
+// ============================================================================
+
+typedef void (*Sim_UartSink_t)(const uint8_t *data, uint32_t len);
+
+typedef struct {
+  uint64_t TxBytes;
+  uint64_t RxBytes;
+} Sim_UartStats_t;
+
+extern Sim_UartStats_t g_SimUart;
+
+void Sim_UartInit(void);
+void Sim_UartSetSink(Sim_UartSink_t sink); // Bytes the board sends
+void Sim_UartInject(const void *data, uint32_t len); // Bytes to the board
+uint32_t Sim_UartPending(void); // Injected bytes not yet received
+// Bytes wait while reception is stopped (SET_BAUD), they are not lost
+int Sim_UartOpenPty(char *name, size_t size); // Interactive link
+void Sim_UartPollPty(void);
+
+// ============================================================================
+// BENCHES (sim_bench.c)
+// ============================================================================
+
+typedef struct {
+  const char *FlashImage; // Loaded before, saved after; NULL = blank chip
+  uint32_t Baud;          // Offload rate, 0 keeps 115200
+  uint32_t RunMs;         // Logging time of the "run" bench
+  uint32_t RateHz;        // Sample rate of the "run" bench
+} Sim_BenchOpts_t;
+
+int Sim_Bench(const char *name, const Sim_BenchOpts_t *opts);
+void Sim_BenchList(FILE *out);
+void Sim_Report(FILE *out); // Bus, flash and link counters
+
+// Firmware entry (main.c built with -Dmain=Firmware_Main)
+int Firmware_Main(void);
+
+#endif /* SIM_H_ */
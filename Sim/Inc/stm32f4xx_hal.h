@@ -0,0 +1,568 @@
+/*
+ * stm32f4xx_hal.h (host simulation)
+ *
+ *  Created on: Apr 16, 2026
+ *      Author: BioFET Team
+ *
+ *  Stand-in for the STM32F4 HAL when Core/Src is built on Linux (Sim/).
+ *  Only the part of the HAL the firmware uses is provided. Types, field
+ *  names and constants match the real HAL so the firmware compiles
+ *  unchanged; register blocks are plain structs in host memory.
+ *
+ *  The functions are implemented in Sim/Src against simulated time
+ *  (sim.h). Every HAL call and CMSIS intrinsic costs a few core cycles, and
+ *  pending interrupts are delivered there. SPI1 registers are trapped
+ *  (sim_spi.c), so the register-level ADC and DAC paths reach the device
+ *  models too.
+ */
+
+#ifndef SIM_STM32F4XX_HAL_H_
+#define SIM_STM32F4XX_HAL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define __IO volatile
+#define __I volatile const
+
+#define HSE_VALUE ((uint32_t)25000000)
+#define HSI_VALUE ((uint32_t)16000000)
+#define LSE_VALUE ((uint32_t)32768)
+#define LSI_VALUE ((uint32_t)32000)
+#define TICK_INT_PRIORITY ((uint32_t)0)
+
+typedef enum {
+  HAL_OK = 0x00,
+  HAL_ERROR = 0x01,
+  HAL_BUSY = 0x02,
+  HAL_TIMEOUT = 0x03
+} HAL_StatusTypeDef;
+
+typedef enum { HAL_UNLOCKED = 0x00, HAL_LOCKED = 0x01 } HAL_LockTypeDef;
+
+// ============================================================================
+// CORE (CMSIS)
+// ============================================================================
+
+typedef enum {
+  SysTick_IRQn = -1,
+  DMA2_Stream0_IRQn = 56,
+  DMA2_Stream2_IRQn = 58,
+  DMA2_Stream3_IRQn = 59,
+  DMA2_Stream7_IRQn = 70,
+  SPI1_IRQn = 35,
+  USART1_IRQn = 37,
+  TIM2_IRQn = 28,
+  TIM5_IRQn = 50
+} IRQn_Type;
+
+typedef struct {
+  __IO uint32_t CTRL;
+  __IO uint32_t LOAD;
+  __IO uint32_t VAL;
+  __I uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct {
+  __IO uint32_t CTRL;
+  __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+  __IO uint32_t DHCSR;
+  __IO uint32_t DCRSR;
+  __IO uint32_t DCRDR;
+  __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+#define DWT_CTRL_CYCCNTENA_Msk (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+// Counter registers are brought up to simulated time on every access
+SysTick_Type *Sim_SysTickRegs(void);
+DWT_Type *Sim_DwtRegs(void);
+extern CoreDebug_Type Sim_CoreDebug;
+#define SysTick (Sim_SysTickRegs())
+#define DWT (Sim_DwtRegs())
+#define CoreDebug (&Sim_CoreDebug)
+
+extern uint32_t SystemCoreClock;
+
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+void __WFI(void);
+void __DMB(void);
+void __DSB(void);
+void __ISB(void);
+void __NOP(void);
+
+// ============================================================================
+// GPIO
+// ============================================================================
+
+typedef struct {
+  __IO uint32_t MODER;
+  __IO uint32_t OTYPER;
+  __IO uint32_t OSPEEDR;
+  __IO uint32_t PUPDR;
+  __IO uint32_t IDR;
+  __IO uint32_t ODR;
+  __IO uint32_t BSRR;
+  __IO uint32_t LCKR;
+  __IO uint32_t AFR[2];
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef Sim_GpioA, Sim_GpioB, Sim_GpioC;
+#define GPIOA (&Sim_GpioA)
+#define GPIOB (&Sim_GpioB)
+#define GPIOC (&Sim_GpioC)
+
+typedef enum { GPIO_PIN_RESET = 0, GPIO_PIN_SET } GPIO_PinState;
+
+typedef struct {
+  uint32_t Pin;
+  uint32_t Mode;
+  uint32_t Pull;
+  uint32_t Speed;
+  uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+#define GPIO_PIN_0 ((uint16_t)0x0001)
+#define GPIO_PIN_1 ((uint16_t)0x0002)
+#define GPIO_PIN_2 ((uint16_t)0x0004)
+#define GPIO_PIN_3 ((uint16_t)0x0008)
+#define GPIO_PIN_4 ((uint16_t)0x0010)
+#define GPIO_PIN_5 ((uint16_t)0x0020)
+#define GPIO_PIN_6 ((uint16_t)0x0040)
+#define GPIO_PIN_7 ((uint16_t)0x0080)
+#define GPIO_PIN_8 ((uint16_t)0x0100)
+#define GPIO_PIN_9 ((uint16_t)0x0200)
+#define GPIO_PIN_10 ((uint16_t)0x0400)
+#define GPIO_PIN_11 ((uint16_t)0x0800)
+#define GPIO_PIN_12 ((uint16_t)0x1000)
+#define GPIO_PIN_13 ((uint16_t)0x2000)
+#define GPIO_PIN_14 ((uint16_t)0x4000)
+#define GPIO_PIN_15 ((uint16_t)0x8000)
+
+#define GPIO_MODE_INPUT 0x00000000U
+#define GPIO_MODE_OUTPUT_PP 0x00000001U
+#define GPIO_MODE_AF_PP 0x00000002U
+#define GPIO_NOPULL 0x00000000U
+#define GPIO_PULLUP 0x00000001U
+#define GPIO_PULLDOWN 0x00000002U
+#define GPIO_SPEED_FREQ_LOW 0x00000000U
+#define GPIO_SPEED_FREQ_MEDIUM 0x00000001U
+#define GPIO_SPEED_FREQ_HIGH 0x00000002U
+#define GPIO_SPEED_FREQ_VERY_HIGH 0x00000003U
+
+// Chip select edges (main.h): a BSRR store cannot be observed on the host
+void Sim_GpioWrite(GPIO_TypeDef *port, uint16_t pins, uint8_t level);
+#define GPIO_FAST_HIGH(port, pin) Sim_GpioWrite((port), (pin), 1)
+#define GPIO_FAST_LOW(port, pin) Sim_GpioWrite((port), (pin), 0)
+
+void HAL_GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init);
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *port, uint16_t pin);
+
+// ============================================================================
+// RCC / PWR / FLASH
+// ============================================================================
+
+typedef struct {
+  uint32_t PLLState;
+  uint32_t PLLSource;
+  uint32_t PLLM;
+  uint32_t PLLN;
+  uint32_t PLLP;
+  uint32_t PLLQ;
+} RCC_PLLInitTypeDef;
+
+typedef struct {
+  uint32_t OscillatorType;
+  uint32_t HSEState;
+  uint32_t LSEState;
+  uint32_t HSIState;
+  uint32_t HSICalibrationValue;
+  uint32_t LSIState;
+  RCC_PLLInitTypeDef PLL;
+} RCC_OscInitTypeDef;
+
+typedef struct {
+  uint32_t ClockType;
+  uint32_t SYSCLKSource;
+  uint32_t AHBCLKDivider;
+  uint32_t APB1CLKDivider;
+  uint32_t APB2CLKDivider;
+} RCC_ClkInitTypeDef;
+
+#define RCC_OSCILLATORTYPE_HSE 0x00000001U
+#define RCC_OSCILLATORTYPE_HSI 0x00000002U
+#define RCC_HSE_ON 0x00010000U
+#define RCC_HSI_ON 0x00000001U
+#define RCC_HSICALIBRATION_DEFAULT 0x10U
+#define RCC_PLL_NONE 0x00000000U
+#define RCC_PLL_OFF 0x00000001U
+#define RCC_PLL_ON 0x00000002U
+#define RCC_PLLSOURCE_HSI 0x00000000U
+#define RCC_PLLSOURCE_HSE 0x00400000U
+#define RCC_PLLP_DIV2 0x00000002U
+#define RCC_PLLP_DIV4 0x00000004U
+#define RCC_PLLP_DIV6 0x00000006U
+#define RCC_PLLP_DIV8 0x00000008U
+
+#define RCC_CLOCKTYPE_SYSCLK 0x00000001U
+#define RCC_CLOCKTYPE_HCLK 0x00000002U
+#define RCC_CLOCKTYPE_PCLK1 0x00000004U
+#define RCC_CLOCKTYPE_PCLK2 0x00000008U
+#define RCC_SYSCLKSOURCE_HSI 0x00000000U
+#define RCC_SYSCLKSOURCE_HSE 0x00000001U
+#define RCC_SYSCLKSOURCE_PLLCLK 0x00000002U
+#define RCC_SYSCLK_DIV1 0x00000000U
+#define RCC_SYSCLK_DIV2 0x00000080U
+#define RCC_SYSCLK_DIV4 0x00000090U
+#define RCC_HCLK_DIV1 0x00000000U
+#define RCC_HCLK_DIV2 0x00001000U
+#define RCC_HCLK_DIV4 0x00001400U
+
+#define FLASH_LATENCY_0 0x00000000U
+#define FLASH_LATENCY_1 0x00000001U
+#define FLASH_LATENCY_2 0x00000002U
+#define FLASH_LATENCY_3 0x00000003U
+
+#define PWR_REGULATOR_VOLTAGE_SCALE2 0x00008000U
+#define PWR_REGULATOR_VOLTAGE_SCALE3 0x00004000U
+
+#define __HAL_RCC_PWR_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOA_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOB_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOC_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_DMA2_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_TIM2_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_TIM5_CLK_ENABLE() ((void)0)
+#define __HAL_PWR_VOLTAGESCALING_CONFIG(scale) ((void)(scale))
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *osc);
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *clk,
+                                      uint32_t latency);
+uint32_t HAL_RCC_GetSysClockFreq(void);
+uint32_t HAL_RCC_GetHCLKFreq(void);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+uint32_t HAL_RCC_GetPCLK2Freq(void);
+
+// ============================================================================
+// HAL BASE / NVIC
+// ============================================================================
+
+extern __IO uint32_t uwTick;
+
+HAL_StatusTypeDef HAL_Init(void);
+void HAL_IncTick(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t ms);
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preempt, uint32_t sub);
+void HAL_NVIC_EnableIRQ(IRQn_Type irq);
+void HAL_NVIC_DisableIRQ(IRQn_Type irq);
+
+// ============================================================================
+// DMA
+// ============================================================================
+
+typedef struct {
+  __IO uint32_t CR;
+  __IO uint32_t NDTR;
+  __IO uint32_t PAR;
+  __IO uint32_t M0AR;
+  __IO uint32_t M1AR;
+  __IO uint32_t FCR;
+} DMA_Stream_TypeDef;
+
+extern DMA_Stream_TypeDef Sim_Dma2Stream[8];
+#define DMA2_Stream0 (&Sim_Dma2Stream[0])
+#define DMA2_Stream2 (&Sim_Dma2Stream[2])
+#define DMA2_Stream3 (&Sim_Dma2Stream[3])
+#define DMA2_Stream7 (&Sim_Dma2Stream[7])
+
+typedef struct {
+  uint32_t Channel;
+  uint32_t Direction;
+  uint32_t PeriphInc;
+  uint32_t MemInc;
+  uint32_t PeriphDataAlignment;
+  uint32_t MemDataAlignment;
+  uint32_t Mode;
+  uint32_t Priority;
+  uint32_t FIFOMode;
+  uint32_t FIFOThreshold;
+  uint32_t MemBurst;
+  uint32_t PeriphBurst;
+} DMA_InitTypeDef;
+
+typedef struct __DMA_HandleTypeDef {
+  DMA_Stream_TypeDef *Instance;
+  DMA_InitTypeDef Init;
+  HAL_LockTypeDef Lock;
+  void *Parent;
+} DMA_HandleTypeDef;
+
+#define DMA_CHANNEL_3 0x06000000U
+#define DMA_CHANNEL_4 0x08000000U
+#define DMA_PERIPH_TO_MEMORY 0x00000000U
+#define DMA_MEMORY_TO_PERIPH 0x00000040U
+#define DMA_PINC_DISABLE 0x00000000U
+#define DMA_MINC_ENABLE 0x00000400U
+#define DMA_PDATAALIGN_BYTE 0x00000000U
+#define DMA_MDATAALIGN_BYTE 0x00000000U
+#define DMA_NORMAL 0x00000000U
+#define DMA_CIRCULAR 0x00000100U
+#define DMA_PRIORITY_LOW 0x00000000U
+#define DMA_PRIORITY_MEDIUM 0x00010000U
+#define DMA_PRIORITY_HIGH 0x00020000U
+#define DMA_FIFOMODE_DISABLE 0x00000000U
+
+#define __HAL_LINKDMA(handle, field, dma)                                      \
+  do {                                                                         \
+    (handle)->field = &(dma);                                                  \
+    (dma).Parent = (handle);                                                   \
+  } while (0)
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma);
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma);
+
+// ============================================================================
+// SPI
+// ============================================================================
+
+typedef struct {
+  __IO uint32_t CR1;
+  __IO uint32_t CR2;
+  __IO uint32_t SR;
+  __IO uint32_t DR;
+  __IO uint32_t CRCPR;
+  __IO uint32_t RXCRCR;
+  __IO uint32_t TXCRCR;
+  __IO uint32_t I2SCFGR;
+  __IO uint32_t I2SPR;
+} SPI_TypeDef;
+
+// A page of its own: sim_spi.c traps every access to it
+extern uint8_t Sim_Spi1Page[4096];
+#define SPI1 ((SPI_TypeDef *)Sim_Spi1Page)
+
+#define SPI_CR1_CPHA (1UL << 0)
+#define SPI_CR1_CPOL (1UL << 1)
+#define SPI_CR1_MSTR (1UL << 2)
+#define SPI_CR1_BR (7UL << 3)
+#define SPI_CR1_SPE (1UL << 6)
+#define SPI_SR_RXNE (1UL << 0)
+#define SPI_SR_TXE (1UL << 1)
+#define SPI_SR_BSY (1UL << 7)
+
+typedef struct {
+  uint32_t Mode;
+  uint32_t Direction;
+  uint32_t DataSize;
+  uint32_t CLKPolarity;
+  uint32_t CLKPhase;
+  uint32_t NSS;
+  uint32_t BaudRatePrescaler;
+  uint32_t FirstBit;
+  uint32_t TIMode;
+  uint32_t CRCCalculation;
+  uint32_t CRCPolynomial;
+} SPI_InitTypeDef;
+
+typedef enum {
+  HAL_SPI_STATE_RESET = 0x00U,
+  HAL_SPI_STATE_READY = 0x01U,
+  HAL_SPI_STATE_BUSY = 0x02U,
+  HAL_SPI_STATE_BUSY_TX = 0x03U,
+  HAL_SPI_STATE_BUSY_RX = 0x04U,
+  HAL_SPI_STATE_BUSY_TX_RX = 0x05U,
+  HAL_SPI_STATE_ERROR = 0x06U,
+  HAL_SPI_STATE_ABORT = 0x07U
+} HAL_SPI_StateTypeDef;
+
+typedef struct __SPI_HandleTypeDef {
+  SPI_TypeDef *Instance;
+  SPI_InitTypeDef Init;
+  uint8_t *pTxBuffPtr;
+  uint16_t TxXferSize;
+  uint8_t *pRxBuffPtr;
+  uint16_t RxXferSize;
+  DMA_HandleTypeDef *hdmatx;
+  DMA_HandleTypeDef *hdmarx;
+  HAL_LockTypeDef Lock;
+  __IO HAL_SPI_StateTypeDef State;
+  __IO uint32_t ErrorCode;
+} SPI_HandleTypeDef;
+
+#define SPI_MODE_MASTER (SPI_CR1_MSTR | (1UL << 8))
+#define SPI_DIRECTION_2LINES 0x00000000U
+#define SPI_DATASIZE_8BIT 0x00000000U
+#define SPI_POLARITY_LOW 0x00000000U
+#define SPI_POLARITY_HIGH SPI_CR1_CPOL
+#define SPI_PHASE_1EDGE 0x00000000U
+#define SPI_PHASE_2EDGE SPI_CR1_CPHA
+#define SPI_NSS_SOFT (1UL << 9)
+#define SPI_FIRSTBIT_MSB 0x00000000U
+#define SPI_TIMODE_DISABLE 0x00000000U
+#define SPI_CRCCALCULATION_DISABLE 0x00000000U
+#define SPI_BAUDRATEPRESCALER_2 0x00000000U
+#define SPI_BAUDRATEPRESCALER_16 0x00000018U
+#define SPI_BAUDRATEPRESCALER_256 0x00000038U
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi);
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *pData,
+                                   uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData,
+                                  uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi,
+                                          uint8_t *pTxData, uint8_t *pRxData,
+                                          uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi,
+                                       uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData,
+                                      uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi,
+                                              uint8_t *pTxData,
+                                              uint8_t *pRxData, uint16_t Size);
+HAL_SPI_StateTypeDef HAL_SPI_GetState(SPI_HandleTypeDef *hspi);
+void HAL_SPI_IRQHandler(SPI_HandleTypeDef *hspi);
+
+// Defined by the firmware
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+
+// ============================================================================
+// TIM
+// ============================================================================
+
+typedef struct {
+  __IO uint32_t CR1;
+  __IO uint32_t DIER;
+  __IO uint32_t SR;
+  __IO uint32_t CNT;
+  __IO uint32_t PSC;
+  __IO uint32_t ARR;
+} TIM_TypeDef;
+
+extern TIM_TypeDef Sim_Tim2, Sim_Tim5;
+#define TIM2 (&Sim_Tim2)
+#define TIM5 (&Sim_Tim5)
+
+typedef struct {
+  uint32_t Prescaler;
+  uint32_t CounterMode;
+  uint32_t Period;
+  uint32_t ClockDivision;
+  uint32_t RepetitionCounter;
+  uint32_t AutoReloadPreload;
+} TIM_Base_InitTypeDef;
+
+typedef struct {
+  TIM_TypeDef *Instance;
+  TIM_Base_InitTypeDef Init;
+  HAL_LockTypeDef Lock;
+} TIM_HandleTypeDef;
+
+#define TIM_COUNTERMODE_UP 0x00000000U
+#define TIM_CLOCKDIVISION_DIV1 0x00000000U
+#define TIM_AUTORELOAD_PRELOAD_DISABLE 0x00000000U
+
+// Macros in the real HAL; the timer model needs to see the writes
+void Sim_TimSetAutoreload(TIM_HandleTypeDef *htim, uint32_t arr);
+void Sim_TimSetCounter(TIM_HandleTypeDef *htim, uint32_t cnt);
+#define __HAL_TIM_SET_AUTORELOAD(h, v) Sim_TimSetAutoreload((h), (v))
+#define __HAL_TIM_SET_COUNTER(h, v) Sim_TimSetCounter((h), (v))
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim);
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim);
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+
+// ============================================================================
+// UART
+// ============================================================================
+
+typedef struct {
+  __IO uint32_t SR;
+  __IO uint32_t DR;
+  __IO uint32_t BRR;
+  __IO uint32_t CR1;
+  __IO uint32_t CR2;
+  __IO uint32_t CR3;
+} USART_TypeDef;
+
+extern USART_TypeDef Sim_Usart1;
+#define USART1 (&Sim_Usart1)
+
+typedef struct {
+  uint32_t BaudRate;
+  uint32_t WordLength;
+  uint32_t StopBits;
+  uint32_t Parity;
+  uint32_t Mode;
+  uint32_t HwFlowCtl;
+  uint32_t OverSampling;
+} UART_InitTypeDef;
+
+typedef enum {
+  HAL_UART_STATE_RESET = 0x00U,
+  HAL_UART_STATE_READY = 0x20U,
+  HAL_UART_STATE_BUSY = 0x24U,
+  HAL_UART_STATE_BUSY_TX = 0x21U,
+  HAL_UART_STATE_BUSY_RX = 0x22U,
+  HAL_UART_STATE_ERROR = 0xE0U
+} HAL_UART_StateTypeDef;
+
+typedef struct __UART_HandleTypeDef {
+  USART_TypeDef *Instance;
+  UART_InitTypeDef Init;
+  const uint8_t *pTxBuffPtr;
+  uint16_t TxXferSize;
+  uint8_t *pRxBuffPtr;
+  uint16_t RxXferSize;
+  DMA_HandleTypeDef *hdmatx;
+  DMA_HandleTypeDef *hdmarx;
+  HAL_LockTypeDef Lock;
+  __IO HAL_UART_StateTypeDef gState;
+  __IO HAL_UART_StateTypeDef RxState;
+  __IO uint32_t ErrorCode;
+} UART_HandleTypeDef;
+
+#define UART_WORDLENGTH_8B 0x00000000U
+#define UART_STOPBITS_1 0x00000000U
+#define UART_PARITY_NONE 0x00000000U
+#define UART_MODE_TX_RX 0x0000000CU
+#define UART_HWCONTROL_NONE 0x00000000U
+#define UART_OVERSAMPLING_16 0x00000000U
+#define UART_OVERSAMPLING_8 0x00008000U
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart,
+                                        const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart,
+                                               uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart);
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart);
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_STM32F4XX_HAL_H_ */
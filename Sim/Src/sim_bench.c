@@ -0,0 +1,626 @@
+/*
+ * sim_bench.c
+ *
+ *  Created on: Apr 16, 2026
+ *      Author: BioFET Team
+ *
+ *  Benchmarks and regression checks on the simulated board. Each bench
+ *  runs in its own process and ends it: exit status 0 when every check
+ *  passed. Results are printed as "BENCH <name> key=value ..." lines.
+ *
+ *  pages     W25Q_Write / W25Q_Read of unaligned, page-crossing ranges
+ *  run       A logged ramp test over the command link, then its offload
+ *  fullchip  Offload of a run filling the whole data ring
+ *
+ *  The firmware is driven from its UART like the GUI does: a script of
+ *  commands, each sent once the reply to the previous one has arrived,
+ *  stepped from a 1ms host event.
+ */
+
+#define _GNU_SOURCE // memmem
+#include "sim.h"
+#include "main.h"
+#include "flash_log.h"
+#include "log_format.h"
+#include "run_index.h"
+#include "spi_bus.h"
+#include "w25q32.h"
+#include "w25q_async.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern SPI_HandleTypeDef hspi1;
+void SystemClock_Config(void);
+
+#define BENCH_STEPS_MAX 16
+
+typedef struct {
+  char Send[48];      // Command line, empty = send nothing
+  const char *Expect; // Reply that completes the step
+  size_t From;        // Output position when the step started
+  size_t To;          // End of the matched reply
+  uint64_t SentPs;
+  uint64_t DonePs;
+} Bench_Step_t;
+
+static Bench_Step_t steps[BENCH_STEPS_MAX];
+static int step_count;
+static int step_cur;
+static uint64_t bench_deadline;
+static void (*bench_done)(void);
+
+static uint8_t *out_buf;
+static size_t out_len, out_cap, out_mark;
+
+static const Sim_BenchOpts_t *opts;
+static int failures;
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+static void Bench_Check(int ok, const char *what) {
+  if (!ok) {
+    printf("FAIL %s\n", what);
+    failures++;
+  }
+}
+
+static void Bench_Sink(const uint8_t *data, uint32_t len) {
+  if (out_len + len > out_cap) {
+    out_cap = (out_len + len) * 2;
+    out_buf = realloc(out_buf, out_cap);
+    if (out_buf == NULL)
+      Sim_Fatal("out of memory");
+  }
+  memcpy(&out_buf[out_len], data, len);
+  out_len += len;
+}
+
+static void Bench_Add(const char *expect, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void Bench_Add(const char *expect, const char *fmt, ...) {
+  Bench_Step_t *s = &steps[step_count++];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(s->Send, sizeof(s->Send), fmt, ap);
+  va_end(ap);
+  s->Expect = expect;
+}
+
+static void Bench_StartStep(void) {
+  Bench_Step_t *s = &steps[step_cur];
+  s->From = out_mark;
+  s->SentPs = g_SimNow;
+  if (s->Send[0] != '\0')
+    Sim_UartInject(s->Send, strlen(s->Send));
+}
+
+// Common failure exit: where the script stopped and what came back last
+static void Bench_Abort(const char *why) {
+  size_t from = (out_len > 400) ? out_len - 400 : 0;
+  printf("FAIL %s at step %d (waiting for \"%s\")\n", why, step_cur,
+         steps[step_cur].Expect);
+  printf("---- last output ----\n");
+  for (size_t i = from; i < out_len; i++)
+    putchar((out_buf[i] >= 0x20 && out_buf[i] < 0x7F) || out_buf[i] == '\n'
+                ? out_buf[i]
+                : '.');
+  printf("\n---------------------\n");
+  Sim_Report(stdout);
+  fflush(stdout);
+  exit(1);
+}
+
+static void Bench_OnHost(void) {
+  while (step_cur < step_count) {
+    Bench_Step_t *s = &steps[step_cur];
+    uint8_t *hit = memmem(&out_buf[out_mark], out_len - out_mark, s->Expect,
+                          strlen(s->Expect));
+    if (hit == NULL)
+      break;
+    out_mark = (hit - out_buf) + strlen(s->Expect);
+    s->To = out_mark;
+    s->DonePs = g_SimNow;
+    if (++step_cur < step_count)
+      Bench_StartStep();
+  }
+  if (step_cur == step_count) {
+    bench_done(); // Does not return
+    return;
+  }
+  if (g_SimNow > bench_deadline)
+    Bench_Abort("timeout");
+  Sim_Schedule(SIM_EV_HOST, g_SimNow + SIM_PS_PER_MS, Bench_OnHost);
+}
+
+// Boots the firmware with the script queued; never returns
+static void Bench_Boot(uint64_t timeout_ps, void (*done)(void)) {
+  bench_done = done;
+  bench_deadline = g_SimNow + timeout_ps;
+  step_cur = 0;
+  out_mark = out_len;
+  Bench_StartStep();
+  Sim_UartSetSink(Bench_Sink);
+  Sim_Schedule(SIM_EV_HOST, g_SimNow + SIM_PS_PER_MS, Bench_OnHost);
+  Sim_StartWatchdog();
+  Firmware_Main();
+  Sim_Fatal("firmware returned");
+}
+
+// Prints the text replies of a step, as the firmware sent them
+static void Bench_Echo(const Bench_Step_t *s) {
+  const char *p = (const char *)&out_buf[s->From];
+  const char *end = (const char *)out_buf + s->To;
+  while (p < end) {
+    const char *nl = memchr(p, '\n', end - p);
+    if (nl == NULL)
+      nl = end;
+    if (nl > p)
+      printf("  | %.*s\n", (int)(nl - p), p);
+    p = nl + 1;
+  }
+}
+
+// Finds "BEGIN_DATA <n>\n" in the reply of s; returns the data or NULL
+static const uint8_t *Bench_Data(const Bench_Step_t *s, uint32_t *len) {
+  static const char tag[] = "BEGIN_DATA ";
+  uint8_t *p = memmem(&out_buf[s->From], s->To - s->From, tag,
+                      sizeof(tag) - 1);
+  if (p == NULL)
+    return NULL;
+  char *end;
+  *len = (uint32_t)strtoul((char *)p + sizeof(tag) - 1, &end, 10);
+  if (*end != '\n' || (uint8_t *)end + 1 + *len > &out_buf[s->To])
+    return NULL;
+  return (uint8_t *)end + 1;
+}
+
+static double Bench_Seconds(uint64_t ps) { return (double)ps / SIM_PS_PER_S; }
+
+// Protocol and part misuse, the same for every bench
+static void Bench_CheckBus(void) {
+  Bench_Check(g_SimFlash.PageWraps == 0, "flash page program wrapped");
+  Bench_Check(g_SimFlash.ZeroToOne == 0, "flash programmed without erase");
+  Bench_Check(g_SimFlash.BusyCommands == 0, "flash command while busy");
+  Bench_Check(g_SimFlash.NoWel == 0, "flash write without WREN");
+  Bench_Check(g_SimFlash.ReadOverclock == 0, "flash 03h above 50MHz");
+  Bench_Check(g_SimSpi.Contention == 0, "flash selected with another chip");
+  Bench_Check(g_SimSpi.Unselected == 0, "SPI bytes with no chip selected");
+  for (int t = 0; t < SIM_SPI_TARGET_COUNT; t++) {
+    Bench_Check(g_SimSpi.Target[t].ModeErrors == 0, "SPI mode");
+    Bench_Check(g_SimSpi.Target[t].SckErrors == 0, "SPI clock too fast");
+  }
+}
+
+static void Bench_Finish(const char *name) {
+  Sim_Report(stdout);
+  if (opts->FlashImage != NULL && Sim_FlashSave(opts->FlashImage) != 0)
+    Bench_Check(0, "flash image not saved");
+  printf("BENCH %s result=%s failures=%d\n", name, failures ? "FAIL" : "PASS",
+         failures);
+  fflush(stdout);
+  exit(failures ? 1 : 0);
+}
+
+// SPI1 and the flash CS only, as MX_GPIO_Init / MX_SPI1_Init set them up
+static void Bench_FlashInit(void) {
+  Sim_StartWatchdog(); // Firmware code runs from here
+  HAL_Init();
+  SystemClock_Config();
+  SpiBus_Init(&hspi1);
+
+  GPIO_InitTypeDef gpio = {0};
+  HAL_GPIO_WritePin(FLASH_CS_GPIO_Port, FLASH_CS_Pin, GPIO_PIN_SET);
+  gpio.Pin = FLASH_CS_Pin;
+  gpio.Mode = GPIO_MODE_OUTPUT_PP;
+  gpio.Pull = GPIO_NOPULL;
+  gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  HAL_GPIO_Init(FLASH_CS_GPIO_Port, &gpio);
+
+  hspi1.Instance = SPI1;
+  hspi1.Init.Mode = SPI_MODE_MASTER;
+  hspi1.Init.NSS = SPI_NSS_SOFT;
+  hspi1.Init.BaudRatePrescaler = g_SpiBusCr1[SPI_DEV_EXPANDER] & SPI_CR1_BR;
+  hspi1.Init.CLKPolarity = SPI_POLARITY_LOW;
+  hspi1.Init.CLKPhase = SPI_PHASE_1EDGE;
+  HAL_SPI_Init(&hspi1);
+
+  HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+  HAL_NVIC_SetPriority(DMA2_Stream3_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream3_IRQn);
+}
+
+// Host-side work the watchdog must leave alone
+static void Bench_HostBegin(void) { Sim_Enter("bench"); }
+static void Bench_HostEnd(void) { Sim_LeaveQuiet(0); }
+
+// ============================================================================
+// PAGES
+// ============================================================================
+
+#define PAGES_BASE 0x100000
+#define PAGES_SPAN 0x10000 // 64KB, 16 sectors
+
+static uint32_t bench_rng = 1;
+
+static uint8_t Bench_Rand(void) {
+  bench_rng = bench_rng * 1103515245 + 12345;
+  return (uint8_t)(bench_rng >> 16);
+}
+
+static int Bench_Pages(void) {
+  static uint8_t image[PAGES_SPAN];
+  static uint8_t back[PAGES_SPAN];
+
+  Bench_FlashInit();
+  for (uint32_t a = PAGES_BASE; a < PAGES_BASE + PAGES_SPAN;
+       a += FLASH_SECTOR_SIZE)
+    W25Q_EraseSector(a);
+
+  // Unaligned start, lengths from 1 byte to over two pages
+  Bench_HostBegin();
+  for (uint32_t i = 0; i < PAGES_SPAN; i++)
+    image[i] = Bench_Rand();
+  Bench_HostEnd();
+
+  uint32_t addr = 37;
+  uint32_t writes = 0;
+  uint64_t t0 = g_SimNow;
+  while (addr < PAGES_SPAN) {
+    uint32_t len = 1 + Bench_Rand() * 3; // 1..766
+    if (addr + len > PAGES_SPAN)
+      len = PAGES_SPAN - addr;
+    W25Q_Write(&image[addr], PAGES_BASE + addr, len);
+    addr += len;
+    writes++;
+  }
+  uint64_t t_write = g_SimNow - t0;
+  uint32_t written = PAGES_SPAN - 37;
+
+  t0 = g_SimNow;
+  for (uint32_t a = 0; a < PAGES_SPAN; a += 1000) {
+    uint32_t len = (a + 1000 > PAGES_SPAN) ? PAGES_SPAN - a : 1000;
+    W25Q_Read(&back[a], PAGES_BASE + a, len);
+  }
+  uint64_t t_read = g_SimNow - t0;
+
+  Bench_HostBegin();
+  const uint8_t *mem = Sim_FlashMemory() + PAGES_BASE;
+  int mem_ok = 1, read_ok = 1;
+  for (uint32_t i = 0; i < PAGES_SPAN; i++) {
+    uint8_t want = (i < 37) ? 0xFF : image[i];
+    mem_ok &= (mem[i] == want);
+    read_ok &= (back[i] == want);
+  }
+  Bench_HostEnd();
+  Bench_Check(mem_ok, "flash contents differ from what was written");
+  Bench_Check(read_ok, "W25Q_Read differs from the flash contents");
+  Bench_CheckBus();
+
+  printf("BENCH pages bytes=%lu writes=%lu programs=%lu write_s=%.4f "
+         "write_kBps=%.1f read_s=%.4f read_kBps=%.1f\n",
+         (unsigned long)written, (unsigned long)writes,
+         (unsigned long)g_SimFlash.PagePrograms, Bench_Seconds(t_write),
+         written / 1000.0 / Bench_Seconds(t_write), Bench_Seconds(t_read),
+         PAGES_SPAN / 1000.0 / Bench_Seconds(t_read));
+  Bench_Finish("pages");
+  return failures ? 1 : 0;
+}
+
+// ============================================================================
+// RUN
+// ============================================================================
+
+enum {
+  RUN_READY,
+  RUN_TYPE,
+  RUN_RATE,
+  RUN_TIME,
+  RUN_PROFILE_RESET,
+  RUN_TASKS_RESET,
+  RUN_START,
+  RUN_COMPLETE,
+  RUN_TASKS,
+  RUN_PROFILE,
+  RUN_LIST,
+  RUN_READ,
+};
+
+static void Bench_RunDone(void) {
+  uint32_t period_us = 1000000 / opts->RateHz;
+  uint32_t len = 0;
+  const uint8_t *data = Bench_Data(&steps[RUN_READ], &len);
+
+  Bench_Echo(&steps[RUN_TASKS]);
+  Bench_Echo(&steps[RUN_PROFILE]);
+  Bench_Echo(&steps[RUN_LIST]);
+
+  Bench_HostBegin();
+  Bench_Check(data != NULL, "no BEGIN_DATA in the offload");
+  uint32_t records = 0;
+  if (data != NULL && len >= sizeof(Log_Header_t)) {
+    Log_Header_t h;
+    memcpy(&h, data, sizeof(h));
+    Bench_Check(h.Magic == LOG_MAGIC, "header magic");
+    Bench_Check(h.HeaderSize == sizeof(Log_Header_t), "header size");
+    Bench_Check(h.ChannelCount == 4 && h.RecordSize == LOG_RECORD_SIZE(4),
+                "record layout");
+    Bench_Check(h.SamplePeriodUs == period_us, "sample period");
+    Bench_Check(h.TestType == 2, "test type");
+    Bench_Check(h.RunTimeMs + 1 >= opts->RunMs &&
+                    h.RunTimeMs <= opts->RunMs + 1,
+                "run time"); // Float minutes round either way
+
+    uint32_t body = len - sizeof(Log_Header_t);
+    Bench_Check(body % LOG_RECORD_SIZE(4) == 0, "partial record");
+    records = body / LOG_RECORD_SIZE(4);
+    uint32_t want = (uint64_t)opts->RunMs * 1000 / period_us;
+    Bench_Check(records + 2 >= want && records <= want + 2, "record count");
+
+    int times_ok = 1, ramp_ok = 1;
+    Log_Record_t prev = {0};
+    for (uint32_t i = 0; i < records; i++) {
+      Log_Record_t r;
+      memcpy(&r, data + sizeof(Log_Header_t) + i * LOG_RECORD_SIZE(4),
+             LOG_RECORD_SIZE(4));
+      if (i > 0) {
+        times_ok &= (r.TimeMs > prev.TimeMs);
+        ramp_ok &= (r.DacSetpoint >= prev.DacSetpoint);
+      }
+      prev = r;
+    }
+    Bench_Check(times_ok, "record times not increasing");
+    Bench_Check(ramp_ok, "ramp setpoint went down");
+  }
+  Bench_HostEnd();
+  Bench_CheckBus();
+
+  uint64_t run_ps = steps[RUN_COMPLETE].DonePs - steps[RUN_START].DonePs;
+  uint64_t off_ps = steps[RUN_READ].DonePs - steps[RUN_READ].SentPs;
+  printf("BENCH run rate_hz=%lu run_s=%.3f records=%lu log_Bps=%.1f "
+         "offload_bytes=%lu offload_s=%.3f offload_kBps=%.2f baud=%lu\n",
+         (unsigned long)opts->RateHz, Bench_Seconds(run_ps),
+         (unsigned long)records,
+         len / Bench_Seconds(run_ps ? run_ps : 1),
+         (unsigned long)len, Bench_Seconds(off_ps),
+         len / 1000.0 / Bench_Seconds(off_ps ? off_ps : 1), 115200UL);
+  Bench_Finish("run");
+}
+
+static int Bench_Run(void) {
+  double minutes = opts->RunMs / 60000.0;
+  step_count = 0;
+  Bench_Add("BioFET Ready\n", "%s", "");
+  Bench_Add("OK: Type Set", "SET_TYPE 2\n");
+  Bench_Add("OK: Rate Set", "SET_RATE %lu\n", (unsigned long)opts->RateHz);
+  Bench_Add("OK: Time Set", "SET_TIME %.6f\n", minutes);
+  Bench_Add("OK: Profile Reset", "PROFILE_RESET\n");
+  Bench_Add("OK: Task Stats Reset", "TASKS_RESET\n");
+  Bench_Add("OK: Started", "START\n");
+  Bench_Add("TEST_COMPLETE\n", "%s", "");
+  Bench_Add(" Tasks\n", "TASKS\n");
+  Bench_Add(" Zones\n", "PROFILE\n");
+  Bench_Add(" Runs\n", "LIST_RUNS\n");
+  Bench_Add("\nEND_DATA\n", "READ_FLASH\n");
+  Bench_Boot((uint64_t)opts->RunMs * SIM_PS_PER_MS + 120 * SIM_PS_PER_S,
+             Bench_RunDone);
+  return 1;
+}
+
+// ============================================================================
+// FULL CHIP
+// ============================================================================
+// One synthetic run fills all but a few sectors of the data ring. Its
+// bytes are a function of their offset, so the offload is checked as it
+// is parsed, without keeping a copy.
+
+#define FULL_SECTORS (LOG_RING_SECTORS - 22)
+#define FULL_PERIOD_US 10000
+
+static uint32_t full_len;
+
+static uint8_t Bench_FullByte(uint32_t off) {
+  if (off < sizeof(Log_Header_t)) {
+    Log_Header_t h;
+    memset(&h, 0, sizeof(h));
+    h.Magic = LOG_MAGIC;
+    h.Version = LOG_FORMAT_VERSION;
+    h.HeaderSize = sizeof(Log_Header_t);
+    h.RecordSize = LOG_RECORD_SIZE(4);
+    h.ChannelCount = 4;
+    h.SamplePeriodUs = FULL_PERIOD_US;
+    h.RunTimeMs = 0;
+    h.TestType = 1;
+    h.DacLsb_uV = LOG_DAC_LSB_UV;
+    return ((const uint8_t *)&h)[off];
+  }
+  off -= sizeof(Log_Header_t);
+  uint32_t i = off / LOG_RECORD_SIZE(4);
+  Log_Record_t r;
+  r.TimeMs = i * (FULL_PERIOD_US / 1000);
+  r.DacSetpoint = (int16_t)(i % 10000);
+  r.Ranges = 0;
+  for (int c = 0; c < 4; c++)
+    r.Reading[c] = (int16_t)((i * 7 + c * 1001) & 0x7FFF);
+  return ((const uint8_t *)&r)[off % LOG_RECORD_SIZE(4)];
+}
+
+// Writes the run through the firmware's own log writer
+static void Bench_FullPrefill(void) {
+  static FlashLog_t log;
+  uint8_t chunk[FLASH_PAGE_SIZE];
+  uint32_t body = FULL_SECTORS * LOG_SECTOR_PAYLOAD - sizeof(Log_Header_t);
+  full_len = sizeof(Log_Header_t) +
+             body / LOG_RECORD_SIZE(4) * LOG_RECORD_SIZE(4);
+
+  Bench_FlashInit();
+  RunIndex_Init();
+  uint16_t id = RunIndex_Begin(1, 0.0f, FULL_PERIOD_US);
+  uint32_t seq;
+  uint16_t off;
+  RunIndex_Head(&seq, &off);
+  FlashLog_Init(&log, seq, off, id);
+  FlashLog_Reserve(&log, full_len);
+
+  uint32_t done = 0;
+  while (done < full_len) {
+    uint32_t n = (full_len - done < sizeof(chunk)) ? full_len - done
+                                                    : sizeof(chunk);
+    Bench_HostBegin();
+    for (uint32_t i = 0; i < n; i++)
+      chunk[i] = Bench_FullByte(done + i);
+    Bench_HostEnd();
+    done += FlashLog_Append(&log, chunk, n);
+    W25Q_AsyncProcess();
+    FlashLog_Service(&log);
+  }
+  FlashLog_Flush(&log);
+  W25Q_AsyncDrain();
+  RunIndex_End(FlashLog_Size(&log));
+  W25Q_AsyncDrain();
+}
+
+static uint32_t Bench_Baud(void) { return opts->Baud ? opts->Baud : 115200; }
+
+static void Bench_FullDone(void) {
+  uint32_t len = 0;
+  const uint8_t *data = Bench_Data(&steps[step_count - 1], &len);
+
+  Bench_Echo(&steps[step_count - 2]);
+  Bench_Check(data != NULL, "no BEGIN_DATA in the offload");
+  Bench_Check(len == full_len, "offload length");
+  if (data != NULL && len == full_len) {
+    Bench_HostBegin();
+    uint32_t bad = 0;
+    for (uint32_t i = 0; i < len; i++)
+      bad += (data[i] != Bench_FullByte(i));
+    Bench_HostEnd();
+    Bench_Check(bad == 0, "offload data differs from the run written");
+  }
+  Bench_CheckBus();
+
+  const Bench_Step_t *rd = &steps[step_count - 1];
+  uint64_t off_ps = rd->DonePs - rd->SentPs;
+  double wire_s = (double)len * 10 / Bench_Baud();
+  printf("BENCH fullchip bytes=%lu sectors=%lu baud=%lu offload_s=%.3f "
+         "offload_kBps=%.2f link_use=%.3f\n",
+         (unsigned long)len, (unsigned long)FULL_SECTORS,
+         (unsigned long)Bench_Baud(), Bench_Seconds(off_ps),
+         len / 1000.0 / Bench_Seconds(off_ps), wire_s / Bench_Seconds(off_ps));
+  Bench_Finish("fullchip");
+}
+
+static int Bench_Full(void) {
+  uint64_t t0 = g_SimNow;
+  Bench_FullPrefill();
+  printf("BENCH fullchip_prefill bytes=%lu s=%.3f kBps=%.1f programs=%lu "
+         "erases=%lu\n",
+         (unsigned long)full_len, Bench_Seconds(g_SimNow - t0),
+         full_len / 1000.0 / Bench_Seconds(g_SimNow - t0),
+         (unsigned long)g_SimFlash.PagePrograms,
+         (unsigned long)(g_SimFlash.SectorErases + g_SimFlash.BlockErases));
+  Bench_CheckBus();
+
+  step_count = 0;
+  Bench_Add("BioFET Ready\n", "%s", "");
+  if (opts->Baud)
+    Bench_Add("OK: Baud Set", "SET_BAUD %lu\n", (unsigned long)opts->Baud);
+  Bench_Add(" Runs\n", "LIST_RUNS\n");
+  Bench_Add("\nEND_DATA\n", "READ_FLASH\n");
+  Bench_Boot((uint64_t)(2.0 * full_len * 10 / Bench_Baud() * SIM_PS_PER_S) +
+                 60 * SIM_PS_PER_S,
+             Bench_FullDone);
+  return 1;
+}
+
+// ============================================================================
+// ENTRY
+// ============================================================================
+
+typedef struct {
+  const char *Name;
+  int (*Run)(void);
+  const char *Help;
+} Bench_t;
+
+static const Bench_t benches[] = {
+    {"pages", Bench_Pages, "unaligned page-crossing writes and reads"},
+    {"run", Bench_Run, "logged ramp test, then its offload"},
+    {"fullchip", Bench_Full, "offload of a run filling the data ring"},
+};
+
+void Sim_BenchList(FILE *f) {
+  for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+    fprintf(f, "  %-9s %s\n", benches[i].Name, benches[i].Help);
+}
+
+int Sim_Bench(const char *name, const Sim_BenchOpts_t *o) {
+  opts = o;
+  for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+    if (strcmp(name, benches[i].Name) == 0)
+      return benches[i].Run();
+  }
+  fprintf(stderr, "unknown bench %s\n", name);
+  return 2;
+}
+
+// ============================================================================
+// REPORT
+// ============================================================================
+
+void Sim_Report(FILE *f) {
+  fprintf(f, "SIM time_s=%.6f core_hz=%lu\n", Bench_Seconds(g_SimNow),
+          (unsigned long)Sim_CoreHz());
+  fprintf(f, "SPI bytes=%llu reg_bytes=%llu unselected=%llu shared=%llu "
+             "contention=%lu\n",
+          (unsigned long long)g_SimSpi.Bytes,
+          (unsigned long long)g_SimSpi.RegBytes,
+          (unsigned long long)g_SimSpi.Unselected,
+          (unsigned long long)g_SimSpi.Shared,
+          (unsigned long)g_SimSpi.Contention);
+  for (int t = 0; t < SIM_SPI_TARGET_COUNT; t++) {
+    const Sim_SpiStats_t *st = &g_SimSpi.Target[t];
+    if (st->Bytes == 0 && st->CsCycles == 0)
+      continue;
+    fprintf(f, "SPI %-6s bytes=%llu cs=%llu bus_s=%.6f mode_err=%lu "
+               "sck_err=%lu\n",
+            Sim_SpiTargetName((Sim_SpiTarget_t)t),
+            (unsigned long long)st->Bytes, (unsigned long long)st->CsCycles,
+            Bench_Seconds(st->BusPs), (unsigned long)st->ModeErrors,
+            (unsigned long)st->SckErrors);
+  }
+  fprintf(f, "DAC hv_code=%u hv_writes=%lu lv_code=%u lv_writes=%lu\n",
+          g_SimSpi.DacCode[0], (unsigned long)g_SimSpi.DacWrites[0],
+          g_SimSpi.DacCode[1], (unsigned long)g_SimSpi.DacWrites[1]);
+  fprintf(f, "FLASH programs=%lu sector_erases=%lu block_erases=%lu "
+             "chip_erases=%lu read=%llu programmed=%llu busy_s=%.3f "
+             "max_sector_erases=%lu\n",
+          (unsigned long)g_SimFlash.PagePrograms,
+          (unsigned long)g_SimFlash.SectorErases,
+          (unsigned long)g_SimFlash.BlockErases,
+          (unsigned long)g_SimFlash.ChipErases,
+          (unsigned long long)g_SimFlash.BytesRead,
+          (unsigned long long)g_SimFlash.BytesProgrammed,
+          Bench_Seconds(g_SimFlash.BusyPs),
+          (unsigned long)g_SimFlash.MaxSectorErases);
+  fprintf(f, "FLASH page_wraps=%lu zero_to_one=%lu busy_cmds=%lu no_wel=%lu "
+             "read_overclock=%lu\n",
+          (unsigned long)g_SimFlash.PageWraps,
+          (unsigned long)g_SimFlash.ZeroToOne,
+          (unsigned long)g_SimFlash.BusyCommands,
+          (unsigned long)g_SimFlash.NoWel,
+          (unsigned long)g_SimFlash.ReadOverclock);
+  for (uint8_t i = 0; i < SIM_EXPANDERS; i++) {
+    const Sim_ExpStats_t *e = Sim_ExpStats(i);
+    fprintf(f, "EXP%u frames=%llu reg_writes=%llu ignored=%lu pins=0x%04X\n",
+            i + 1, (unsigned long long)e->Frames,
+            (unsigned long long)e->RegWrites, (unsigned long)e->Ignored,
+            Sim_ExpPins(i));
+  }
+  fprintf(f, "UART tx=%llu rx=%llu\n", (unsigned long long)g_SimUart.TxBytes,
+          (unsigned long long)g_SimUart.RxBytes);
+}
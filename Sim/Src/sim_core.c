@@ -0,0 +1,801 @@
+/*
+ * sim_core.c
+ *
+ *  Created on: Apr 16, 2026
+ *      Author: BioFET Team
+ *
+ *  Simulated time, interrupts, clocks, GPIO and timers (see sim.h).
+ */
+
+#include "sim.h"
+#include <signal.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+// Firmware interrupt handlers (main.c)
+void SysTick_Handler(void);
+void DMA2_Stream0_IRQHandler(void);
+void DMA2_Stream2_IRQHandler(void);
+void DMA2_Stream3_IRQHandler(void);
+void DMA2_Stream7_IRQHandler(void);
+void SPI1_IRQHandler(void);
+void USART1_IRQHandler(void);
+void TIM2_IRQHandler(void);
+void TIM5_IRQHandler(void);
+
+typedef struct {
+  IRQn_Type Irqn;
+  void (*Handler)(void);
+} Sim_IrqLine_t;
+
+static const Sim_IrqLine_t irq_lines[SIM_IRQ_COUNT] = {
+    [SIM_IRQ_SYSTICK] = {SysTick_IRQn, SysTick_Handler},
+    [SIM_IRQ_DMA2_S0] = {DMA2_Stream0_IRQn, DMA2_Stream0_IRQHandler},
+    [SIM_IRQ_DMA2_S2] = {DMA2_Stream2_IRQn, DMA2_Stream2_IRQHandler},
+    [SIM_IRQ_DMA2_S3] = {DMA2_Stream3_IRQn, DMA2_Stream3_IRQHandler},
+    [SIM_IRQ_DMA2_S7] = {DMA2_Stream7_IRQn, DMA2_Stream7_IRQHandler},
+    [SIM_IRQ_SPI1] = {SPI1_IRQn, SPI1_IRQHandler},
+    [SIM_IRQ_USART1] = {USART1_IRQn, USART1_IRQHandler},
+    [SIM_IRQ_TIM2] = {TIM2_IRQn, TIM2_IRQHandler},
+    [SIM_IRQ_TIM5] = {TIM5_IRQn, TIM5_IRQHandler},
+};
+
+// ============================================================================
+// REGISTERS AND HAL GLOBALS
+// ============================================================================
+
+uint32_t SystemCoreClock = HSI_VALUE;
+__IO uint32_t uwTick;
+
+GPIO_TypeDef Sim_GpioA, Sim_GpioB, Sim_GpioC;
+TIM_TypeDef Sim_Tim2, Sim_Tim5;
+DMA_Stream_TypeDef Sim_Dma2Stream[8];
+CoreDebug_Type Sim_CoreDebug;
+static SysTick_Type systick_regs;
+static DWT_Type dwt_regs;
+
+uint64_t g_SimNow = 0;
+
+// ============================================================================
+// TIME
+// ============================================================================
+
+static uint32_t core_hz = HSI_VALUE;
+static uint32_t pclk1_hz = HSI_VALUE;
+static uint32_t pclk2_hz = HSI_VALUE;
+static uint64_t clk_base_ps = 0;  // Time of the last core clock change
+static uint64_t clk_base_cyc = 0; // Cycles counted up to it
+
+static uint64_t ev_due[SIM_EV_COUNT];
+static Sim_EventFn_t ev_fn[SIM_EV_COUNT];
+
+static volatile uint32_t sim_busy = 0;  // Inside simulator code
+static volatile uint64_t sim_calls = 0; // Entries, for the watchdog
+static const char *sim_last = "reset";   // Last HAL call, for reports
+static uint32_t primask = 0;
+static uint8_t in_isr = 0;
+static Sim_Irq_t cur_irq = SIM_IRQ_COUNT;
+static uint8_t irq_pending[SIM_IRQ_COUNT];
+static uint8_t irq_enabled[SIM_IRQ_COUNT];
+static uint8_t irq_prio[SIM_IRQ_COUNT];
+static Sim_DmaFn_t dma_fn[SIM_IRQ_COUNT];
+
+static double rt_speed = 0;
+static struct timespec rt_wall0;
+static uint64_t rt_sim0;
+
+uint64_t Sim_CyclesToPs(uint32_t cycles) {
+  return ((unsigned __int128)cycles * SIM_PS_PER_S + core_hz - 1) / core_hz;
+}
+
+static uint64_t Sim_Cycles(void) {
+  return clk_base_cyc +
+         (uint64_t)((unsigned __int128)(g_SimNow - clk_base_ps) * core_hz /
+                    SIM_PS_PER_S);
+}
+
+static void Sim_SetCoreHz(uint32_t hz) {
+  clk_base_cyc = Sim_Cycles();
+  clk_base_ps = g_SimNow;
+  core_hz = hz;
+  SystemCoreClock = hz;
+}
+
+uint32_t Sim_CoreHz(void) { return core_hz; }
+uint32_t Sim_Pclk1Hz(void) { return pclk1_hz; }
+uint32_t Sim_Pclk2Hz(void) { return pclk2_hz; }
+
+void Sim_Schedule(Sim_Event_t ev, uint64_t at, Sim_EventFn_t fn) {
+  ev_due[ev] = (at < g_SimNow) ? g_SimNow : at;
+  ev_fn[ev] = fn;
+}
+
+void Sim_Cancel(Sim_Event_t ev) { ev_due[ev] = UINT64_MAX; }
+
+uint64_t Sim_Due(Sim_Event_t ev) { return ev_due[ev]; }
+
+static Sim_Event_t Sim_NextEvent(void) {
+  Sim_Event_t next = SIM_EV_COUNT;
+  uint64_t due = UINT64_MAX;
+  for (int i = 0; i < SIM_EV_COUNT; i++) {
+    if (ev_due[i] < due) {
+      due = ev_due[i];
+      next = (Sim_Event_t)i;
+    }
+  }
+  return next;
+}
+
+// Events due at or before t run in time order, ties in Sim_Event_t order
+void Sim_RunUntil(uint64_t t) {
+  sim_busy++;
+  for (;;) {
+    Sim_Event_t ev = Sim_NextEvent();
+    if (ev == SIM_EV_COUNT || ev_due[ev] > t)
+      break;
+    g_SimNow = ev_due[ev];
+    ev_due[ev] = UINT64_MAX;
+    ev_fn[ev]();
+  }
+  if (t > g_SimNow)
+    g_SimNow = t;
+  sim_busy--;
+}
+
+void Sim_Spend(uint32_t cycles) {
+  Sim_RunUntil(g_SimNow + Sim_CyclesToPs(cycles));
+}
+
+void Sim_Wait(uint64_t ps) { Sim_RunUntil(g_SimNow + ps); }
+
+void Sim_SetRealtime(double speed) {
+  rt_speed = speed;
+  clock_gettime(CLOCK_MONOTONIC, &rt_wall0);
+  rt_sim0 = g_SimNow;
+}
+
+// Holds the host back until wall time has caught up with t
+static void Sim_Pace(uint64_t t) {
+  if (rt_speed <= 0)
+    return;
+  double sim_s = (double)(t - rt_sim0) / SIM_PS_PER_S / rt_speed;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  double wall_s = (now.tv_sec - rt_wall0.tv_sec) +
+                  (now.tv_nsec - rt_wall0.tv_nsec) / 1e9;
+  if (sim_s > wall_s) {
+    // An absolute deadline, as the watchdog timer interrupts every sleep
+    double d = sim_s - wall_s;
+    long ns = now.tv_nsec + (long)((d - (time_t)d) * 1e9);
+    struct timespec until = {now.tv_sec + (time_t)d + ns / 1000000000L,
+                             ns % 1000000000L};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL))
+      ;
+  }
+}
+
+void Sim_Fatal(const char *fmt, ...) {
+  va_list ap;
+  fflush(stdout);
+  fprintf(stderr, "sim: %.6f s: ", (double)g_SimNow / SIM_PS_PER_S);
+  va_start(ap, fmt);
+  vfprintf(stderr, fmt, ap);
+  va_end(ap);
+  fprintf(stderr, " (last call %s)\n", sim_last);
+  fflush(stderr);
+  _exit(3);
+}
+
+// ============================================================================
+// INTERRUPTS
+// ============================================================================
+
+void Sim_Pend(Sim_Irq_t irq) { irq_pending[irq] = 1; }
+
+Sim_Irq_t Sim_CurrentIrq(void) { return cur_irq; }
+
+void Sim_SetDmaHandler(Sim_Irq_t irq, Sim_DmaFn_t fn) { dma_fn[irq] = fn; }
+
+static int Sim_NextIrq(void) {
+  int best = -1;
+  for (int i = 0; i < SIM_IRQ_COUNT; i++) {
+    if (irq_pending[i] && irq_enabled[i] &&
+        (best < 0 || irq_prio[i] < irq_prio[best]))
+      best = i;
+  }
+  return best;
+}
+
+// Takes pending interrupts, one after the other, never nested
+static void Sim_TakeIrqs(void) {
+  int irq;
+  if (sim_busy || primask || in_isr)
+    return;
+  while ((irq = Sim_NextIrq()) >= 0) {
+    irq_pending[irq] = 0;
+    in_isr = 1;
+    cur_irq = (Sim_Irq_t)irq;
+    Sim_Spend(SIM_CYC_IRQ_ENTRY);
+    irq_lines[irq].Handler();
+    cur_irq = SIM_IRQ_COUNT;
+    in_isr = 0;
+  }
+}
+
+void Sim_Enter(const char *what) {
+  sim_busy++;
+  sim_calls++;
+  sim_last = what;
+}
+
+void Sim_Leave(uint32_t cycles) {
+  Sim_Spend(cycles);
+  sim_busy--;
+  Sim_TakeIrqs();
+}
+
+void Sim_LeaveQuiet(uint32_t cycles) {
+  Sim_Spend(cycles);
+  sim_busy--;
+}
+
+// Moves time on to the next event until an interrupt is pending
+static void Sim_Idle(void) {
+  while (Sim_NextIrq() < 0) {
+    Sim_Event_t ev = Sim_NextEvent();
+    if (ev == SIM_EV_COUNT)
+      Sim_Fatal("idle with no event left");
+    Sim_Pace(ev_due[ev]);
+    Sim_RunUntil(ev_due[ev]);
+  }
+}
+
+void __disable_irq(void) {
+  Sim_Enter("__disable_irq");
+  Sim_Leave(SIM_CYC_INTRINSIC); // An interrupt may still come first
+  primask = 1;
+}
+
+void __enable_irq(void) {
+  Sim_Enter("__enable_irq");
+  primask = 0;
+  Sim_Leave(SIM_CYC_INTRINSIC);
+}
+
+uint32_t __get_PRIMASK(void) {
+  Sim_Enter("__get_PRIMASK");
+  Sim_Leave(SIM_CYC_INTRINSIC);
+  return primask;
+}
+
+void __set_PRIMASK(uint32_t v) {
+  Sim_Enter("__set_PRIMASK");
+  primask = v & 1;
+  Sim_Leave(SIM_CYC_INTRINSIC);
+}
+
+void __WFI(void) {
+  Sim_Enter("__WFI");
+  Sim_Idle(); // Wakes on a pending interrupt, masked or not
+  Sim_Leave(SIM_CYC_INTRINSIC);
+}
+
+void __DMB(void) {
+  Sim_Enter("__DMB");
+  Sim_Leave(SIM_CYC_INTRINSIC);
+}
+
+void __DSB(void) {
+  Sim_Enter("__DSB");
+  Sim_Leave(SIM_CYC_INTRINSIC);
+}
+
+void __ISB(void) {
+  Sim_Enter("__ISB");
+  Sim_Leave(SIM_CYC_INTRINSIC);
+}
+
+void __NOP(void) {
+  Sim_Enter("__NOP");
+  Sim_Leave(1);
+}
+
+/*
+ * CPU-time watchdog. A firmware loop that polls memory makes no HAL call,
+ * so simulated time would never move. When no call came in for
+ * SIM_WATCHDOG_US of CPU time, the loop is taken as waiting for an
+ * interrupt: time jumps to the next event and the handler runs here, as
+ * the hardware would have preempted the loop. With interrupts masked,
+ * nothing can ever end it. The check runs on a fine wall-clock timer but
+ * counts thread CPU time, so a loaded host cannot trigger it early. A
+ * virtual machine may still count a stolen slice as CPU time, so a
+ * deadlock is only reported after a much longer silence.
+ */
+#define SIM_WATCHDOG_US 200
+#define SIM_DEADLOCK_MS 500
+
+static uint64_t wd_calls = 0;
+static uint64_t wd_cpu_ns = 0; // CPU time when the call count last moved
+
+static uint64_t Sim_CpuNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void Sim_OnWatchdog(int sig) {
+  (void)sig;
+  uint64_t cpu = Sim_CpuNs();
+  if (sim_calls != wd_calls || sim_busy) {
+    wd_calls = sim_calls;
+    wd_cpu_ns = cpu;
+    return;
+  }
+  if (cpu - wd_cpu_ns < SIM_WATCHDOG_US * 1000ULL)
+    return;
+  if ((primask || in_isr) && cpu - wd_cpu_ns < SIM_DEADLOCK_MS * 1000000ULL)
+    return;
+  if (primask)
+    Sim_Fatal("deadlock: firmware loops with interrupts masked");
+  if (in_isr)
+    Sim_Fatal("deadlock: interrupt handler %d loops", (int)cur_irq);
+  Sim_Enter("(polling loop)");
+  Sim_Idle();
+  Sim_Leave(0);
+  wd_calls = sim_calls;
+  wd_cpu_ns = Sim_CpuNs();
+}
+
+void Sim_StartWatchdog(void) {
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = Sim_OnWatchdog;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGALRM, &sa, NULL);
+
+  wd_calls = sim_calls;
+  wd_cpu_ns = Sim_CpuNs();
+  struct itimerval it = {{0, 50}, {0, 50}};
+  setitimer(ITIMER_REAL, &it, NULL);
+}
+
+// ============================================================================
+// SYSTICK / DWT
+// ============================================================================
+
+static uint64_t tick_start_ps; // Last reload of the down-counter
+static uint64_t dwt_base;
+static uint32_t dwt_last;
+
+static uint64_t Sim_TickPs(void) {
+  return Sim_CyclesToPs(systick_regs.LOAD + 1);
+}
+
+static void Sim_OnSysTick(void) {
+  tick_start_ps = g_SimNow;
+  Sim_Pend(SIM_IRQ_SYSTICK);
+  Sim_Schedule(SIM_EV_SYSTICK, g_SimNow + Sim_TickPs(), Sim_OnSysTick);
+}
+
+// HAL_InitTick: 1ms at the current core clock
+static void Sim_InitTick(void) {
+  systick_regs.LOAD = core_hz / 1000 - 1;
+  systick_regs.CTRL = 7;
+  tick_start_ps = g_SimNow;
+  irq_enabled[SIM_IRQ_SYSTICK] = 1;
+  irq_prio[SIM_IRQ_SYSTICK] = TICK_INT_PRIORITY;
+  Sim_Schedule(SIM_EV_SYSTICK, g_SimNow + Sim_TickPs(), Sim_OnSysTick);
+}
+
+SysTick_Type *Sim_SysTickRegs(void) {
+  Sim_Enter("SysTick");
+  Sim_Leave(SIM_CYC_REG);
+  uint64_t cyc = (uint64_t)((unsigned __int128)(g_SimNow - tick_start_ps) *
+                            core_hz / SIM_PS_PER_S);
+  uint32_t reload = systick_regs.LOAD + 1;
+  systick_regs.VAL = systick_regs.LOAD - (uint32_t)(cyc % reload);
+  return &systick_regs;
+}
+
+// A CYCCNT the firmware wrote is picked up on the next access
+DWT_Type *Sim_DwtRegs(void) {
+  Sim_Enter("DWT");
+  Sim_Leave(SIM_CYC_REG);
+  uint64_t cyc = Sim_Cycles();
+  if (dwt_regs.CYCCNT != dwt_last)
+    dwt_base = cyc - dwt_regs.CYCCNT;
+  if ((dwt_regs.CTRL & DWT_CTRL_CYCCNTENA_Msk) &&
+      (Sim_CoreDebug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk))
+    dwt_regs.CYCCNT = (uint32_t)(cyc - dwt_base);
+  else
+    dwt_base = cyc - dwt_regs.CYCCNT; // Stopped
+  dwt_last = dwt_regs.CYCCNT;
+  return &dwt_regs;
+}
+
+// ============================================================================
+// HAL BASE / NVIC
+// ============================================================================
+
+HAL_StatusTypeDef HAL_Init(void) {
+  Sim_Enter("HAL_Init");
+  Sim_InitTick();
+  Sim_Leave(SIM_CYC_INIT);
+  return HAL_OK;
+}
+
+void HAL_IncTick(void) {
+  Sim_Enter("HAL_IncTick");
+  uwTick++;
+  Sim_Leave(SIM_CYC_INTRINSIC);
+}
+
+uint32_t HAL_GetTick(void) {
+  Sim_Enter("HAL_GetTick");
+  Sim_Leave(SIM_CYC_INTRINSIC);
+  return uwTick;
+}
+
+void HAL_Delay(uint32_t ms) {
+  uint32_t start = HAL_GetTick();
+  while (HAL_GetTick() - start < ms + 1)
+    __WFI();
+}
+
+static int Sim_IrqOf(IRQn_Type irqn) {
+  for (int i = 0; i < SIM_IRQ_COUNT; i++) {
+    if (irq_lines[i].Irqn == irqn)
+      return i;
+  }
+  return -1;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preempt, uint32_t sub) {
+  Sim_Enter("HAL_NVIC_SetPriority");
+  int i = Sim_IrqOf(irq);
+  if (i >= 0)
+    irq_prio[i] = (uint8_t)(preempt * 16 + sub);
+  Sim_Leave(SIM_CYC_HAL);
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type irq) {
+  Sim_Enter("HAL_NVIC_EnableIRQ");
+  int i = Sim_IrqOf(irq);
+  if (i >= 0)
+    irq_enabled[i] = 1;
+  Sim_Leave(SIM_CYC_HAL);
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type irq) {
+  Sim_Enter("HAL_NVIC_DisableIRQ");
+  int i = Sim_IrqOf(irq);
+  if (i >= 0)
+    irq_enabled[i] = 0;
+  Sim_Leave(SIM_CYC_HAL);
+}
+
+// ============================================================================
+// RCC
+// ============================================================================
+
+static uint8_t hse_fails = 0;
+static RCC_PLLInitTypeDef pll_cfg;
+
+void Sim_SetHseFails(uint8_t fails) { hse_fails = fails; }
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *osc) {
+  HAL_StatusTypeDef status = HAL_OK;
+  Sim_Enter("HAL_RCC_OscConfig");
+  if ((osc->OscillatorType & RCC_OSCILLATORTYPE_HSE) && hse_fails) {
+    Sim_Wait(100 * SIM_PS_PER_MS); // HSE_STARTUP_TIMEOUT
+    status = HAL_TIMEOUT;
+  } else if (osc->PLL.PLLState == RCC_PLL_ON) {
+    pll_cfg = osc->PLL;
+  }
+  Sim_Leave(SIM_CYC_INIT);
+  return status;
+}
+
+static uint32_t Sim_AhbDiv(uint32_t div) {
+  switch (div) {
+  case RCC_SYSCLK_DIV2:
+    return 2;
+  case RCC_SYSCLK_DIV4:
+    return 4;
+  default:
+    return 1;
+  }
+}
+
+static uint32_t Sim_ApbDiv(uint32_t div) {
+  switch (div) {
+  case RCC_HCLK_DIV2:
+    return 2;
+  case RCC_HCLK_DIV4:
+    return 4;
+  default:
+    return 1;
+  }
+}
+
+static uint32_t sysclk_hz = HSI_VALUE;
+
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *clk,
+                                      uint32_t latency) {
+  (void)latency;
+  Sim_Enter("HAL_RCC_ClockConfig");
+  switch (clk->SYSCLKSource) {
+  case RCC_SYSCLKSOURCE_PLLCLK: {
+    uint32_t src = (pll_cfg.PLLSource == RCC_PLLSOURCE_HSE) ? HSE_VALUE
+                                                            : HSI_VALUE;
+    sysclk_hz = (uint32_t)((uint64_t)src / pll_cfg.PLLM * pll_cfg.PLLN /
+                           pll_cfg.PLLP);
+    break;
+  }
+  case RCC_SYSCLKSOURCE_HSE:
+    sysclk_hz = HSE_VALUE;
+    break;
+  default:
+    sysclk_hz = HSI_VALUE;
+    break;
+  }
+  uint32_t hclk = sysclk_hz / Sim_AhbDiv(clk->AHBCLKDivider);
+  pclk1_hz = hclk / Sim_ApbDiv(clk->APB1CLKDivider);
+  pclk2_hz = hclk / Sim_ApbDiv(clk->APB2CLKDivider);
+  Sim_SetCoreHz(hclk);
+  Sim_InitTick();
+  Sim_Leave(SIM_CYC_INIT);
+  return HAL_OK;
+}
+
+uint32_t HAL_RCC_GetSysClockFreq(void) { return sysclk_hz; }
+uint32_t HAL_RCC_GetHCLKFreq(void) { return core_hz; }
+uint32_t HAL_RCC_GetPCLK1Freq(void) { return pclk1_hz; }
+uint32_t HAL_RCC_GetPCLK2Freq(void) { return pclk2_hz; }
+
+// ============================================================================
+// GPIO
+// ============================================================================
+
+// Pins not configured as outputs float high (pull-ups on every CS line)
+static uint16_t Sim_GpioOutMask(const GPIO_TypeDef *port) {
+  uint16_t mask = 0;
+  for (int i = 0; i < 16; i++) {
+    uint32_t mode = (port->MODER >> (2 * i)) & 3;
+    if (mode == GPIO_MODE_OUTPUT_PP || mode == GPIO_MODE_AF_PP)
+      mask |= 1 << i;
+  }
+  return mask;
+}
+
+uint8_t Sim_GpioLevel(GPIO_TypeDef *port, uint16_t pin) {
+  uint16_t out = Sim_GpioOutMask(port);
+  uint32_t level = (out & pin) ? port->ODR : port->IDR;
+  return (level & pin) ? 1 : 0;
+}
+
+void Sim_GpioWrite(GPIO_TypeDef *port, uint16_t pins, uint8_t level) {
+  Sim_Enter("GPIO_FAST");
+  uint32_t old = port->ODR;
+  port->ODR = level ? (old | pins) : (old & ~(uint32_t)pins);
+  if (port->ODR != old)
+    Sim_SpiCsChanged();
+  Sim_Leave(SIM_CYC_GPIO_FAST);
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init) {
+  Sim_Enter("HAL_GPIO_Init");
+  for (int i = 0; i < 16; i++) {
+    if (!(init->Pin & (1 << i)))
+      continue;
+    port->MODER = (port->MODER & ~(3UL << (2 * i))) |
+                  ((init->Mode & 3) << (2 * i));
+    port->PUPDR = (port->PUPDR & ~(3UL << (2 * i))) |
+                  ((init->Pull & 3) << (2 * i));
+  }
+  Sim_SpiCsChanged();
+  Sim_Leave(SIM_CYC_INIT);
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state) {
+  Sim_Enter("HAL_GPIO_WritePin");
+  uint32_t old = port->ODR;
+  port->ODR = (state == GPIO_PIN_SET) ? (old | pin) : (old & ~(uint32_t)pin);
+  if (port->ODR != old)
+    Sim_SpiCsChanged();
+  Sim_Leave(SIM_CYC_GPIO);
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin) {
+  Sim_Enter("HAL_GPIO_ReadPin");
+  GPIO_PinState state = Sim_GpioLevel(port, pin) ? GPIO_PIN_SET
+                                                 : GPIO_PIN_RESET;
+  Sim_Leave(SIM_CYC_GPIO);
+  return state;
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *port, uint16_t pin) {
+  HAL_GPIO_WritePin(port, pin,
+                    (port->ODR & pin) ? GPIO_PIN_RESET : GPIO_PIN_SET);
+}
+
+// The user key (PA0) reads low while pressed
+void Sim_SetKey(uint8_t pressed) {
+  if (pressed)
+    Sim_GpioA.IDR &= ~(uint32_t)GPIO_PIN_0;
+  else
+    Sim_GpioA.IDR |= GPIO_PIN_0;
+}
+
+// ============================================================================
+// TIMERS
+// ============================================================================
+// Up-counting 32-bit timers without preload, as TIM2 / TIM5 are set up.
+// The counter is derived from the time it last passed 0.
+
+#define TIM_UIF 0x0001
+
+typedef struct {
+  TIM_TypeDef *Regs;
+  TIM_HandleTypeDef *Handle;
+  Sim_Event_t Ev;
+  Sim_Irq_t Irq;
+  uint8_t Running;
+  uint64_t ZeroPs;  // Running: when CNT was 0
+  uint32_t Stopped; // Stopped: CNT
+} Sim_Tim_t;
+
+static void Sim_OnTim2(void);
+static void Sim_OnTim5(void);
+
+static Sim_Tim_t tims[2] = {
+    {&Sim_Tim2, NULL, SIM_EV_TIM2, SIM_IRQ_TIM2, 0, 0, 0},
+    {&Sim_Tim5, NULL, SIM_EV_TIM5, SIM_IRQ_TIM5, 0, 0, 0},
+};
+
+static Sim_Tim_t *Sim_TimOf(TIM_TypeDef *regs) {
+  return (regs == TIM2) ? &tims[0] : &tims[1];
+}
+
+// APB1 timers run at twice PCLK1 when APB1 is divided
+static uint64_t Sim_TimTickPs(const Sim_Tim_t *t) {
+  uint32_t clk = pclk1_hz;
+  if (clk != core_hz)
+    clk *= 2;
+  return ((uint64_t)t->Regs->PSC + 1) * SIM_PS_PER_S / clk;
+}
+
+static uint32_t Sim_TimCount(const Sim_Tim_t *t) {
+  if (!t->Running)
+    return t->Stopped;
+  return (uint32_t)((g_SimNow - t->ZeroPs) / Sim_TimTickPs(t));
+}
+
+// Next update event. An ARR below the count lets the counter run round
+static void Sim_TimReschedule(Sim_Tim_t *t) {
+  if (!t->Running) {
+    Sim_Cancel(t->Ev);
+    return;
+  }
+  uint64_t tick = Sim_TimTickPs(t);
+  uint64_t period = ((uint64_t)t->Regs->ARR + 1) * tick;
+  if (t->ZeroPs + period <= g_SimNow)
+    period = (1ULL << 32) * tick;
+  Sim_Schedule(t->Ev, t->ZeroPs + period,
+               (t == &tims[0]) ? Sim_OnTim2 : Sim_OnTim5);
+}
+
+static void Sim_TimUpdate(Sim_Tim_t *t) {
+  t->ZeroPs = g_SimNow;
+  t->Regs->SR |= TIM_UIF;
+  Sim_Pend(t->Irq);
+  Sim_TimReschedule(t);
+}
+
+static void Sim_OnTim2(void) { Sim_TimUpdate(&tims[0]); }
+static void Sim_OnTim5(void) { Sim_TimUpdate(&tims[1]); }
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim) {
+  Sim_Enter("HAL_TIM_Base_Init");
+  Sim_Tim_t *t = Sim_TimOf(htim->Instance);
+  t->Handle = htim;
+  t->Regs->PSC = htim->Init.Prescaler;
+  t->Regs->ARR = htim->Init.Period;
+  t->Stopped = 0;
+  Sim_TimReschedule(t);
+  Sim_Leave(SIM_CYC_INIT);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim) {
+  Sim_Enter("HAL_TIM_Base_Start_IT");
+  Sim_Tim_t *t = Sim_TimOf(htim->Instance);
+  if (!t->Running) {
+    t->ZeroPs = g_SimNow - (uint64_t)t->Stopped * Sim_TimTickPs(t);
+    t->Running = 1;
+  }
+  t->Regs->DIER |= TIM_UIF;
+  Sim_TimReschedule(t);
+  Sim_Leave(SIM_CYC_HAL);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim) {
+  Sim_Enter("HAL_TIM_Base_Stop_IT");
+  Sim_Tim_t *t = Sim_TimOf(htim->Instance);
+  t->Stopped = Sim_TimCount(t);
+  t->Running = 0;
+  t->Regs->DIER &= ~TIM_UIF;
+  Sim_TimReschedule(t);
+  Sim_Leave(SIM_CYC_HAL);
+  return HAL_OK;
+}
+
+void Sim_TimSetAutoreload(TIM_HandleTypeDef *htim, uint32_t arr) {
+  Sim_Enter("__HAL_TIM_SET_AUTORELOAD");
+  Sim_Tim_t *t = Sim_TimOf(htim->Instance);
+  htim->Init.Period = arr;
+  t->Regs->ARR = arr;
+  Sim_TimReschedule(t);
+  Sim_Leave(SIM_CYC_INTRINSIC);
+}
+
+void Sim_TimSetCounter(TIM_HandleTypeDef *htim, uint32_t cnt) {
+  Sim_Enter("__HAL_TIM_SET_COUNTER");
+  Sim_Tim_t *t = Sim_TimOf(htim->Instance);
+  if (t->Running)
+    t->ZeroPs = g_SimNow - (uint64_t)cnt * Sim_TimTickPs(t);
+  else
+    t->Stopped = cnt;
+  Sim_TimReschedule(t);
+  Sim_Leave(SIM_CYC_INTRINSIC);
+}
+
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim) {
+  Sim_Enter("HAL_TIM_IRQHandler");
+  uint8_t update = (htim->Instance->SR & TIM_UIF) &&
+                   (htim->Instance->DIER & TIM_UIF);
+  htim->Instance->SR &= ~TIM_UIF;
+  Sim_Leave(SIM_CYC_IRQ_HAL);
+  if (update)
+    HAL_TIM_PeriodElapsedCallback(htim);
+}
+
+// ============================================================================
+// DMA
+// ============================================================================
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma) {
+  Sim_Enter("HAL_DMA_Init");
+  Sim_Leave(SIM_CYC_INIT);
+  (void)hdma;
+  return HAL_OK;
+}
+
+// The stream is known from the interrupt being handled
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma) {
+  (void)hdma;
+  Sim_Enter("HAL_DMA_IRQHandler");
+  Sim_Leave(SIM_CYC_IRQ_HAL);
+  if (cur_irq < SIM_IRQ_COUNT && dma_fn[cur_irq] != NULL)
+    dma_fn[cur_irq]();
+}
+
+// ============================================================================
+// POWER-ON
+// ============================================================================
+
+void Sim_Init(void) {
+  for (int i = 0; i < SIM_EV_COUNT; i++)
+    ev_due[i] = UINT64_MAX;
+  Sim_GpioA.IDR = Sim_GpioB.IDR = Sim_GpioC.IDR = 0xFFFF;
+  Sim_SpiInit();
+  Sim_FlashInit();
+  Sim_ExpInit();
+  Sim_UartInit();
+}
@@ -0,0 +1,120 @@
+/*
+ * sim_main.c
+ *
+ *  Created on: Apr 16, 2026
+ *      Author: BioFET Team
+ *
+ *  biofet_sim [options] [bench]
+ *
+ *  Without a bench the firmware runs interactively: its UART is a pseudo
+ *  terminal (the path is printed) that biofet_gui.py or a terminal can
+ *  open, and simulated time follows the wall clock. Ctrl-C saves the
+ *  flash image (--flash) and prints the bus counters.
+ */
+
+#include "sim.h"
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+static volatile sig_atomic_t stop_requested = 0;
+static const char *flash_image = NULL;
+
+static void Sim_OnSigint(int sig) {
+  (void)sig;
+  stop_requested = 1;
+}
+
+static void Sim_Usage(FILE *f) {
+  fprintf(f,
+          "usage: biofet_sim [options] [bench|list]\n"
+          "  --flash FILE   flash image, loaded if present, saved at exit\n"
+          "  --fast         interactive mode without realtime pacing\n"
+          "  --hse-fail     crystal does not start (HSI fallback)\n"
+          "  --key          user key held at boot (offline auto-start)\n"
+          "  --baud N       offload baud rate of the benches (SET_BAUD)\n"
+          "  --run-ms N     logging time of the run bench (default 2000)\n"
+          "  --rate N       sample rate of the run bench (default 100)\n"
+          "benches:\n");
+  Sim_BenchList(f);
+}
+
+// Interactive link: host bytes in, Ctrl-C out, every simulated 1ms
+static void Sim_OnHost(void) {
+  if (stop_requested) {
+    Sim_Report(stdout);
+    if (flash_image != NULL && Sim_FlashSave(flash_image) != 0)
+      fprintf(stderr, "sim: cannot save %s\n", flash_image);
+    fflush(stdout);
+    exit(0);
+  }
+  Sim_UartPollPty();
+  Sim_Schedule(SIM_EV_HOST, g_SimNow + SIM_PS_PER_MS, Sim_OnHost);
+}
+
+int main(int argc, char **argv) {
+  Sim_BenchOpts_t opts = {NULL, 0, 2000, 100};
+  const char *bench = NULL;
+  int fast = 0;
+
+  Sim_Init();
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+    if (strcmp(a, "--flash") == 0 && v != NULL) {
+      opts.FlashImage = v;
+      i++;
+    } else if (strcmp(a, "--fast") == 0) {
+      fast = 1;
+    } else if (strcmp(a, "--hse-fail") == 0) {
+      Sim_SetHseFails(1);
+    } else if (strcmp(a, "--key") == 0) {
+      Sim_SetKey(1);
+    } else if (strcmp(a, "--baud") == 0 && v != NULL) {
+      opts.Baud = strtoul(v, NULL, 10);
+      i++;
+    } else if (strcmp(a, "--run-ms") == 0 && v != NULL) {
+      opts.RunMs = strtoul(v, NULL, 10);
+      i++;
+    } else if (strcmp(a, "--rate") == 0 && v != NULL) {
+      opts.RateHz = strtoul(v, NULL, 10);
+      i++;
+    } else if (strcmp(a, "list") == 0) {
+      Sim_Usage(stdout);
+      return 0;
+    } else if (a[0] != '-' && bench == NULL) {
+      bench = a;
+    } else {
+      Sim_Usage(stderr);
+      return 2;
+    }
+  }
+  if (opts.RunMs == 0 || opts.RateHz == 0 || opts.RateHz > 1000) {
+    Sim_Usage(stderr);
+    return 2;
+  }
+
+  // A missing image is a blank chip, created at exit
+  flash_image = opts.FlashImage;
+  if (flash_image != NULL && Sim_FlashLoad(flash_image) != 0)
+    fprintf(stderr, "sim: %s not loaded, starting with a blank chip\n",
+            flash_image);
+
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  if (bench != NULL)
+    return Sim_Bench(bench, &opts);
+
+  char pty[64];
+  if (Sim_UartOpenPty(pty, sizeof(pty)) != 0) {
+    perror("sim: pty");
+    return 1;
+  }
+  printf("BioFET simulator, UART on %s (Ctrl-C to stop)\n", pty);
+  signal(SIGINT, Sim_OnSigint);
+  if (!fast)
+    Sim_SetRealtime(1.0);
+  Sim_Schedule(SIM_EV_HOST, g_SimNow + SIM_PS_PER_MS, Sim_OnHost);
+  Sim_StartWatchdog();
+  Firmware_Main();
+  return 1; // The firmware main loop does not return
+}
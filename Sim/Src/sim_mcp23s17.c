@@ -0,0 +1,150 @@
+/*
+ * sim_mcp23s17.c
+ *
+ *  Created on: Apr 16, 2026
+ *      Author: BioFET Team
+ *
+ *  MCP23S17 model, IOCON.BANK = 0 register map. Frames are opcode,
+ *  register, data...; the register pointer advances after each data byte,
+ *  running 0x15 -> 0x00 in sequential mode or toggling inside the A/B pair
+ *  with SEQOP set. Hardware addresses only count once HAEN is set.
+ *
+ *  With EXP_SHARED_CS all three chips sit on the EXP1 line at addresses
+ *  0, 1 and 2; otherwise each has its own line and address 0.
+ */
+
+#include "sim.h"
+#include "main.h"
+#include "mcp23s17.h"
+#include <string.h>
+
+#define MCP_REG_COUNT 0x16
+#define MCP_IOCON_B 0x0B
+#define MCP_IOCON_SEQOP 0x20
+
+typedef struct {
+  uint8_t Line;   // CS line (0 = EXP1)
+  uint8_t HwAddr; // A2..A0 strapping
+  uint8_t Regs[MCP_REG_COUNT];
+  uint8_t Selected;
+  uint8_t Index;  // Bytes seen in the current frame
+  uint8_t Active; // Frame addressed to this chip
+  uint8_t Read;
+  uint8_t Pointer;
+  Sim_ExpStats_t Stats;
+} Sim_Exp_t;
+
+static Sim_Exp_t exps[SIM_EXPANDERS];
+
+void Sim_ExpInit(void) {
+  memset(exps, 0, sizeof(exps));
+  for (uint8_t i = 0; i < SIM_EXPANDERS; i++) {
+#if EXP_SHARED_CS
+    exps[i].Line = 0;
+    exps[i].HwAddr = i;
+#else
+    exps[i].Line = i;
+    exps[i].HwAddr = 0;
+#endif
+    exps[i].Regs[MCP_IODIRA] = 0xFF;
+    exps[i].Regs[MCP_IODIRB] = 0xFF;
+  }
+}
+
+void Sim_ExpSelect(uint8_t cs_line, uint8_t selected) {
+  for (uint8_t i = 0; i < SIM_EXPANDERS; i++) {
+    Sim_Exp_t *e = &exps[i];
+    if (e->Line != cs_line)
+      continue;
+    if (e->Selected && !selected && e->Index >= 2) {
+      if (e->Active)
+        e->Stats.Frames++;
+      else
+        e->Stats.Ignored++;
+    }
+    e->Selected = selected;
+    e->Index = 0;
+    e->Active = 0;
+  }
+}
+
+static uint8_t Sim_ExpReadReg(const Sim_Exp_t *e, uint8_t reg) {
+  if (reg == MCP_GPIOA || reg == MCP_GPIOB) {
+    // Outputs read back their latch, inputs float high
+    uint8_t port = reg - MCP_GPIOA;
+    uint8_t dir = e->Regs[MCP_IODIRA + port];
+    return (e->Regs[MCP_OLATA + port] & ~dir) | dir;
+  }
+  if (reg == MCP_IOCON_B)
+    reg = MCP_IOCON;
+  return e->Regs[reg];
+}
+
+static void Sim_ExpWriteReg(Sim_Exp_t *e, uint8_t reg, uint8_t val) {
+  e->Stats.RegWrites++;
+  if (reg == MCP_IOCON || reg == MCP_IOCON_B)
+    reg = MCP_IOCON;
+  else if (reg == MCP_GPIOA || reg == MCP_GPIOB)
+    reg += MCP_OLATA - MCP_GPIOA; // GPIO writes go to the latch
+  else if (reg >= 0x0E && reg <= 0x11)
+    return; // INTF / INTCAP are read-only
+  e->Regs[reg] = val;
+  Sim_SpiCsChanged(); // The latch may drive a chip select
+}
+
+static void Sim_ExpAdvance(Sim_Exp_t *e) {
+  if (e->Regs[MCP_IOCON] & MCP_IOCON_SEQOP)
+    e->Pointer ^= 1;
+  else
+    e->Pointer = (e->Pointer + 1) % MCP_REG_COUNT;
+}
+
+static uint8_t Sim_ExpChipByte(Sim_Exp_t *e, uint8_t out) {
+  uint8_t i = e->Index;
+  if (e->Index < 0xFF)
+    e->Index++;
+
+  if (i == 0) {
+    uint8_t haen = e->Regs[MCP_IOCON] & MCP_IOCON_HAEN;
+    uint8_t addr = haen ? e->HwAddr : 0;
+    e->Active = ((out & 0xFE) == (MCP_BASE_ADDR | (addr << 1)));
+    e->Read = out & 1;
+    return 0xFF;
+  }
+  if (!e->Active)
+    return 0xFF;
+  if (i == 1) {
+    e->Pointer = out % MCP_REG_COUNT;
+    return 0xFF;
+  }
+
+  uint8_t in = 0xFF;
+  if (e->Read)
+    in = Sim_ExpReadReg(e, e->Pointer);
+  else
+    Sim_ExpWriteReg(e, e->Pointer, out);
+  Sim_ExpAdvance(e);
+  return in;
+}
+
+uint8_t Sim_ExpByte(uint8_t cs_line, uint8_t out) {
+  uint8_t in = 0xFF;
+  for (uint8_t i = 0; i < SIM_EXPANDERS; i++) {
+    if (exps[i].Line == cs_line && exps[i].Selected)
+      in &= Sim_ExpChipByte(&exps[i], out);
+  }
+  return in;
+}
+
+uint16_t Sim_ExpPins(uint8_t exp) {
+  const Sim_Exp_t *e = &exps[exp];
+  return (uint16_t)(Sim_ExpReadReg(e, MCP_GPIOB) << 8) |
+         Sim_ExpReadReg(e, MCP_GPIOA);
+}
+
+uint16_t Sim_ExpOutputs(uint8_t exp) {
+  const Sim_Exp_t *e = &exps[exp];
+  return (uint16_t)~((e->Regs[MCP_IODIRB] << 8) | e->Regs[MCP_IODIRA]);
+}
+
+const Sim_ExpStats_t *Sim_ExpStats(uint8_t exp) { return &exps[exp].Stats; }
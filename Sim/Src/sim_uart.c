@@ -0,0 +1,281 @@
+/*
+ * sim_uart.c
+ *
+ *  Created on: Apr 16, 2026
+ *      Author: BioFET Team
+ *
+ *  USART1 with its two DMA streams, 8N1 at the configured baud rate.
+ *
+ *  TX: the buffer goes out in one DMA transfer; the bytes reach the sink
+ *  when the last stop bit would be sent, then TC raises USART1.
+ *  RX: circular DMA into the ring ReceiveToIdle_DMA was given, one byte
+ *  per character time from the host FIFO, with the half / full transfer
+ *  events on DMA2 stream 2 and IDLE one character after the line goes
+ *  quiet, as HAL_UARTEx_RxEventCallback reports them on the part.
+ */
+
+#define _GNU_SOURCE // posix_openpt, cfmakeraw
+#include "sim.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define SIM_UART_FIFO_SIZE 65536
+#define SIM_UART_TX_MAX 65536
+
+#define UART_FLAG_TC 0x40
+#define UART_FLAG_IDLE 0x10
+
+Sim_UartStats_t g_SimUart;
+USART_TypeDef Sim_Usart1;
+
+static UART_HandleTypeDef *uart = NULL;
+static Sim_UartSink_t sink = NULL;
+
+static uint8_t tx_buf[SIM_UART_TX_MAX];
+static uint16_t tx_len;
+
+static uint8_t fifo[SIM_UART_FIFO_SIZE];
+static uint32_t fifo_head, fifo_tail;
+
+static uint8_t *rx_buf;
+static uint16_t rx_size;
+static uint16_t rx_pos;
+static uint8_t rx_half, rx_full; // DMA2 stream 2 flags not yet handled
+
+static int pty_fd = -1;
+static int pty_slave = -1;
+
+static uint64_t Sim_UartCharPs(void) {
+  uint32_t baud = (uart != NULL) ? uart->Init.BaudRate : 115200;
+  return 10 * SIM_PS_PER_S / baud; // Start, 8 data, stop
+}
+
+// ============================================================================
+// HOST SIDE
+// ============================================================================
+
+void Sim_UartSetSink(Sim_UartSink_t fn) { sink = fn; }
+
+uint32_t Sim_UartPending(void) { return fifo_head - fifo_tail; }
+
+static void Sim_UartOnRx(void);
+
+static void Sim_UartKick(void) {
+  if (uart == NULL || uart->RxState != HAL_UART_STATE_BUSY_RX)
+    return;
+  if (Sim_UartPending() > 0 && Sim_Due(SIM_EV_UART_RX) == UINT64_MAX) {
+    Sim_Cancel(SIM_EV_UART_IDLE);
+    Sim_Schedule(SIM_EV_UART_RX, g_SimNow + Sim_UartCharPs(), Sim_UartOnRx);
+  }
+}
+
+void Sim_UartInject(const void *data, uint32_t len) {
+  const uint8_t *p = data;
+  for (uint32_t i = 0; i < len; i++) {
+    if (Sim_UartPending() >= SIM_UART_FIFO_SIZE)
+      Sim_Fatal("UART host FIFO full");
+    fifo[fifo_head++ % SIM_UART_FIFO_SIZE] = p[i];
+  }
+  Sim_UartKick();
+}
+
+static void Sim_UartPtySink(const uint8_t *data, uint32_t len) {
+  while (len > 0) {
+    ssize_t n = write(pty_fd, data, len);
+    if (n < 0 && errno == EAGAIN) {
+      usleep(1000); // Host terminal behind: hold the board back
+      continue;
+    }
+    if (n <= 0)
+      return; // Nobody attached any more
+    data += n;
+    len -= n;
+  }
+}
+
+int Sim_UartOpenPty(char *name, size_t size) {
+  pty_fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (pty_fd < 0 || grantpt(pty_fd) != 0 || unlockpt(pty_fd) != 0)
+    return -1;
+  const char *path = ptsname(pty_fd);
+  if (path == NULL)
+    return -1;
+  snprintf(name, size, "%s", path);
+
+  // Kept open so the master never sees a hang-up between two clients
+  pty_slave = open(path, O_RDWR | O_NOCTTY);
+  if (pty_slave >= 0) {
+    struct termios t;
+    tcgetattr(pty_slave, &t);
+    cfmakeraw(&t);
+    tcsetattr(pty_slave, TCSANOW, &t);
+  }
+  fcntl(pty_fd, F_SETFL, fcntl(pty_fd, F_GETFL) | O_NONBLOCK);
+  sink = Sim_UartPtySink;
+  return 0;
+}
+
+void Sim_UartPollPty(void) {
+  uint8_t buf[256];
+  ssize_t n;
+  if (pty_fd < 0)
+    return;
+  while ((n = read(pty_fd, buf, sizeof(buf))) > 0)
+    Sim_UartInject(buf, (uint32_t)n);
+}
+
+// ============================================================================
+// LINE EVENTS
+// ============================================================================
+
+static void Sim_UartOnTx(void) {
+  g_SimUart.TxBytes += tx_len;
+  if (sink != NULL)
+    sink(tx_buf, tx_len);
+  Sim_Usart1.SR |= UART_FLAG_TC;
+  Sim_Pend(SIM_IRQ_USART1);
+}
+
+static void Sim_UartOnIdle(void) {
+  Sim_Usart1.SR |= UART_FLAG_IDLE;
+  Sim_Pend(SIM_IRQ_USART1);
+}
+
+static void Sim_UartOnRx(void) {
+  if (uart == NULL || uart->RxState != HAL_UART_STATE_BUSY_RX ||
+      Sim_UartPending() == 0)
+    return;
+  rx_buf[rx_pos++] = fifo[fifo_tail++ % SIM_UART_FIFO_SIZE];
+  g_SimUart.RxBytes++;
+  if (rx_pos == rx_size / 2) {
+    rx_half = 1;
+    Sim_Pend(SIM_IRQ_DMA2_S2);
+  } else if (rx_pos == rx_size) {
+    rx_full = 1;
+    rx_pos = 0; // Circular
+    Sim_Pend(SIM_IRQ_DMA2_S2);
+  }
+  if (Sim_UartPending() > 0)
+    Sim_Schedule(SIM_EV_UART_RX, g_SimNow + Sim_UartCharPs(), Sim_UartOnRx);
+  else
+    Sim_Schedule(SIM_EV_UART_IDLE, g_SimNow + Sim_UartCharPs(),
+                 Sim_UartOnIdle);
+}
+
+// DMA2 stream 2: half and full transfer of the receive ring
+static void Sim_UartRxDmaIrq(void) {
+  if (uart == NULL || uart->RxState != HAL_UART_STATE_BUSY_RX) {
+    rx_half = rx_full = 0;
+    return;
+  }
+  if (rx_half) {
+    rx_half = 0;
+    HAL_UARTEx_RxEventCallback(uart, rx_size / 2);
+  }
+  if (rx_full) {
+    rx_full = 0;
+    HAL_UARTEx_RxEventCallback(uart, rx_size);
+  }
+}
+
+void Sim_UartInit(void) {
+  memset(&g_SimUart, 0, sizeof(g_SimUart));
+  memset(&Sim_Usart1, 0, sizeof(Sim_Usart1));
+  uart = NULL;
+  fifo_head = fifo_tail = 0;
+  rx_half = rx_full = 0;
+  Sim_SetDmaHandler(SIM_IRQ_DMA2_S2, Sim_UartRxDmaIrq);
+}
+
+// ============================================================================
+// HAL UART
+// ============================================================================
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart) {
+  Sim_Enter("HAL_UART_Init");
+  if (huart->Init.BaudRate == 0) {
+    Sim_Leave(SIM_CYC_INIT);
+    return HAL_ERROR;
+  }
+  uart = huart;
+  huart->gState = HAL_UART_STATE_READY;
+  huart->RxState = HAL_UART_STATE_READY;
+  huart->ErrorCode = 0;
+  Sim_Leave(SIM_CYC_INIT);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart,
+                                        const uint8_t *pData, uint16_t Size) {
+  Sim_Enter("HAL_UART_Transmit_DMA");
+  if (huart->gState != HAL_UART_STATE_READY || Size == 0) {
+    Sim_Leave(SIM_CYC_HAL);
+    return (Size == 0) ? HAL_ERROR : HAL_BUSY;
+  }
+  memcpy(tx_buf, pData, Size);
+  tx_len = Size;
+  huart->pTxBuffPtr = pData;
+  huart->TxXferSize = Size;
+  huart->gState = HAL_UART_STATE_BUSY_TX;
+  Sim_Usart1.SR &= ~UART_FLAG_TC;
+  Sim_Schedule(SIM_EV_UART_TX,
+               g_SimNow + Sim_CyclesToPs(SIM_CYC_DMA_START) +
+                   Size * Sim_UartCharPs(),
+               Sim_UartOnTx);
+  Sim_Leave(SIM_CYC_DMA_START);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart,
+                                               uint8_t *pData, uint16_t Size) {
+  Sim_Enter("HAL_UARTEx_ReceiveToIdle_DMA");
+  if (huart->RxState != HAL_UART_STATE_READY || Size == 0) {
+    Sim_Leave(SIM_CYC_HAL);
+    return (Size == 0) ? HAL_ERROR : HAL_BUSY;
+  }
+  huart->pRxBuffPtr = pData;
+  huart->RxXferSize = Size;
+  huart->RxState = HAL_UART_STATE_BUSY_RX;
+  rx_buf = pData;
+  rx_size = Size;
+  rx_pos = 0;
+  rx_half = rx_full = 0;
+  Sim_UartKick();
+  Sim_Leave(SIM_CYC_DMA_START);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart) {
+  Sim_Enter("HAL_UART_AbortReceive");
+  huart->RxState = HAL_UART_STATE_READY;
+  Sim_Cancel(SIM_EV_UART_RX);
+  Sim_Cancel(SIM_EV_UART_IDLE);
+  Sim_Usart1.SR &= ~UART_FLAG_IDLE;
+  rx_half = rx_full = 0;
+  Sim_Leave(SIM_CYC_HAL);
+  return HAL_OK;
+}
+
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart) {
+  Sim_Enter("HAL_UART_IRQHandler");
+  uint32_t sr = Sim_Usart1.SR;
+  Sim_Usart1.SR &= ~(UART_FLAG_TC | UART_FLAG_IDLE);
+  uint8_t tx_done = (sr & UART_FLAG_TC) &&
+                    huart->gState == HAL_UART_STATE_BUSY_TX;
+  if (tx_done)
+    huart->gState = HAL_UART_STATE_READY;
+  uint8_t idle = (sr & UART_FLAG_IDLE) &&
+                 huart->RxState == HAL_UART_STATE_BUSY_RX;
+  uint16_t pos = rx_pos;
+  Sim_Leave(SIM_CYC_IRQ_HAL);
+
+  // Nothing new since the last wrap: the HAL reports no event
+  if (idle && pos != 0)
+    HAL_UARTEx_RxEventCallback(huart, pos);
+  if (tx_done)
+    HAL_UART_TxCpltCallback(huart);
+}
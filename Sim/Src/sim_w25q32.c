@@ -0,0 +1,230 @@
+/*
+ * sim_w25q32.c
+ *
+ *  Created on: Apr 16, 2026
+ *      Author: BioFET Team
+ *
+ *  W25Q32JV model: the commands w25q32.c uses, WEL / BUSY with typical
+ *  datasheet times, page programs that wrap inside their page and only
+ *  clear bits, and erases. Program and erase start on the rising CS edge,
+ *  as on the part. Misuse is counted in g_SimFlash rather than faulted.
+ */
+
+#include "sim.h"
+#include "w25q32.h"
+#include <string.h>
+
+#define SIM_FLASH_TPP_PS (700 * SIM_PS_PER_US)     // Page program, typ.
+#define SIM_FLASH_TSE_PS (45 * SIM_PS_PER_MS)      // 4KB sector erase
+#define SIM_FLASH_TBE_PS (150 * SIM_PS_PER_MS)     // 64KB block erase
+#define SIM_FLASH_TCE_PS (10000 * SIM_PS_PER_MS)   // Chip erase
+#define SIM_FLASH_READ_MAX_HZ 50000000             // Read Data (03h)
+
+#define SR_BUSY 0x01
+#define SR_WEL 0x02
+
+Sim_FlashStats_t g_SimFlash;
+
+static uint8_t memory[FLASH_TOTAL_SIZE];
+static uint16_t sector_erases[FLASH_TOTAL_SIZE / FLASH_SECTOR_SIZE];
+
+static uint8_t selected;
+static uint8_t wel;
+static uint64_t busy_until;
+
+static uint8_t opcode;
+static uint32_t index_in_cycle; // Bytes seen since CS fell
+static uint32_t address;
+static uint8_t page_buf[FLASH_PAGE_SIZE];
+static uint8_t page_used[FLASH_PAGE_SIZE];
+static uint32_t page_bytes;
+
+static uint8_t Sim_FlashBusy(void) { return g_SimNow < busy_until; }
+
+static void Sim_FlashStartBusy(uint64_t ps) {
+  busy_until = g_SimNow + ps;
+  g_SimFlash.BusyPs += ps;
+  wel = 0;
+}
+
+void Sim_FlashInit(void) {
+  memset(memory, 0xFF, sizeof(memory));
+  memset(sector_erases, 0, sizeof(sector_erases));
+  memset(&g_SimFlash, 0, sizeof(g_SimFlash));
+  selected = 0;
+  wel = 0;
+  busy_until = 0;
+}
+
+uint8_t *Sim_FlashMemory(void) { return memory; }
+
+int Sim_FlashLoad(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return -1;
+  size_t n = fread(memory, 1, sizeof(memory), f);
+  fclose(f);
+  return (n == sizeof(memory)) ? 0 : -1;
+}
+
+int Sim_FlashSave(const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (f == NULL)
+    return -1;
+  size_t n = fwrite(memory, 1, sizeof(memory), f);
+  return (fclose(f) == 0 && n == sizeof(memory)) ? 0 : -1;
+}
+
+static void Sim_FlashEraseRange(uint32_t start, uint32_t size) {
+  start &= ~(size - 1);
+  memset(&memory[start], 0xFF, size);
+  for (uint32_t s = start / FLASH_SECTOR_SIZE;
+       s < (start + size) / FLASH_SECTOR_SIZE; s++) {
+    sector_erases[s]++;
+    if (sector_erases[s] > g_SimFlash.MaxSectorErases)
+      g_SimFlash.MaxSectorErases = sector_erases[s];
+  }
+}
+
+// The buffered page goes to the array when CS rises
+static void Sim_FlashProgram(void) {
+  uint32_t base = address & ~(uint32_t)(FLASH_PAGE_SIZE - 1);
+  if (page_bytes == 0)
+    return;
+  if (page_bytes > FLASH_PAGE_SIZE)
+    g_SimFlash.PageWraps++;
+  for (uint32_t i = 0; i < FLASH_PAGE_SIZE; i++) {
+    if (!page_used[i])
+      continue;
+    uint8_t *cell = &memory[base + i];
+    if (page_buf[i] & ~*cell)
+      g_SimFlash.ZeroToOne++;
+    *cell &= page_buf[i];
+  }
+  g_SimFlash.PagePrograms++;
+  g_SimFlash.BytesProgrammed += page_bytes;
+  // tPP grows with the bytes programmed, from about 0.4ms to 0.7ms
+  Sim_FlashStartBusy(SIM_FLASH_TPP_PS * (4 + 3 * page_bytes / 256) / 7);
+}
+
+static void Sim_FlashRelease(void) {
+  if (index_in_cycle == 0)
+    return;
+  switch (opcode) {
+  case CMD_PAGE_PROGRAM:
+    if (index_in_cycle >= 4)
+      Sim_FlashProgram();
+    break;
+  case CMD_SECTOR_ERASE:
+    if (index_in_cycle == 4) {
+      Sim_FlashEraseRange(address, FLASH_SECTOR_SIZE);
+      g_SimFlash.SectorErases++;
+      Sim_FlashStartBusy(SIM_FLASH_TSE_PS);
+    }
+    break;
+  case CMD_BLOCK_ERASE:
+    if (index_in_cycle == 4) {
+      Sim_FlashEraseRange(address, FLASH_BLOCK_SIZE);
+      g_SimFlash.BlockErases++;
+      Sim_FlashStartBusy(SIM_FLASH_TBE_PS);
+    }
+    break;
+  case CMD_CHIP_ERASE:
+    if (index_in_cycle == 1) {
+      Sim_FlashEraseRange(0, FLASH_TOTAL_SIZE);
+      g_SimFlash.ChipErases++;
+      Sim_FlashStartBusy(SIM_FLASH_TCE_PS);
+    }
+    break;
+  }
+}
+
+void Sim_FlashSelect(uint8_t sel) {
+  if (selected && !sel)
+    Sim_FlashRelease();
+  selected = sel;
+  index_in_cycle = 0;
+}
+
+static uint8_t Sim_FlashIsWrite(uint8_t op) {
+  return op == CMD_PAGE_PROGRAM || op == CMD_SECTOR_ERASE ||
+         op == CMD_BLOCK_ERASE || op == CMD_CHIP_ERASE;
+}
+
+// First byte of a cycle: the opcode
+static void Sim_FlashCommand(uint8_t op) {
+  opcode = op;
+  address = 0;
+  if (Sim_FlashBusy() && op != CMD_READ_STATUS_1) {
+    g_SimFlash.BusyCommands++;
+    opcode = 0xFF; // Ignored by the part
+    return;
+  }
+  if (Sim_FlashIsWrite(op) && !wel) {
+    g_SimFlash.NoWel++;
+    opcode = 0xFF;
+    return;
+  }
+  switch (op) {
+  case CMD_WRITE_ENABLE:
+    wel = 1;
+    break;
+  case CMD_WRITE_DISABLE:
+    wel = 0;
+    break;
+  case CMD_PAGE_PROGRAM:
+    memset(page_used, 0, sizeof(page_used));
+    page_bytes = 0;
+    break;
+  }
+}
+
+static uint8_t Sim_FlashReadByte(void) {
+  uint8_t v = memory[address];
+  address = (address + 1) % FLASH_TOTAL_SIZE;
+  g_SimFlash.BytesRead++;
+  return v;
+}
+
+uint8_t Sim_FlashByte(uint8_t out, uint32_t sck_hz) {
+  uint32_t i = index_in_cycle++;
+  if (i == 0) {
+    Sim_FlashCommand(out);
+    if (opcode == CMD_READ_DATA && sck_hz > SIM_FLASH_READ_MAX_HZ)
+      g_SimFlash.ReadOverclock++;
+    return 0xFF;
+  }
+
+  switch (opcode) {
+  case CMD_READ_STATUS_1:
+    return (Sim_FlashBusy() ? SR_BUSY : 0) | (wel ? SR_WEL : 0);
+  case CMD_JEDEC_ID:
+    return (i == 1) ? 0xEF : (i == 2) ? 0x40 : (i == 3) ? 0x16 : 0xFF;
+  case CMD_READ_DATA:
+  case CMD_FAST_READ:
+  case CMD_PAGE_PROGRAM:
+  case CMD_SECTOR_ERASE:
+  case CMD_BLOCK_ERASE:
+    if (i <= 3) {
+      address = ((address << 8) | out) % FLASH_TOTAL_SIZE;
+      return 0xFF;
+    }
+    break;
+  default:
+    return 0xFF;
+  }
+
+  if (opcode == CMD_READ_DATA)
+    return Sim_FlashReadByte();
+  if (opcode == CMD_FAST_READ)
+    return (i == 4) ? 0xFF : Sim_FlashReadByte(); // Dummy byte first
+  if (opcode == CMD_PAGE_PROGRAM) {
+    // Past the page end the address wraps to the page start
+    uint32_t col = ((address & (FLASH_PAGE_SIZE - 1)) + page_bytes) %
+                   FLASH_PAGE_SIZE;
+    page_buf[col] = out;
+    page_used[col] = 1;
+    page_bytes++;
+  }
+  return 0xFF;
+}
@@ -6,6 +6,135 @@ import serial.tools.list_ports
 import threading
 import time
 import csv
+import struct
+import binascii
+
+# Binary log format (must match Core/Inc/log_format.h)
+LOG_MAGIC = 0x474C4642  # "BFLG"
+LOG_HEADER = struct.Struct("<IBBBBIIB3xHH")  # Log_Header_t v1 part, 24 bytes
+LOG_MAX_RANGES = 15
+LOG_RANGE_LSB = struct.Struct(f"<{LOG_MAX_RANGES}I")  # v2: fA per code
+LOG_RANGE_INVALID = 0xF
+
+# Framed host link (must match Core/Inc/frame.h)
+FRAME_CMD = 0x01
+FRAME_TEXT = 0x02
+FRAME_BEGIN = 0x10
+FRAME_DATA = 0x11
+FRAME_END = 0x12
+FRAME_ACK = 0x13
+FRAME_NAK = 0x14
+FRAME_SAMPLES = 0x20
+STREAM_HEADER = struct.Struct("<II")  # Stream_Header_t: dropped, period_us
+STREAM_RECORD = struct.Struct("<IhH4i")  # Stream_Record_t: tick, mV, ranges, pA
+STREAM_HZ = 10  # Live view rate
+LINK_BAUD_DEFAULT = 115200  # Device rate after reset
+LINK_BAUDS = ["115200", "460800", "1000000", "2000000"]
+
+
+def cobs_encode(data):
+    out = bytearray()
+    block = bytearray()
+    for b in data:
+        if b == 0:
+            out.append(len(block) + 1)
+            out += block
+            block.clear()
+        else:
+            block.append(b)
+            if len(block) == 254:
+                out.append(255)
+                out += block
+                block.clear()
+    out.append(len(block) + 1)
+    out += block
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            raise ValueError("Bad COBS block")
+        out += data[i:i + code - 1]
+        i += code - 1
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_frame(frame_type, seq, data=b""):
+    """Frame as sent on the wire, delimiters included."""
+    body = struct.pack("<BBH", frame_type, seq & 0xFF, len(data)) + data
+    body += struct.pack("<H", binascii.crc_hqx(body, 0xFFFF))
+    return b"\x00" + cobs_encode(body) + b"\x00"
+
+
+def decode_frame(encoded):
+    """Returns (type, seq, data), or None if the frame is damaged."""
+    try:
+        body = cobs_decode(encoded)
+    except ValueError:
+        return None
+    if len(body) < 6:
+        return None
+    frame_type, seq, length = struct.unpack_from("<BBH", body, 0)
+    (crc,) = struct.unpack_from("<H", body, len(body) - 2)
+    if length != len(body) - 6 or binascii.crc_hqx(body[:-2], 0xFFFF) != crc:
+        return None
+    return frame_type, seq, body[4:-2]
+
+
+def decode_binary_log(data):
+    """Decode a binary run (header + records) into CSV rows.
+
+    Returns (header_row, rows). Raises ValueError if the data does not start
+    with a valid run header.
+    """
+    if len(data) < LOG_HEADER.size:
+        raise ValueError("Data too short for a log header")
+    (magic, version, header_size, record_size, channels, period_us,
+     run_time_ms, test_type, dac_lsb_uv, reading_lsb_pa) = LOG_HEADER.unpack_from(data, 0)
+    if magic != LOG_MAGIC:
+        raise ValueError("No log header found (flash empty or old CSV data?)")
+    if version == 1 and record_size == 6 + 2 * channels:
+        record = struct.Struct(f"<Ih{channels}h")
+    elif version == 2 and record_size == 8 + 2 * channels:
+        record = struct.Struct(f"<IhH{channels}h")
+        range_lsb_fa = LOG_RANGE_LSB.unpack_from(data, LOG_HEADER.size)
+    else:
+        raise ValueError(f"Unsupported log format v{version}")
+
+    header_row = ["Time (ms)", "Voltage (V)"] + [f"Current FET{i + 1} (uA)" for i in range(channels)]
+    if version >= 2:
+        header_row += [f"Range FET{i + 1}" for i in range(channels)]
+    rows = []
+    offset = header_size
+    while offset + record_size <= len(data):
+        fields = record.unpack_from(data, offset)
+        if fields[0] == 0xFFFFFFFF:
+            break  # Erased flash: end of run
+        voltage = fields[1] * dac_lsb_uv / 1e6
+        if version == 1:
+            currents = [f"{raw * reading_lsb_pa / 1e6:.3f}" for raw in fields[2:]]
+            tags = []
+        else:
+            ranges = fields[2]
+            tags = [(ranges >> (4 * i)) & 0xF for i in range(channels)]
+            currents = []
+            for raw, tag in zip(fields[3:], tags):
+                if tag == LOG_RANGE_INVALID or tag >= LOG_MAX_RANGES:
+                    currents.append("")  # Taken while switching range
+                else:
+                    currents.append(f"{raw * range_lsb_fa[tag] / 1e9:.6f}")
+            tags = [("" if t == LOG_RANGE_INVALID else t) for t in tags]
+        rows.append([fields[0], f"{voltage:.3f}"] + currents + tags)
+        offset += record_size
+    return header_row, rows
+
 
 class BioFETGUI:
     def __init__(self, root):
@@ -16,9 +145,16 @@ class BioFETGUI:
         self.serial_port = None
         self.is_connected = False
         self.custom_receive_file = ""  # Initialize as empty string instead of None
-        self.data_capture_mode = False
-        self.captured_data = []
         self.listen_thread = None # Initialize to None
+        self.tx_lock = threading.Lock()  # UI thread and listener both send
+        self.tx_seq = 0
+        self.pending_baud = None  # Switch once the device confirms SET_BAUD
+        self.cmd_tag = 0
+        self.pending = {}  # Tag -> command still waiting for its OK / ERR
+        self.confirm_save = False  # Tell the user once SAVE_CONFIG is done
+        self.transfer = None  # Framed READ_FLASH in progress
+        self.streaming = False
+        self.live_shown = 0.0  # Last live view refresh
 
         # --- STYLE ---
         self.style = ttk.Style()
@@ -32,6 +168,11 @@ class BioFETGUI:
         self.port_combo = ttk.Combobox(conn_frame, textvariable=self.port_var)
         self.port_combo.pack(side="left", padx=5)
         self.refresh_ports()
+
+        ttk.Label(conn_frame, text="Baud:").pack(side="left", padx=5)
+        self.baud_var = tk.StringVar(value=LINK_BAUDS[-1])
+        self.baud_combo = ttk.Combobox(conn_frame, textvariable=self.baud_var, values=LINK_BAUDS, width=9)
+        self.baud_combo.pack(side="left", padx=5)
         
         self.btn_refresh = ttk.Button(conn_frame, text="Refresh", command=self.refresh_ports)
         self.btn_refresh.pack(side="left", padx=5)
@@ -48,12 +189,20 @@ class BioFETGUI:
         self.test_type_var = tk.IntVar(value=2)
         ttk.Radiobutton(config_frame, text="Type 1 (Constant)", variable=self.test_type_var, value=1, command=self.update_ui_state).grid(row=0, column=1, sticky="w")
         ttk.Radiobutton(config_frame, text="Type 2 (Ramping)", variable=self.test_type_var, value=2, command=self.update_ui_state).grid(row=0, column=2, sticky="w")
+        # Type 3 plays the sweep profile stored on the device (SWEEP_* commands)
+        ttk.Radiobutton(config_frame, text="Type 3 (Sweep)", variable=self.test_type_var, value=3, command=self.update_ui_state).grid(row=0, column=3, sticky="w")
         
         # Test Length
         ttk.Label(config_frame, text="Test Length (min):").grid(row=1, column=0, sticky="w", pady=5)
         self.length_var = tk.DoubleVar(value=5.0)
         self.entry_length = ttk.Entry(config_frame, textvariable=self.length_var)
         self.entry_length.grid(row=1, column=1, columnspan=2, sticky="ew")
+
+        # Sample Rate
+        ttk.Label(config_frame, text="Sample Rate (Hz):").grid(row=3, column=0, sticky="w", pady=5)
+        self.rate_var = tk.IntVar(value=10)
+        self.entry_rate = ttk.Entry(config_frame, textvariable=self.rate_var)
+        self.entry_rate.grid(row=3, column=1, columnspan=2, sticky="ew")
         
         # Save Settings Button
         self.btn_save_settings = ttk.Button(config_frame, text="SAVE SETTINGS TO DEVICE", command=self.save_settings, state="disabled")
@@ -72,11 +221,23 @@ class BioFETGUI:
         self.btn_offload = ttk.Button(ctrl_frame, text="OFFLOAD OPTIMIZED MEMORY", command=self.offload_memory, state="disabled")
         self.btn_offload.pack(side="left", fill="x", expand=True, padx=5)
 
+        self.btn_runs = ttk.Button(ctrl_frame, text="LIST RUNS", command=self.list_runs, state="disabled")
+        self.btn_runs.pack(side="left", fill="x", expand=True, padx=5)
+
         self.btn_clear = ttk.Button(ctrl_frame, text="CLEAR MEMORY", command=self.clear_memory, state="disabled")
         self.btn_clear.pack(side="left", fill="x", expand=True, padx=5)
 
         self.btn_temp_test = ttk.Button(ctrl_frame, text="TEMP TEST", command=self.run_temp_test, state="disabled")
         self.btn_temp_test.pack(side="left", fill="x", expand=True, padx=5)
+
+        self.btn_live = ttk.Button(ctrl_frame, text="LIVE", command=self.toggle_stream, state="disabled")
+        self.btn_live.pack(side="left", fill="x", expand=True, padx=5)
+
+        # --- LIVE VIEW (STREAM) ---
+        live_frame = ttk.LabelFrame(root, text="Live", padding=10)
+        live_frame.pack(fill="x", padx=10, pady=5)
+        self.live_var = tk.StringVar(value="Not streaming")
+        ttk.Label(live_frame, textvariable=self.live_var, font=("TkFixedFont", 9)).pack(anchor="w")
         
         # --- LOGGING AREA ---
         log_frame = ttk.LabelFrame(root, text="Device Log", padding=10)
@@ -103,7 +264,7 @@ class BioFETGUI:
         if not self.is_connected:
             try:
                 port = self.port_var.get()
-                self.serial_port = serial.Serial(port, 115200, timeout=1)
+                self.serial_port = serial.Serial(port, LINK_BAUD_DEFAULT, timeout=0.1)
                 self.is_connected = True
                 self.btn_connect.config(text="Disconnect")
                 self.log(f"Connected to {port}")
@@ -117,12 +278,19 @@ class BioFETGUI:
                 self.btn_stop.config(state="normal")
                 self.btn_offload.config(state="normal")
                 self.btn_offload.config(state="normal")
+                self.btn_runs.config(state="normal")
                 self.btn_clear.config(state="normal")
                 self.btn_save_settings.config(state="normal")
                 self.btn_temp_test.config(state="normal")
+                self.btn_live.config(state="normal")
                 
-                # Send Ping
-                self.send_cmd("PING")
+                # Send Ping, then move the link to the selected rate
+                cmds = ["PING"]
+                baud = int(self.baud_var.get())
+                if baud != LINK_BAUD_DEFAULT:
+                    self.pending_baud = baud
+                    cmds.append(f"SET_BAUD {baud}")
+                self.send_batch(cmds)
                 
             except Exception as e:
                 messagebox.showerror("Connection Error", str(e))
@@ -136,28 +304,64 @@ class BioFETGUI:
             self.btn_stop.config(state="disabled")
             self.btn_offload.config(state="disabled")
             self.btn_offload.config(state="disabled")
+            self.btn_runs.config(state="disabled")
             self.btn_clear.config(state="disabled")
             self.btn_save_settings.config(state="disabled")
             self.btn_temp_test.config(state="disabled")
+            self.btn_live.config(state="disabled", text="LIVE")
+            self.streaming = False
+
+    def send_frame(self, frame_type, data=b""):
+        with self.tx_lock:
+            self.serial_port.write(encode_frame(frame_type, self.tx_seq, data))
+            self.tx_seq += 1
 
     def send_cmd(self, cmd):
-        if self.is_connected and self.serial_port:
-            full_cmd = cmd + "\n"
-            self.serial_port.write(full_cmd.encode('utf-8'))
-            self.log(f"> {cmd}")
+        self.send_batch([cmd])
 
-    def listen_serial(self):
-        while self.is_connected:
-            try:
-                if self.serial_port and self.serial_port.in_waiting:
-                    line = self.serial_port.readline().decode('utf-8').strip()
-                    if line:
-                        # Use root.after to safely update UI from thread
-                        self.root.after(0, self.log, f"< {line}")
-            except Exception as e:
-                print(f"Serial Error: {e}")
-                break
-            time.sleep(0.01)
+    def send_batch(self, cmds):
+        # One frame, commands separated by ';'. Each gets a "#tag" the device
+        # echoes in its responses, so there is no need to wait between them.
+        # Commands go as frames, so replies come back framed and CRC checked
+        if not (self.is_connected and self.serial_port):
+            return
+        tagged = []
+        for cmd in cmds:
+            self.cmd_tag = self.cmd_tag % 9999 + 1
+            tag = f"#{self.cmd_tag}"
+            self.pending[tag] = cmd
+            tagged.append(f"{tag} {cmd}")
+        self.send_frame(FRAME_CMD, ";".join(tagged).encode('utf-8'))
+        self.log(f"> {'; '.join(cmds)}")
+
+    def handle_reply(self, line):
+        # Responses to a tagged command start with its tag. Others (e.g.
+        # TEST_COMPLETE) are events and are only logged.
+        tag, _, body = line.partition(" ")
+        cmd = self.pending.get(tag) if tag.startswith("#") else None
+        if cmd is None:
+            self.root.after(0, self.log, f"< {line}")
+            return
+
+        if body.startswith("ERR"):
+            self.root.after(0, self.log, f"< {body} ({cmd})")
+        else:
+            self.root.after(0, self.log, f"< {body}")
+        if body.startswith(("RUN ", "SEG ", "TASK ")):
+            return  # Listing, its OK line comes last
+        del self.pending[tag]
+
+        if cmd.startswith("SET_BAUD") and body == "OK: Baud Set" and self.pending_baud:
+            self.serial_port.baudrate = self.pending_baud
+            self.root.after(0, self.log, f"Link at {self.pending_baud} baud")
+            self.pending_baud = None
+        elif cmd == "SAVE_CONFIG" and self.confirm_save:
+            self.confirm_save = False
+            if body.startswith("OK"):
+                self.root.after(0, messagebox.showinfo, "Success",
+                                "Settings Saved to Device Flash!")
+            else:
+                self.root.after(0, messagebox.showerror, "Error", body)
 
     def update_ui_state(self):
         if self.test_type_var.get() == 2:
@@ -165,110 +369,190 @@ class BioFETGUI:
         else:
             self.entry_length.config(state="disabled")
 
+    def toggle_stream(self):
+        # Samples keep going to flash as well; this only adds the live copy
+        self.streaming = not self.streaming
+        self.send_cmd(f"STREAM {STREAM_HZ if self.streaming else 0}")
+        self.btn_live.config(text="STOP LIVE" if self.streaming else "LIVE")
+
     def run_temp_test(self):
         self.send_cmd("TEMP_TEST")
 
     def run_test(self):
         # Configure first (ensure settings are up to date)
-        if not self.upload_settings():
+        cmds = self.settings_cmds()
+        if cmds is None:
             return
 
         # Auto-Save before starting (Duplicate of manual save, but good for safety)
-        self.send_cmd("SAVE_CONFIG")
-        time.sleep(0.1)
-        self.send_cmd("START")
+        self.send_batch(cmds + ["SAVE_CONFIG", "START"])
 
     def save_settings(self):
-        if self.upload_settings():
-            self.send_cmd("SAVE_CONFIG")
-            messagebox.showinfo("Success", "Settings Saved to Device Flash!")
+        cmds = self.settings_cmds()
+        if cmds is not None:
+            self.confirm_save = True  # Shown when the device answers
+            self.send_batch(cmds + ["SAVE_CONFIG"])
 
-    def upload_settings(self):
+    def settings_cmds(self):
+        # Commands applying the settings in the UI, or None if one is invalid
         t_type = self.test_type_var.get()
-        self.send_cmd(f"SET_TYPE {t_type}")
-        time.sleep(0.1)
+        cmds = [f"SET_TYPE {t_type}"]
         
         if t_type == 2:
             try:
                 mins = float(self.length_var.get())
-                self.send_cmd(f"SET_TIME {mins}")
-                time.sleep(0.1)
+                cmds.append(f"SET_TIME {mins}")
             except ValueError:
                 messagebox.showerror("Error", "Invalid Time Value")
-                return False
-        return True
+                return None
+
+        try:
+            rate = int(self.rate_var.get())
+        except (ValueError, tk.TclError):
+            messagebox.showerror("Error", "Invalid Sample Rate")
+            return None
+        cmds.append(f"SET_RATE {rate}")
+        return cmds
 
     def stop_test(self):
         self.send_cmd("STOP")
 
+    def list_runs(self):
+        # Device answers with "RUN id,seq,offset,bytes,period_us,type,seconds"
+        self.send_cmd("LIST_RUNS")
+
     def clear_memory(self):
         if messagebox.askyesno("Confirm", "Are you sure you want to CLEAR the device memory? This cannot be undone."):
             self.send_cmd("CLEAR_FLASH")
 
     def offload_memory(self):
-        # This function listens for a specific data stream
-        # Disable listening thread temporarily or handle data parsing there?
-        # For simplicity, we'll send the command and let the user see the log, 
-        # OR we can prompt to save to file and then parse incoming data.
-        
         file_path = filedialog.asksaveasfilename(defaultextension=".csv", filetypes=[("CSV Files", "*.csv")])
         if not file_path:
             return
 
         self.custom_receive_file = file_path
+        # Sent framed: the device answers with BEGIN / DATA / END frames
         self.send_cmd("READ_FLASH")
-        # In a real app, we'd need a more robust state machine to distinct command responses from data dump.
-        # Here, I'll trust the 'listen_serial' + 'log' is enough for debug, 
-        # BUT the user wants a downloaded file.
-        
-        # WARNING: simple 'readline' in listen_serial sends everything to log.
-        # Ideally, we should intercept "BEGIN_DATA" and start writing to file until "END_DATA".
-        
-        # Let's modify listen_serial to handle this mode.
-        self.data_capture_mode = True
-        self.captured_data = []
 
-    # Modified listener to capture data
     def listen_serial(self):
-        self.data_capture_mode = False
-        self.captured_data = []
-        
+        # Frames run from one 0x00 to the next; anything outside a frame is a
+        # text line (e.g. "BioFET Ready" after a reset). Text has no zeros, so
+        # bytes ended by one are always a frame: a lost delimiter costs one
+        # frame instead of swapping frames and gaps for good.
+        in_frame = False
+        buf = bytearray()
+
         while self.is_connected:
             try:
-                if self.serial_port and self.serial_port.in_waiting:
-                    line = self.serial_port.readline().decode('utf-8').strip()
-                    if line:
-                        if line == "BEGIN_DATA":
-                            self.data_capture_mode = True
-                            self.captured_data = []
-                            self.root.after(0, self.log, "< Receiving Data...")
-                        elif line == "END_DATA":
-                            self.data_capture_mode = False
-                            self.save_captured_data()
-                            self.root.after(0, self.log, "< Data Transfer Complete")
-                        elif self.data_capture_mode:
-                            self.captured_data.append(line)
-                        else:
-                            self.root.after(0, self.log, f"< {line}")
+                chunk = self.serial_port.read(self.serial_port.in_waiting or 1)
             except Exception as e:
                 print(f"Serial Error: {e}")
                 self.is_connected = False
                 break
-            time.sleep(0.01)
 
-    def save_captured_data(self):
-        if hasattr(self, 'custom_receive_file') and self.custom_receive_file:
-            try:
-                with open(self.custom_receive_file, 'w', newline='') as f:
-                    writer = csv.writer(f)
-                    writer.writerow(["Index", "Voltage", "Current"]) # Header
-                    for row in self.captured_data:
-                        parts = row.split(',')
-                        if len(parts) >= 1:
-                            writer.writerow(parts)
-                self.root.after(0, messagebox.showinfo, "Success", f"Data saved to {self.custom_receive_file}")
-            except Exception as e:
-                self.root.after(0, messagebox.showerror, "Error", f"Failed to save file: {e}")
+            for b in chunk:
+                if b == 0:
+                    if buf:
+                        self.handle_frame(bytes(buf))
+                    in_frame = not buf
+                    buf.clear()
+                elif not in_frame and b in (10, 13):
+                    line = buf.decode('utf-8', errors='replace').strip()
+                    buf.clear()
+                    if line:
+                        self.root.after(0, self.log, f"< {line}")
+                else:
+                    buf.append(b)
+
+            self.check_transfer_stall()
+
+    def handle_frame(self, encoded):
+        frame = decode_frame(encoded)
+        if frame is None:
+            # Damaged: ask for the data again from the first missing byte
+            if self.transfer and not self.transfer["nak_sent"]:
+                self.send_frame(FRAME_NAK, struct.pack("<I", len(self.transfer["data"])))
+                self.transfer["nak_sent"] = True
+            return
+
+        frame_type, _, data = frame
+        if frame_type == FRAME_TEXT:
+            self.handle_reply(data.decode('utf-8', errors='replace').strip())
+        elif frame_type == FRAME_BEGIN and len(data) == 4:
+            (total,) = struct.unpack("<I", data)
+            self.transfer = {"total": total, "data": bytearray(), "nak_sent": False,
+                             "last": time.time()}
+            self.root.after(0, self.log, f"< Receiving {total} bytes...")
+            if total == 0:
+                self.finish_transfer()
+        elif frame_type == FRAME_DATA and self.transfer and len(data) >= 4:
+            (offset,) = struct.unpack_from("<I", data, 0)
+            received = self.transfer["data"]
+            if offset == len(received):
+                received += data[4:]
+                self.transfer["nak_sent"] = False
+                self.transfer["last"] = time.time()
+                self.send_frame(FRAME_ACK, struct.pack("<I", len(received)))
+                if len(received) >= self.transfer["total"]:
+                    self.finish_transfer()
+            elif offset > len(received):
+                # A frame went missing; later ones are dropped until it is resent
+                if not self.transfer["nak_sent"]:
+                    self.send_frame(FRAME_NAK, struct.pack("<I", len(received)))
+                    self.transfer["nak_sent"] = True
+            else:
+                # Resent after a lost ACK: confirm again so the device moves on
+                self.send_frame(FRAME_ACK, struct.pack("<I", len(received)))
+        elif frame_type == FRAME_END:
+            pass  # All data was already acknowledged
+        elif frame_type == FRAME_SAMPLES and len(data) >= STREAM_HEADER.size:
+            self.handle_samples(data)
+
+    def handle_samples(self, data):
+        dropped, period_us = STREAM_HEADER.unpack_from(data, 0)
+        records = list(STREAM_RECORD.iter_unpack(data[STREAM_HEADER.size:]))
+        # Refresh at most 5 times a second; Tk is not fast enough for more
+        if not records or time.time() - self.live_shown < 0.2:
+            return
+        self.live_shown = time.time()
+        tick, dac_mv, ranges, *currents_pa = records[-1]
+        currents = []
+        for ch, pa in enumerate(currents_pa):
+            tag = (ranges >> (4 * ch)) & 0xF
+            currents.append("    --   " if tag == LOG_RANGE_INVALID else f"{pa / 1e6:9.4f}")
+        text = (f"t={tick * period_us / 1e6:9.2f} s  V={dac_mv / 1000:6.3f}  "
+                f"I(uA)={' '.join(currents)}  dropped={dropped}")
+        self.root.after(0, self.live_var.set, text)
+
+    def finish_transfer(self):
+        data = bytes(self.transfer["data"][:self.transfer["total"]])
+        self.transfer = None
+        self.save_binary_data(data)
+        self.root.after(0, self.log, "< Data Transfer Complete")
+
+    def check_transfer_stall(self, stall_timeout=5.0):
+        if self.transfer and time.time() - self.transfer["last"] > stall_timeout:
+            got = len(self.transfer["data"])
+            self.root.after(0, self.log, f"< Transfer stalled at {got}/{self.transfer['total']} bytes")
+            self.transfer = None
+
+    def save_binary_data(self, data):
+        try:
+            header_row, rows = decode_binary_log(data)
+        except ValueError as e:
+            self.root.after(0, messagebox.showerror, "Error", f"Could not decode data: {e}")
+            return
+        if not self.custom_receive_file:
+            self.root.after(0, self.log, f"< Decoded {len(rows)} samples (no file selected)")
+            return
+        try:
+            with open(self.custom_receive_file, 'w', newline='') as f:
+                writer = csv.writer(f)
+                writer.writerow(header_row)
+                writer.writerows(rows)
+            self.root.after(0, messagebox.showinfo, "Success", f"{len(rows)} samples saved to {self.custom_receive_file}")
+        except Exception as e:
+            self.root.after(0, messagebox.showerror, "Error", f"Failed to save file: {e}")
 
 if __name__ == "__main__":
     root = tk.Tk()